@@ -0,0 +1,177 @@
+/**
+* @file bench_common.hpp
+ *
+ * @brief Shared helpers of the kero benchmarks: timers, percentiles, command line and JSON output.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace kero {
+namespace bench {
+
+    class Timer {
+    private:
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        Timer() : start(std::chrono::steady_clock::now()) {}
+
+        void reset() {
+            start = std::chrono::steady_clock::now();
+        }
+
+        uint64_t elapsed_ns() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+        }
+
+        double elapsed_s() const {
+            return elapsed_ns() / 1e9;
+        }
+    };
+
+    /**
+     * @brief Percentile of a sample (nearest rank). The sample is sorted in place.
+     */
+    inline uint64_t percentile(std::vector<uint64_t>& sample, double p) {
+        if (sample.empty())
+            return 0;
+        std::sort(sample.begin(), sample.end());
+        auto rank = static_cast<size_t>(p / 100.0 * (sample.size() - 1) + 0.5);
+        return sample[std::min(rank, sample.size() - 1)];
+    }
+
+    inline uint64_t file_size(const std::string& filename) {
+        struct stat sb{};
+        if (stat(filename.c_str(), &sb) != 0)
+            return 0;
+        return static_cast<uint64_t>(sb.st_size);
+    }
+
+    /**
+     * @brief Minimal "--name value" command line parser.
+     */
+    class Args {
+    private:
+        std::map<std::string, std::string> values;
+
+    public:
+        Args(int argc, char** argv) {
+            for (int i = 1; i < argc; i++) {
+                std::string arg = argv[i];
+                if (arg.compare(0, 2, "--") != 0)
+                    throw std::invalid_argument("Unexpected argument " + arg);
+                arg = arg.substr(2);
+                if (i + 1 < argc and std::string(argv[i + 1]).compare(0, 2, "--") != 0)
+                    values[arg] = argv[++i];
+                else
+                    values[arg] = "1";
+            }
+        }
+
+        bool has(const std::string& name) const {
+            return values.find(name) != values.end();
+        }
+
+        std::string get(const std::string& name, const std::string& def) const {
+            auto it = values.find(name);
+            return it == values.end() ? def : it->second;
+        }
+
+        uint64_t get_uint(const std::string& name, uint64_t def) const {
+            auto it = values.find(name);
+            return it == values.end() ? def : std::stoull(it->second);
+        }
+
+        double get_double(const std::string& name, double def) const {
+            auto it = values.find(name);
+            return it == values.end() ? def : std::stod(it->second);
+        }
+
+        // Comma separated list of integers, e.g. "--k 21,31"
+        std::vector<uint64_t> get_uint_list(const std::string& name, const std::string& def) const {
+            std::vector<uint64_t> list;
+            std::stringstream ss(get(name, def));
+            std::string item;
+            while (std::getline(ss, item, ','))
+                if (not item.empty())
+                    list.push_back(std::stoull(item));
+            return list;
+        }
+    };
+
+    /**
+     * @brief Flat JSON object writer: one level of nested objects is enough for the reports.
+     */
+    class Json_object {
+    private:
+        std::vector<std::pair<std::string, std::string>> fields;
+
+        static std::string quote(const std::string& str) {
+            std::ostringstream ss;
+            ss << '"';
+            for (char c : str) {
+                if (c == '"' or c == '\\')
+                    ss << '\\';
+                ss << c;
+            }
+            ss << '"';
+            return ss.str();
+        }
+
+    public:
+        Json_object& set(const std::string& name, const std::string& value) {
+            fields.emplace_back(name, quote(value));
+            return *this;
+        }
+
+        Json_object& set(const std::string& name, const char* value) {
+            return set(name, std::string(value));
+        }
+
+        Json_object& set(const std::string& name, uint64_t value) {
+            fields.emplace_back(name, std::to_string(value));
+            return *this;
+        }
+
+        Json_object& set(const std::string& name, double value) {
+            std::ostringstream ss;
+            ss << std::setprecision(6) << value;
+            fields.emplace_back(name, ss.str());
+            return *this;
+        }
+
+        Json_object& set(const std::string& name, const Json_object& value) {
+            fields.emplace_back(name, value.str());
+            return *this;
+        }
+
+        std::string str() const {
+            std::ostringstream ss;
+            ss << '{';
+            for (size_t i = 0; i < fields.size(); i++) {
+                if (i > 0)
+                    ss << ", ";
+                ss << quote(fields[i].first) << ": " << fields[i].second;
+            }
+            ss << '}';
+            return ss.str();
+        }
+    };
+
+} // namespace bench
+} // namespace kero
@@ -0,0 +1,128 @@
+/**
+* @file kero_ablation.cpp
+ *
+ * @brief Side by side comparison of the minimizer section layouts on the same synthetic data.
+ *
+ * Each layout (row, columnar without compression, columnar with compression) writes the same file,
+ * which is then scanned and queried. The size, write speed, scan speed and lookup latency of every
+ * layout are printed as a single JSON object.
+ *
+ * Usage: kero_ablation [--k 31] [--m 11] [--max 21] [--data_size 1] [--sections 10000]
+ *                      [--skmers 16] [--skew 0] [--seed 42] [--queries 100000]
+ *                      [--file kero_ablation.kero] [--output results.json]
+ *
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "bench_common.hpp"
+#include "synthetic.hpp"
+
+using namespace kero::bench;
+
+static Json_object run_layout(uint8_t layout, const Synthetic_params& params, uint64_t nb_queries,
+                              const std::string& filename) {
+    Json_object result;
+    // Same seed, same data for every layout
+    Synthetic_data synthetic(params);
+    std::vector<Query> queries;
+
+    Timer timer;
+    {
+        Kero_file file(filename, "w");
+        file.layout = layout;
+        file.write_encoding(0, 1, 3, 2);
+        synthetic.write(file, &queries, nb_queries / 2);
+        file.close();
+    }
+    double write_s = timer.elapsed_s();
+    uint64_t bytes = file_size(filename);
+
+    result.set("bytes", bytes);
+    result.set("bits_per_kmer", 8.0 * bytes / synthetic.nb_kmers);
+    result.set("write_s", write_s);
+    result.set("write_kmers_per_s", synthetic.nb_kmers / write_s);
+
+    timer.reset();
+    uint64_t nb_kmers = 0;
+    {
+        Kero_reader reader(filename);
+        uint8_t* kmer;
+        uint8_t* data;
+        while (reader.next_kmer(kmer, data))
+            nb_kmers += 1;
+    }
+    double scan_s = timer.elapsed_s();
+    result.set("scan_s", scan_s);
+    result.set("scan_kmers_per_s", nb_kmers / scan_s);
+
+    std::vector<Query> absent = synthetic.absent_queries(nb_queries - queries.size());
+    queries.insert(queries.end(), absent.begin(), absent.end());
+    std::shuffle(queries.begin(), queries.end(), std::mt19937_64(params.seed));
+
+    Kero_file file(filename, "r");
+    file.hashtable_discovery();
+    std::vector<uint8_t> data(params.data_size + 1);
+    std::vector<uint64_t> lookup_ns;
+    uint64_t total_ns = 0, errors = 0;
+    for (const Query& query : queries) {
+        timer.reset();
+        bool found = file.find_kmer(query.minimizer, query.kmer, data.data());
+        uint64_t ns = timer.elapsed_ns();
+        lookup_ns.push_back(ns);
+        total_ns += ns;
+        if (query.present and not found)
+            errors += 1;
+    }
+    result.set("lookup_mean_ns", lookup_ns.empty() ? 0.0 : static_cast<double>(total_ns) / lookup_ns.size());
+    result.set("lookup_p50_ns", percentile(lookup_ns, 50));
+    result.set("lookup_p99_ns", percentile(lookup_ns, 99));
+    result.set("missing_present_kmers", errors);
+
+    std::remove(filename.c_str());
+    return result;
+}
+
+int main(int argc, char** argv) {
+    Args args(argc, argv);
+
+    Synthetic_params params;
+    params.k = args.get_uint("k", params.k);
+    params.m = args.get_uint("m", params.m);
+    params.max = args.get_uint("max", params.max);
+    params.data_size = args.get_uint("data_size", params.data_size);
+    params.nb_sections = args.get_uint("sections", params.nb_sections);
+    params.mean_skmers = args.get_uint("skmers", params.mean_skmers);
+    params.skew = args.get_double("skew", params.skew);
+    params.seed = args.get_uint("seed", params.seed);
+    uint64_t nb_queries = args.get_uint("queries", 100000);
+    std::string filename = args.get("file", "kero_ablation.kero");
+
+    Json_object report;
+    report.set("benchmark", "kero_ablation");
+
+    Json_object json_params;
+    json_params.set("k", params.k).set("m", params.m).set("max", params.max);
+    json_params.set("data_size", params.data_size).set("sections", params.nb_sections);
+    json_params.set("mean_skmers", params.mean_skmers).set("skew", params.skew).set("seed", params.seed);
+    json_params.set("queries", nb_queries);
+    report.set("params", json_params);
+
+    Json_object layouts;
+    for (uint8_t layout : {KERO_LAYOUT_ROW, KERO_LAYOUT_COLUMNAR_NOCOMP, KERO_LAYOUT_COLUMNAR_COMP})
+        layouts.set(kero::layout_name(layout), run_layout(layout, params, nb_queries, filename));
+    report.set("layouts", layouts);
+
+    if (args.has("output")) {
+        std::ofstream out(args.get("output", ""));
+        out << report.str() << std::endl;
+    } else {
+        std::cout << report.str() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,343 @@
+/**
+* @file kero_bench.cpp
+ *
+ * @brief End to end benchmark of kero files on synthetic data.
+ *
+ * Measures the minimizer section write throughput, the Kero_reader scan throughput (per k-mer, with
+ * and without read-ahead, and per block), the sorted loading time (next_kmer + std::sort against load_sorted_kmers), the file open
+ * latency, the random lookup latency percentiles, the batched lookup throughput (Batch_lookup) and the
+ * output size.
+ * The results are printed as a single JSON object to track regressions between releases.
+ *
+ * Usage: kero_bench [--k 31] [--m 11] [--max 21] [--data_size 1] [--sections 10000]
+ *                   [--skmers 16] [--skew 0] [--seed 42] [--queries 100000] [--repeat 5] [--threads 0]
+ *                   [--queue_depth 32] [--prefetch 8] [--file kero_bench.kero] [--output results.json] [--keep]
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/kero_batch.hpp"
+#include "kero-api/kero_sorted.hpp"
+#include "kero-api/detail/util.hpp"
+#include "bench_common.hpp"
+#include "synthetic.hpp"
+
+using namespace kero::bench;
+
+static Json_object latency_summary(std::vector<uint64_t>& sample) {
+    Json_object summary;
+    uint64_t total = 0;
+    for (uint64_t value : sample)
+        total += value;
+    summary.set("count", static_cast<uint64_t>(sample.size()));
+    summary.set("mean_ns", sample.empty() ? 0.0 : static_cast<double>(total) / sample.size());
+    summary.set("p50_ns", percentile(sample, 50));
+    summary.set("p90_ns", percentile(sample, 90));
+    summary.set("p99_ns", percentile(sample, 99));
+    summary.set("p999_ns", percentile(sample, 99.9));
+    summary.set("max_ns", percentile(sample, 100));
+    return summary;
+}
+
+int main(int argc, char** argv) {
+    Args args(argc, argv);
+
+    Synthetic_params params;
+    params.k = args.get_uint("k", params.k);
+    params.m = args.get_uint("m", params.m);
+    params.max = args.get_uint("max", params.max);
+    params.data_size = args.get_uint("data_size", params.data_size);
+    params.nb_sections = args.get_uint("sections", params.nb_sections);
+    params.mean_skmers = args.get_uint("skmers", params.mean_skmers);
+    params.skew = args.get_double("skew", params.skew);
+    params.seed = args.get_uint("seed", params.seed);
+    uint64_t nb_queries = args.get_uint("queries", 100000);
+    uint64_t repeat = std::max<uint64_t>(1, args.get_uint("repeat", 5));
+    uint64_t nb_threads = args.get_uint("threads", 0);
+    uint64_t queue_depth = std::max<uint64_t>(1, args.get_uint("queue_depth", 32));
+    uint64_t prefetch_chunks = std::max<uint64_t>(1, args.get_uint("prefetch", 8));
+    std::string filename = args.get("file", "kero_bench.kero");
+
+    Synthetic_data synthetic(params);
+    Json_object report;
+    report.set("benchmark", "kero_bench");
+
+    Json_object json_params;
+    json_params.set("k", params.k).set("m", params.m).set("max", params.max);
+    json_params.set("data_size", params.data_size).set("sections", params.nb_sections);
+    json_params.set("mean_skmers", params.mean_skmers).set("skew", params.skew).set("seed", params.seed);
+    json_params.set("queries", nb_queries).set("threads", nb_threads).set("queue_depth", queue_depth);
+    json_params.set("prefetch", prefetch_chunks);
+    report.set("params", json_params);
+
+    // --- Write ---
+    std::vector<Query> queries;
+    Timer timer;
+    {
+        Kero_file file(filename, "w");
+        file.write_encoding(0, 1, 3, 2);
+        synthetic.write(file, &queries, nb_queries / 2);
+        file.close();
+    }
+    double write_s = timer.elapsed_s();
+    uint64_t bytes = file_size(filename);
+
+    Json_object write;
+    write.set("seconds", write_s);
+    write.set("kmers_per_s", synthetic.nb_kmers / write_s);
+    write.set("skmers_per_s", synthetic.nb_skmers / write_s);
+    write.set("mb_per_s", bytes / write_s / 1e6);
+    report.set("write", write);
+
+    Json_object size;
+    size.set("bytes", bytes);
+    size.set("kmers", synthetic.nb_kmers);
+    size.set("skmers", synthetic.nb_skmers);
+    size.set("bytes_per_kmer", static_cast<double>(bytes) / synthetic.nb_kmers);
+    size.set("bits_per_kmer", 8.0 * bytes / synthetic.nb_kmers);
+    report.set("size", size);
+
+    // --- Scan k-mer by k-mer ---
+    {
+        timer.reset();
+        Kero_reader reader(filename);
+        uint8_t* kmer;
+        uint8_t* data;
+        uint64_t nb_kmers = 0;
+        while (reader.next_kmer(kmer, data))
+            nb_kmers += 1;
+        double scan_s = timer.elapsed_s();
+
+        Json_object scan;
+        scan.set("seconds", scan_s);
+        scan.set("kmers", nb_kmers);
+        scan.set("kmers_per_s", nb_kmers / scan_s);
+        scan.set("mb_per_s", bytes / scan_s / 1e6);
+        report.set("scan_kmer", scan);
+    }
+
+    // --- Same scan with the sections decoded ahead by a background thread ---
+    {
+        timer.reset();
+        Kero_reader reader(filename, prefetch_chunks);
+        uint8_t* kmer;
+        uint8_t* data;
+        uint64_t nb_kmers = 0;
+        while (reader.next_kmer(kmer, data))
+            nb_kmers += 1;
+        double scan_s = timer.elapsed_s();
+
+        Json_object scan;
+        scan.set("seconds", scan_s);
+        scan.set("kmers", nb_kmers);
+        scan.set("prefetch_chunks", prefetch_chunks);
+        scan.set("kmers_per_s", nb_kmers / scan_s);
+        scan.set("mb_per_s", bytes / scan_s / 1e6);
+        report.set("scan_kmer_prefetch", scan);
+    }
+
+    // --- Same scan through O_DIRECT windows, bypassing the page cache ---
+    {
+        timer.reset();
+        Kero_reader reader(filename);
+        bool direct = reader.file->use_direct_io();
+        uint8_t* kmer;
+        uint8_t* data;
+        uint64_t nb_kmers = 0;
+        while (reader.next_kmer(kmer, data))
+            nb_kmers += 1;
+        double scan_s = timer.elapsed_s();
+
+        Json_object scan;
+        scan.set("seconds", scan_s);
+        scan.set("kmers", nb_kmers);
+        scan.set("backend", direct ? "o_direct" : "page_cache_dropped");
+        scan.set("kmers_per_s", nb_kmers / scan_s);
+        scan.set("mb_per_s", bytes / scan_s / 1e6);
+        report.set("scan_kmer_direct", scan);
+    }
+
+    // --- Scan block by block ---
+    {
+        std::vector<uint8_t> seq_buffer(bytes_from_bit_array(2, params.k + params.max - 1));
+        std::vector<uint8_t> data_buffer(params.max * params.data_size + 1);
+        uint8_t* seq = seq_buffer.data();
+        uint8_t* data = data_buffer.data();
+
+        timer.reset();
+        Kero_reader reader(filename);
+        uint64_t nb_blocks = 0, nb_kmers = 0, block_kmers;
+        while ((block_kmers = reader.next_block(seq, data)) > 0) {
+            nb_blocks += 1;
+            nb_kmers += block_kmers;
+        }
+        double scan_s = timer.elapsed_s();
+
+        Json_object scan;
+        scan.set("seconds", scan_s);
+        scan.set("blocks", nb_blocks);
+        scan.set("blocks_per_s", nb_blocks / scan_s);
+        scan.set("kmers_per_s", nb_kmers / scan_s);
+        scan.set("mb_per_s", bytes / scan_s / 1e6);
+        report.set("scan_block", scan);
+    }
+
+    // --- Sorted loading: k-mer by k-mer then std::sort, against the parallel radix sort ---
+    if (params.k <= 32) {
+        timer.reset();
+        std::vector<std::pair<uint64_t, std::vector<uint8_t>>> entries;
+        {
+            Kero_reader reader(filename);
+            uint8_t* kmer;
+            uint8_t* data;
+            while (reader.next_kmer(kmer, data)) {
+                uint64_t value;
+                kero::sequence_to_kmers(kmer, params.k, params.k, &value);
+                entries.emplace_back(value, std::vector<uint8_t>(data, data + params.data_size));
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        double baseline_s = timer.elapsed_s();
+
+        kero::Sorted_options options;
+        options.nb_threads = nb_threads;
+        timer.reset();
+        kero::Sorted_kmers sorted = kero::load_sorted_kmers(filename, options);
+        double radix_s = timer.elapsed_s();
+
+        options.memory_limit = sorted.kmers.size() * (8 + params.data_size) / 4;
+        timer.reset();
+        kero::Sorted_kmers bounded = kero::load_sorted_kmers(filename, options);
+        double bounded_s = timer.elapsed_s();
+
+        uint64_t mismatches = 0;
+        for (uint64_t i = 0; i < entries.size() and i < sorted.kmers.size(); i++)
+            mismatches += entries[i].first != sorted.kmers[i] or entries[i].first != bounded.kmers[i];
+
+        Json_object load;
+        load.set("kmers", sorted.kmers.size());
+        load.set("next_kmer_std_sort_s", baseline_s);
+        load.set("radix_s", radix_s);
+        load.set("radix_kmers_per_s", sorted.kmers.size() / radix_s);
+        load.set("bounded_s", bounded_s);
+        load.set("bounded_passes", bounded.nb_passes);
+        load.set("mismatches", mismatches + (entries.size() != sorted.kmers.size()));
+        report.set("sorted_load", load);
+    }
+
+    // --- Open latency: header, footer and index, then hashtable ---
+    {
+        std::vector<uint64_t> open_ns, hashtable_ns;
+        for (uint64_t r = 0; r < repeat; r++) {
+            timer.reset();
+            Kero_file file(filename, "r");
+            open_ns.push_back(timer.elapsed_ns());
+            timer.reset();
+            file.hashtable_discovery();
+            hashtable_ns.push_back(timer.elapsed_ns());
+        }
+
+        Json_object open;
+        open.set("footer_index", latency_summary(open_ns));
+        open.set("hashtable", latency_summary(hashtable_ns));
+        report.set("open", open);
+    }
+
+    // --- Random lookups, half present and half absent ---
+    {
+        std::vector<Query> absent = synthetic.absent_queries(nb_queries - queries.size());
+        queries.insert(queries.end(), absent.begin(), absent.end());
+        std::shuffle(queries.begin(), queries.end(), std::mt19937_64(params.seed));
+
+        Kero_file file(filename, "r");
+        file.hashtable_discovery();
+        std::vector<uint8_t> data(params.data_size + 1);
+        std::vector<uint64_t> hit_ns, miss_ns;
+        uint64_t errors = 0;
+        kero::reset_lookup_profiles();
+        for (const Query& query : queries) {
+            timer.reset();
+            bool found = file.find_kmer(query.minimizer, query.kmer, data.data());
+            uint64_t ns = timer.elapsed_ns();
+            (found ? hit_ns : miss_ns).push_back(ns);
+            if (query.present and not found)
+                errors += 1;
+        }
+        std::vector<uint64_t> all_ns(hit_ns);
+        all_ns.insert(all_ns.end(), miss_ns.begin(), miss_ns.end());
+
+        Json_object lookup;
+        lookup.set("all", latency_summary(all_ns));
+        lookup.set("hit", latency_summary(hit_ns));
+        lookup.set("miss", latency_summary(miss_ns));
+        lookup.set("missing_present_kmers", errors);
+        report.set("lookup", lookup);
+
+#ifdef KERO_ENABLE_STATS
+        // Time of each stage of the lookups, without the nested stages
+        kero::Lookup_profile profile = kero::collect_lookup_profile();
+        Json_object stages;
+        for (uint8_t stage = 0; stage < kero::NB_LOOKUP_STAGES; stage++) {
+            const kero::Latency_histogram& histogram = profile.stages[stage];
+            Json_object summary;
+            summary.set("count", histogram.count());
+            summary.set("mean_ns", histogram.mean());
+            summary.set("p50_ns", histogram.percentile(50));
+            summary.set("p99_ns", histogram.percentile(99));
+            summary.set("p999_ns", histogram.percentile(99.9));
+            summary.set("max_ns", histogram.max());
+            stages.set(kero::lookup_stage_name(stage), summary);
+        }
+        report.set("lookup_stages", stages);
+#endif
+    }
+
+    // --- Batched lookups of the same queries ---
+    {
+        kero::Batch_options options;
+        options.queue_depth = queue_depth;
+        kero::Batch_lookup lookup(filename, options);
+        std::vector<kero::Kmer_query> batch;
+        for (const Query& query : queries)
+            batch.push_back({query.minimizer, query.kmer});
+
+        std::vector<uint8_t> found, data;
+        std::vector<uint64_t> batch_ns;
+        for (uint64_t r = 0; r < repeat; r++) {
+            timer.reset();
+            lookup.find_kmers(batch, found, &data);
+            batch_ns.push_back(timer.elapsed_ns());
+        }
+        uint64_t errors = 0;
+        for (uint64_t i = 0; i < queries.size(); i++)
+            errors += queries[i].present and not found[i];
+
+        std::sort(batch_ns.begin(), batch_ns.end());
+        double best_s = batch_ns.front() / 1e9;
+        Json_object json_batch;
+        json_batch.set("backend", lookup.backend_name());
+        json_batch.set("queue_depth", queue_depth);
+        json_batch.set("batch", latency_summary(batch_ns));
+        json_batch.set("queries_per_s", best_s > 0 ? queries.size() / best_s : 0.0);
+        json_batch.set("missing_present_kmers", errors);
+        report.set("batch_lookup", json_batch);
+    }
+
+    if (not args.has("keep"))
+        std::remove(filename.c_str());
+
+    if (args.has("output")) {
+        std::ofstream out(args.get("output", ""));
+        out << report.str() << std::endl;
+    } else {
+        std::cout << report.str() << std::endl;
+    }
+
+    return 0;
+}
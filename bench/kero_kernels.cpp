@@ -0,0 +1,207 @@
+/**
+* @file kero_kernels.cpp
+ *
+ * @brief Micro-benchmarks of the bit manipulation kernels used by every read and write.
+ *
+ * For each k and each super k-mer size (number of k-mers), the following kernels are timed on a pool
+ * of random super k-mers:
+ * - leftshift8 / rightshift8 over a whole super k-mer,
+ * - fusion8 over every byte of a super k-mer,
+ * - Section_Minimizer::add_minimizer (minimizer reinsertion when reading, copy of the input included),
+ * - Section_Minimizer::write_compacted_sequence (minimizer removal and buffering when writing),
+ * - prepare_shifts (the 4 alignments computed by Kero_reader for each block),
+ * - skmer_to_kmers (integer k-mers of a super k-mer stored without its minimizer, used by extract_kmers).
+ * The results are printed as JSON, in ns per super k-mer and ns per k-mer.
+ *
+ * Usage: kero_kernels [--k 21,31] [--m 11] [--n 1,4,8,16,21] [--iterations 200000] [--seed 42]
+ *                     [--file kero_kernels.kero] [--output results.json]
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+#include "bench_common.hpp"
+
+using namespace kero::bench;
+
+// Prevents the compiler from removing the benchmarked loops
+static volatile uint64_t sink;
+
+struct Kernel_input {
+    std::vector<uint8_t> seq;          // super k-mer with its minimizer
+    std::vector<uint8_t> seq_no_mini;  // super k-mer without its minimizer
+    uint64_t mini_pos;
+};
+
+static Json_object timing(uint64_t total_ns, uint64_t iterations, uint64_t nb_kmers) {
+    Json_object result;
+    double per_skmer = static_cast<double>(total_ns) / iterations;
+    result.set("ns_per_skmer", per_skmer);
+    result.set("ns_per_kmer", per_skmer / nb_kmers);
+    return result;
+}
+
+static Json_object bench_size(Kero_file& file, uint64_t k, uint64_t m, uint64_t n, uint64_t iterations,
+                              std::mt19937_64& rng) {
+    const uint64_t pool_size = 1024;
+    const uint64_t size = n + k - 1;
+    const uint64_t seq_bytes = bytes_from_bit_array(2, size);
+
+    // Random super k-mers where every k-mer contains the minimizer
+    std::vector<Kernel_input> pool(pool_size);
+    for (Kernel_input& input : pool) {
+        input.seq.resize(seq_bytes);
+        for (uint8_t& byte : input.seq)
+            byte = static_cast<uint8_t>(rng());
+        input.seq[0] &= 0xFF >> (2 * ((4 - size % 4) % 4));
+        input.seq_no_mini.resize(bytes_from_bit_array(2, size - m));
+        for (uint8_t& byte : input.seq_no_mini)
+            byte = static_cast<uint8_t>(rng());
+        input.seq_no_mini[0] &= 0xFF >> (2 * ((4 - (size - m) % 4) % 4));
+        input.mini_pos = n - 1 + rng() % (k - m - n + 2);
+    }
+    std::vector<uint8_t> work(seq_bytes);
+    std::vector<uint8_t> data(n);
+    uint64_t checksum = 0;
+    Json_object result;
+    Timer timer;
+
+    // --- Shifts of a whole super k-mer ---
+    memcpy(work.data(), pool[0].seq.data(), seq_bytes);
+    timer.reset();
+    for (uint64_t i = 0; i < iterations; i++)
+        kero::leftshift8(work.data(), seq_bytes, 2 * (1 + i % 3));
+    result.set("leftshift8", timing(timer.elapsed_ns(), iterations, n));
+    checksum += work[0];
+
+    memcpy(work.data(), pool[0].seq.data(), seq_bytes);
+    timer.reset();
+    for (uint64_t i = 0; i < iterations; i++)
+        kero::rightshift8(work.data(), seq_bytes, 2 * (1 + i % 3));
+    result.set("rightshift8", timing(timer.elapsed_ns(), iterations, n));
+    checksum += work[seq_bytes - 1];
+
+    // --- Byte fusions over a whole super k-mer ---
+    timer.reset();
+    for (uint64_t i = 0; i < iterations; i++) {
+        const std::vector<uint8_t>& seq = pool[i % pool_size].seq;
+        uint8_t acc = 0;
+        for (uint64_t b = 0; b < seq_bytes; b++)
+            acc ^= kero::fusion8(seq[b], acc, 2 * (1 + b % 3));
+        checksum += acc;
+    }
+    result.set("fusion8", timing(timer.elapsed_ns(), iterations, n));
+
+    // --- Minimizer reinsertion and removal ---
+    Section_Minimizer sm(&file);
+    std::vector<uint8_t> mini(sm.nb_bytes_mini);
+    for (uint8_t& byte : mini)
+        byte = static_cast<uint8_t>(rng());
+    mini[0] &= 0xFF >> (2 * ((4 - m % 4) % 4));
+    sm.write_minimizer(mini.data());
+
+    timer.reset();
+    for (uint64_t i = 0; i < iterations; i++) {
+        const Kernel_input& input = pool[i % pool_size];
+        memcpy(work.data(), input.seq_no_mini.data(), input.seq_no_mini.size());
+        sm.add_minimizer(n, work.data(), input.mini_pos);
+        checksum += work[0];
+    }
+    result.set("add_minimizer", timing(timer.elapsed_ns(), iterations, n));
+
+    timer.reset();
+    for (uint64_t i = 0; i < iterations; i++) {
+        Kernel_input& input = pool[i % pool_size];
+        sm.write_compacted_sequence(input.seq.data(), size, input.mini_pos, data.data());
+    }
+    result.set("write_compacted_sequence", timing(timer.elapsed_ns(), iterations, n));
+    sm.close();
+
+    // --- Kero_reader alignments of a block ---
+    std::vector<uint8_t> shift_buffers(3 * seq_bytes);
+    uint8_t* shifts[4] = {nullptr, shift_buffers.data(), shift_buffers.data() + seq_bytes,
+                          shift_buffers.data() + 2 * seq_bytes};
+    timer.reset();
+    for (uint64_t i = 0; i < iterations; i++) {
+        shifts[0] = pool[i % pool_size].seq.data();
+        kero::prepare_shifts(shifts, seq_bytes, n);
+        checksum += shifts[1][0];
+    }
+    result.set("prepare_shifts", timing(timer.elapsed_ns(), iterations, n));
+
+    // --- Bulk extraction of integer k-mers ---
+    std::vector<uint64_t> kmers(n);
+    uint64_t mini_value = kero::mask_mini(mini.data(), m);
+    timer.reset();
+    for (uint64_t i = 0; i < iterations; i++) {
+        const Kernel_input& input = pool[i % pool_size];
+        kero::skmer_to_kmers(input.seq_no_mini.data(), n, k, mini_value, m, input.mini_pos, kmers.data());
+        checksum += kmers[n - 1];
+    }
+    result.set("skmer_to_kmers", timing(timer.elapsed_ns(), iterations, n));
+
+    sink = checksum;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    Args args(argc, argv);
+
+    std::vector<uint64_t> k_values = args.get_uint_list("k", "21,31");
+    uint64_t m = args.get_uint("m", 11);
+    std::vector<uint64_t> n_values = args.get_uint_list("n", "1,4,8,16,21");
+    uint64_t iterations = std::max<uint64_t>(1, args.get_uint("iterations", 200000));
+    uint64_t seed = args.get_uint("seed", 42);
+    std::string filename = args.get("file", "kero_kernels.kero");
+    std::mt19937_64 rng(seed);
+
+    Json_object report;
+    report.set("benchmark", "kero_kernels");
+    Json_object json_params;
+    json_params.set("m", m).set("iterations", iterations).set("seed", seed);
+    report.set("params", json_params);
+
+    Json_object kernels;
+    for (uint64_t k : k_values) {
+        if (k > 32 or m >= k)
+            throw std::invalid_argument("The kernels need m < k <= 32");
+        uint64_t max = k - m + 1;
+
+        // write_compacted_sequence needs a minimizer section, hence a file
+        Kero_file file(filename, "w");
+        file.write_encoding(0, 1, 3, 2);
+        Section_GV sgv(&file);
+        sgv.write_var("k", k);
+        sgv.write_var("m", m);
+        sgv.write_var("max", max);
+        sgv.write_var("data_size", 1);
+        sgv.write_var("layout", file.layout);
+        sgv.close();
+
+        for (uint64_t n : n_values) {
+            if (n == 0 or n > max)
+                continue;
+            kernels.set("k" + std::to_string(k) + "_n" + std::to_string(n),
+                        bench_size(file, k, m, n, iterations, rng));
+        }
+        file.close();
+    }
+    std::remove(filename.c_str());
+    report.set("kernels", kernels);
+
+    if (args.has("output")) {
+        std::ofstream out(args.get("output", ""));
+        out << report.str() << std::endl;
+    } else {
+        std::cout << report.str() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+/**
+* @file synthetic.hpp
+ *
+ * @brief Synthetic minimizer sections for the kero benchmarks.
+ *
+ * The generator draws random super k-mers around a set of random minimizers.
+ * The number of super k-mers per minimizer follows a Zipf law of parameter skew
+ * (0 gives the same size to all the sections).
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+namespace bench {
+
+    struct Synthetic_params {
+        uint64_t k = 31;
+        uint64_t m = 11;
+        uint64_t max = 21;              // max k-mers per super k-mer
+        uint64_t data_size = 1;
+        uint64_t nb_sections = 10000;
+        uint64_t mean_skmers = 16;      // mean number of super k-mers per section
+        double skew = 0.0;              // Zipf parameter of the section sizes
+        uint64_t seed = 42;
+    };
+
+    struct Query {
+        uint64_t minimizer;
+        uint64_t kmer;
+        bool present;
+    };
+
+    class Synthetic_data {
+    private:
+        std::mt19937_64 rng;
+
+        uint64_t random_nucleotides(uint64_t size) {
+            return size >= 32 ? rng() : rng() & get_mini_mask(size);
+        }
+
+        // Pack size nucleotides of a 2-bit array right aligned in bytes.
+        static void pack(const std::vector<uint8_t>& nucl, uint64_t size, std::vector<uint8_t>& out) {
+            out.assign(bytes_from_bit_array(2, size), 0);
+            uint64_t offset = (4 - size % 4) % 4;
+            for (uint64_t i = 0; i < size; i++) {
+                uint64_t pos = offset + i;
+                out[pos / 4] |= static_cast<uint8_t>(nucl[i] << (6 - 2 * (pos % 4)));
+            }
+        }
+
+    public:
+        Synthetic_params params;
+        std::vector<uint64_t> minimizers;       // one per section
+        std::vector<uint64_t> section_skmers;   // number of super k-mers of each section
+        uint64_t nb_skmers = 0;
+        uint64_t nb_kmers = 0;
+
+        explicit Synthetic_data(const Synthetic_params& params) : rng(params.seed), params(params) {
+            if (params.k > 32 or params.m >= params.k or params.m == 0)
+                throw std::invalid_argument("Synthetic data needs 0 < m < k <= 32");
+            if (params.m < 32 and params.nb_sections > (1ull << (2 * params.m)))
+                throw std::invalid_argument("Not enough distinct minimizers for the number of sections");
+
+            std::unordered_set<uint64_t> used;
+            while (minimizers.size() < params.nb_sections) {
+                uint64_t mini = random_nucleotides(params.m);
+                if (used.insert(mini).second)
+                    minimizers.push_back(mini);
+            }
+
+            // Zipf distributed section sizes, scaled to the requested mean
+            std::vector<double> weights(params.nb_sections);
+            double total = 0;
+            for (uint64_t i = 0; i < params.nb_sections; i++) {
+                weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), params.skew);
+                total += weights[i];
+            }
+            double scale = static_cast<double>(params.nb_sections * params.mean_skmers) / total;
+            for (uint64_t i = 0; i < params.nb_sections; i++) {
+                auto size = std::max<uint64_t>(1, static_cast<uint64_t>(weights[i] * scale + 0.5));
+                section_skmers.push_back(size);
+                nb_skmers += size;
+            }
+        }
+
+        /**
+         * @brief Write the global variables and all the minimizer sections.
+         * The sections use the layout of the file, which is also recorded as a global variable.
+         *
+         * @param file A file opened in w mode.
+         * @param samples If not null, filled with up to nb_samples k-mers of the file.
+         * @param nb_samples Number of present k-mers to sample.
+         */
+        void write(Kero_file& file, std::vector<Query>* samples = nullptr, uint64_t nb_samples = 0) {
+            const uint64_t k = params.k, m = params.m;
+
+            Section_GV sgv(&file);
+            sgv.write_var("k", k);
+            sgv.write_var("m", m);
+            sgv.write_var("max", params.max);
+            sgv.write_var("data_size", params.data_size);
+            sgv.write_var("layout", file.layout);
+            sgv.close();
+
+            uint64_t nb_bytes_mini = bytes_from_bit_array(2, m);
+            uint64_t max_kmers = std::min(params.max, k - m + 1);
+            std::vector<uint8_t> mini_bytes(nb_bytes_mini);
+            std::vector<uint8_t> nucl(k + max_kmers);
+            std::vector<uint8_t> packed;
+            std::vector<uint8_t> data(max_kmers * params.data_size + 1);
+            uint64_t seen = 0;
+            nb_kmers = 0;
+
+            for (uint64_t s = 0; s < minimizers.size(); s++) {
+                Section_Minimizer sm(&file);
+                store_big_endian(mini_bytes.data(), nb_bytes_mini, minimizers[s]);
+                sm.write_minimizer(mini_bytes.data());
+
+                for (uint64_t b = 0; b < section_skmers[s]; b++) {
+                    // Every k-mer of the super k-mer must contain the minimizer
+                    uint64_t n = 1 + rng() % max_kmers;
+                    uint64_t size = n + k - 1;
+                    uint64_t mini_pos = n - 1 + rng() % (k - m - n + 2);
+
+                    // Sequence without the minimizer: prefix then suffix
+                    for (uint64_t i = 0; i < size - m; i++)
+                        nucl[i] = rng() & 0b11;
+                    pack(nucl, size - m, packed);
+                    for (uint64_t i = 0; i < n * params.data_size; i++)
+                        data[i] = static_cast<uint8_t>(rng());
+                    sm.write_compacted_sequence_without_mini(packed.data(), size - m, mini_pos, data.data());
+
+                    // Reservoir sampling of one k-mer per super k-mer
+                    if (samples != nullptr and nb_samples > 0) {
+                        uint64_t slot = samples->size() < nb_samples ? samples->size() : rng() % (seen + 1);
+                        if (slot < nb_samples) {
+                            uint64_t idx = rng() % n;
+                            uint64_t kmer = 0;
+                            for (uint64_t i = idx; i < idx + k; i++) {
+                                uint64_t value;
+                                if (i < mini_pos)
+                                    value = nucl[i];
+                                else if (i < mini_pos + m)
+                                    value = (minimizers[s] >> (2 * (mini_pos + m - 1 - i))) & 0b11;
+                                else
+                                    value = nucl[i - m];
+                                kmer = (kmer << 2) | value;
+                            }
+                            Query query{minimizers[s], kmer, true};
+                            if (slot == samples->size())
+                                samples->push_back(query);
+                            else
+                                (*samples)[slot] = query;
+                        }
+                    }
+                    seen += 1;
+                    nb_kmers += n;
+                }
+
+                sm.close();
+            }
+        }
+
+        /**
+         * @brief Random k-mers, almost surely absent from the file.
+         * Half of them use a minimizer of the file, the other half a random minimizer.
+         */
+        std::vector<Query> absent_queries(uint64_t nb_queries) {
+            std::vector<Query> queries;
+            for (uint64_t i = 0; i < nb_queries; i++) {
+                uint64_t mini = i % 2 == 0 ? minimizers[rng() % minimizers.size()] : random_nucleotides(params.m);
+                queries.push_back({mini, random_nucleotides(params.k), false});
+            }
+            return queries;
+        }
+    };
+
+} // namespace bench
+} // namespace kero
@@ -0,0 +1,84 @@
+/**
+* @file chain.hpp
+ *
+ * @brief This file defines the chaining of the k-mers of a partition into blocks, shared by the unitig
+ * compaction and the store.
+ *
+ * The callers link the k-mers (unitigs or super k-mers); the paths are then cut into blocks of at most
+ * limit k-mers and packed like the blocks of a kero file.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace kero {
+
+    // No k-mer (end of a chain, absent k-mer)
+    constexpr uint64_t NO_LINK = UINT64_MAX;
+
+    /**
+     * Blocks built from the k-mers of a partition, stored back to back.
+     */
+    struct Chain_blocks {
+        std::vector<uint64_t> nb_kmers;     // Number of k-mers of each block
+        std::vector<uint64_t> mini_pos;     // Position of the minimizer in each block, when m > 0
+        std::vector<uint8_t> seqs;          // Sequences, 2 bits per nucleotide and right aligned
+        std::vector<uint8_t> data;          // Data of the k-mers, data_size bytes each
+
+        /**
+         * Append the block made of the k-mers kmers[path[0..size)], each one following the previous one.
+         * When m > 0, the m nucleotides of the minimizer at mini_pos are left out of the sequence.
+         *
+         * @param kmers K-mers of the partition (2 bits per nucleotide).
+         * @param kmer_data Data of the k-mers of the partition, data_size bytes each.
+         */
+        void append(const std::vector<uint64_t>& kmers, const std::vector<uint8_t>& kmer_data, const uint64_t* path,
+                    uint64_t size, uint64_t k, uint64_t data_size, uint64_t m = 0, uint64_t mini_pos = 0);
+
+        bool empty() const { return nb_kmers.empty(); }
+    };
+
+    /**
+     * Walk the chains of nb_kmers k-mers, first from the k-mers without predecessor, then from the
+     * remaining ones (cycles, or predecessors taken by another chain). Every k-mer is visited once.
+     *
+     * @param has_prev True for the k-mers that another k-mer links to.
+     * @param limit Maximal number of k-mers of a block, a longer chain continues in the next block.
+     * @param next next(current, visited) gives the k-mer following current, or NO_LINK. A visited k-mer
+     * ends the chain.
+     * @param emit emit(path, size) receives the blocks, in the order of the chains.
+     */
+    template<typename Next, typename Emit>
+    void walk_chains(uint64_t nb_kmers, const std::vector<bool>& has_prev, uint64_t limit, Next next, Emit emit) {
+        std::vector<bool> visited(nb_kmers, false);
+        std::vector<uint64_t> path;
+        auto walk = [&](uint64_t start) {
+            path.clear();
+            uint64_t current = start;
+            while (current != NO_LINK and not visited[current]) {
+                visited[current] = true;
+                path.push_back(current);
+                if (path.size() == limit) {
+                    emit(path.data(), path.size());
+                    path.clear();
+                }
+                current = next(current, visited);
+            }
+            if (not path.empty())
+                emit(path.data(), path.size());
+        };
+
+        for (uint64_t i = 0; i < nb_kmers; i++) {
+            if (not has_prev[i])
+                walk(i);
+        }
+        for (uint64_t i = 0; i < nb_kmers; i++) {
+            if (not visited[i])
+                walk(i);
+        }
+    }
+
+} // namespace kero
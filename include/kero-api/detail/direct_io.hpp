@@ -0,0 +1,74 @@
+/**
+* @file direct_io.hpp
+ *
+ * @brief This file defines the direct I/O reads of Kero_file (see Kero_file::use_direct_io).
+ *
+ * The file is read through O_DIRECT into large aligned windows that are reused for the whole scan,
+ * so a full scan does not fill the page cache. While the consumer reads a window, the next one is
+ * read in the background.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <string>
+
+namespace kero {
+
+    // Alignment of the offsets, sizes and buffers of the direct reads
+    constexpr uint64_t DIRECT_ALIGNMENT = 4096;
+    // Default size of a window
+    constexpr uint64_t DIRECT_WINDOW_BYTES = 8ull << 20;
+
+    class Direct_reader {
+    private:
+        struct Window {
+            uint8_t* buffer = nullptr;
+            uint64_t start = 0;
+            uint64_t length = 0;  // Valid bytes, shorter than the window at the end of the file
+        };
+
+        int fd;
+        bool direct;
+        uint64_t file_size;
+        uint64_t window_bytes;
+
+        Window current;
+        Window ahead;
+        // Read of the ahead window in flight
+        std::future<uint64_t> ahead_read;
+
+        uint64_t load(uint8_t* buffer, uint64_t start) const;
+        void start_ahead();
+        void wait_ahead();
+        // Make the current window contain position
+        void move_to(uint64_t position);
+
+    public:
+        /**
+         * Open the file with O_DIRECT. When the filesystem refuses O_DIRECT (tmpfs for instance), the file
+         * is read through the page cache and the pages of every window are dropped once copied.
+         *
+         * @param filename File to read.
+         * @param file_size Size of the file in bytes.
+         * @param window_bytes Size of each of the two windows, rounded up to DIRECT_ALIGNMENT.
+         */
+        Direct_reader(const std::string& filename, uint64_t file_size, uint64_t window_bytes = DIRECT_WINDOW_BYTES);
+        ~Direct_reader();
+        Direct_reader(const Direct_reader&) = delete;
+        Direct_reader& operator=(const Direct_reader&) = delete;
+
+        /**
+         * @return true if the file is read with O_DIRECT, false for the page cache fallback.
+         */
+        bool is_direct() const { return direct; }
+
+        /**
+         * Copy size bytes of the file from position.
+         */
+        void read(uint8_t* bytes, uint64_t size, uint64_t position);
+    };
+
+} // namespace kero
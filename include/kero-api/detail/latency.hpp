@@ -0,0 +1,142 @@
+/**
+* @file latency.hpp
+ *
+ * @brief This file defines the latency histograms of the lookup path (Kero_file::find_kmer).
+ *
+ * Every thread records into its own histograms, without locks. The histograms of all the threads
+ * are merged on demand by collect_lookup_profile().
+ * A lookup is split into stages: hashtable probe, section header read, column decode and super k-mer
+ * scan. Each stage records its own time, without the time of the stages nested in it, while the
+ * lookup stage records the whole find_kmer call.
+ *
+ * As the counters of stats.hpp, the spans are only compiled with KERO_ENABLE_STATS. When the logfault
+ * level is TRACE, each span is also emitted as a trace line.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace kero {
+
+    enum Lookup_stage : uint8_t {
+        LOOKUP_TOTAL = 0,
+        LOOKUP_HASHTABLE_PROBE,
+        LOOKUP_SECTION_HEADER,
+        LOOKUP_COLUMN_DECODE,
+        LOOKUP_SKMER_SCAN,
+        NB_LOOKUP_STAGES
+    };
+
+    /**
+     * @return The name of a lookup stage ("lookup", "hashtable_probe", "section_header", "column_decode"
+     * or "skmer_scan").
+     */
+    const char* lookup_stage_name(uint8_t stage);
+
+    /**
+     * Log-linear histogram of durations in ns (HDR style): each power of 2 is split into 16 buckets,
+     * so the values are kept with a relative precision of 1/16.
+     * Only one thread records into a histogram, but any thread can read or merge it.
+     */
+    class Latency_histogram {
+    public:
+        static constexpr uint64_t SUB_BUCKET_BITS = 4;
+        static constexpr uint64_t SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+        static constexpr uint64_t NB_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    private:
+        std::atomic<uint64_t> counts[NB_BUCKETS];
+        std::atomic<uint64_t> total_count;
+        std::atomic<uint64_t> total_ns;
+        std::atomic<uint64_t> max_ns;
+
+        static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+    public:
+        Latency_histogram();
+        Latency_histogram(const Latency_histogram& other);
+        Latency_histogram& operator=(const Latency_histogram& other);
+
+        static uint64_t bucket_index(uint64_t value);
+        // Highest value that falls into the bucket
+        static uint64_t bucket_value(uint64_t index);
+
+        // Must only be called by the owner thread
+        void record(uint64_t ns) {
+            add(counts[bucket_index(ns)], 1);
+            add(total_count, 1);
+            add(total_ns, ns);
+            if (ns > max_ns.load(std::memory_order_relaxed))
+                max_ns.store(ns, std::memory_order_relaxed);
+        }
+
+        // Add the values of other into this histogram
+        void merge(const Latency_histogram& other);
+        void reset();
+
+        uint64_t count() const;
+        uint64_t max() const;
+        double mean() const;
+        /**
+         * @param p Percentile in [0, 100].
+         * @return An upper bound of the p-th percentile, at the precision of the buckets.
+         */
+        uint64_t percentile(double p) const;
+    };
+
+    struct Lookup_profile {
+        Latency_histogram stages[NB_LOOKUP_STAGES];
+
+        void merge(const Lookup_profile& other);
+        void reset();
+    };
+
+    /**
+     * @return The profile of the calling thread, registered on first use. At the end of the thread, the
+     * profile is added to the sum of the finished threads and released.
+     */
+    Lookup_profile& thread_lookup_profile();
+    /**
+     * @return The sum of the profiles of all the threads (including the finished ones).
+     */
+    Lookup_profile collect_lookup_profile();
+    void reset_lookup_profiles();
+
+    /**
+     * Times a stage from its construction to end() or its destruction.
+     * Stages other than LOOKUP_TOTAL are only recorded inside a lookup, so scanning a file does not
+     * fill the histograms.
+     */
+    class Latency_span {
+    private:
+        static thread_local Latency_span* current;
+
+        Latency_span* parent;
+        uint64_t start_ns;
+        uint64_t nested_ns;
+        uint8_t stage;
+        bool active;
+
+    public:
+        explicit Latency_span(uint8_t stage);
+        ~Latency_span();
+        Latency_span(const Latency_span&) = delete;
+        Latency_span& operator=(const Latency_span&) = delete;
+
+        void end();
+    };
+
+} // namespace kero
+
+#ifdef KERO_ENABLE_STATS
+#define KERO_LATENCY_SPAN(name, stage) kero::Latency_span name(stage)
+#define KERO_LATENCY_SPAN_END(name) name.end()
+#else
+#define KERO_LATENCY_SPAN(name, stage) ((void)0)
+#define KERO_LATENCY_SPAN_END(name) ((void)0)
+#endif
@@ -0,0 +1,200 @@
+/**
+* @file layout.hpp
+ *
+ * @brief This file defines the storage layouts of the minimizer sections ('M').
+ *
+ * Three layouts are available:
+ * - Row: each super k-mer is written as [n:8B][m_idx:8B][seq][data], nothing is buffered.
+ * - Columnar without compression: the n, m_idx, data and seq columns are written one after the other.
+ * - Columnar with compression (default): same as above with the integer columns compressed by TurboPFor.
+ *
+ * The layouts are policy classes used by Section_Minimizer. The columnar layouts share their code
+ * and only differ by the codec of the integer columns.
+ *
+ * The columns are encoded and decoded by chunks, so a section never needs more memory than the budget
+ * of its file (Kero_file::section_budget): the columnar readers decode the next chunk of a column when
+ * the previous one is consumed, and the columnar writers spill their buffers to temporary files when
+ * they exceed the budget. The chunks hold a multiple of 256 values, so the p4n encoding of a column
+ * by chunks is the same as the encoding of the whole column.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class Kero_file;
+class Section_Minimizer;
+
+enum Kero_layout : uint8_t {
+    KERO_LAYOUT_ROW = 0,
+    KERO_LAYOUT_COLUMNAR_NOCOMP = 1,
+    KERO_LAYOUT_COLUMNAR_COMP = 2,
+};
+
+// The default layout can still be selected at compile time
+#if defined(KERO_MODE_ROW)
+#define KERO_DEFAULT_LAYOUT KERO_LAYOUT_ROW
+#elif defined(KERO_MODE_COLUMNAR_NOCOMP)
+#define KERO_DEFAULT_LAYOUT KERO_LAYOUT_COLUMNAR_NOCOMP
+#else
+#define KERO_DEFAULT_LAYOUT KERO_LAYOUT_COLUMNAR_COMP
+#endif
+
+// Default memory budget in bytes of a minimizer section (0: unbounded)
+#ifndef KERO_DEFAULT_SECTION_BUDGET
+#define KERO_DEFAULT_SECTION_BUDGET (256ull << 20)
+#endif
+
+namespace kero {
+
+    // Number of values of the column chunks are multiple of this value
+    constexpr uint64_t COLUMN_CHUNK_ALIGN = 256;
+
+    /**
+     * Position of a column being decoded chunk by chunk.
+     * The compressed bytes read ahead and not decoded yet are kept in window[begin..end).
+     */
+    struct Column_cursor {
+        uint64_t position = 0;          // File position of the next bytes to read
+        uint64_t remaining_bytes = 0;   // Bytes of the column not read yet
+        uint64_t remaining_values = 0;  // Values not decoded yet
+        std::vector<uint8_t> window;
+        uint64_t begin = 0;
+        uint64_t end = 0;
+    };
+
+    /**
+     * Uncompressed columns.
+     * Integer column: [bytes: 8B][values: 8B big endian each]
+     * Byte column: [size: 8B][bytes]
+     */
+    struct Plain_codec {
+        static void write_u64(Kero_file* file, std::vector<uint64_t>& values);
+        static void read_u64(Kero_file* file, uint64_t count, std::vector<uint64_t>& values);
+        static void load_u64(const uint8_t* column, uint64_t count, std::vector<uint64_t>& values);
+        static void write_u8(Kero_file* file, std::vector<uint8_t>& values);
+        static void read_u8(Kero_file* file, std::vector<uint8_t>& values);
+        static void load_u8(const uint8_t* column, std::vector<uint8_t>& values);
+
+        // Chunked writing: begin returns the position of the column header, backfilled by end.
+        static uint64_t begin_u64(Kero_file* file);
+        static uint64_t encode_u64(Kero_file* file, uint64_t* values, uint64_t count);
+        static void end_u64(Kero_file* file, uint64_t header, uint64_t count, uint64_t bytes);
+        static uint64_t begin_u8(Kero_file* file);
+        static uint64_t encode_u8(Kero_file* file, uint8_t* values, uint64_t count);
+        static void end_u8(Kero_file* file, uint64_t header, uint64_t count, uint64_t bytes);
+
+        // Chunked reading: the values are appended to the vector.
+        static void open_u64(Kero_file* file, uint64_t position, uint64_t count, Column_cursor& cursor);
+        static void decode_u64(Kero_file* file, Column_cursor& cursor, uint64_t count, std::vector<uint64_t>& values);
+        static void open_u8(Kero_file* file, uint64_t position, Column_cursor& cursor);
+        static void decode_u8(Kero_file* file, Column_cursor& cursor, uint64_t count, std::vector<uint8_t>& values);
+    };
+
+    /**
+     * TurboPFor compressed columns.
+     * Integer column: [compressed size: 8B][p4n compressed values]
+     * Byte column: [size: 8B][compressed size: 8B][p4n compressed bytes]
+     */
+    struct P4n_codec {
+        static void write_u64(Kero_file* file, std::vector<uint64_t>& values);
+        static void read_u64(Kero_file* file, uint64_t count, std::vector<uint64_t>& values);
+        static void load_u64(const uint8_t* column, uint64_t count, std::vector<uint64_t>& values);
+        static void write_u8(Kero_file* file, std::vector<uint8_t>& values);
+        static void read_u8(Kero_file* file, std::vector<uint8_t>& values);
+        static void load_u8(const uint8_t* column, std::vector<uint8_t>& values);
+
+        // Chunked writing and reading, see Plain_codec. count must be a multiple of COLUMN_CHUNK_ALIGN,
+        // except for the last chunk of a column.
+        static uint64_t begin_u64(Kero_file* file);
+        static uint64_t encode_u64(Kero_file* file, uint64_t* values, uint64_t count);
+        static void end_u64(Kero_file* file, uint64_t header, uint64_t count, uint64_t bytes);
+        static uint64_t begin_u8(Kero_file* file);
+        static uint64_t encode_u8(Kero_file* file, uint8_t* values, uint64_t count);
+        static void end_u8(Kero_file* file, uint64_t header, uint64_t count, uint64_t bytes);
+
+        static void open_u64(Kero_file* file, uint64_t position, uint64_t count, Column_cursor& cursor);
+        static void decode_u64(Kero_file* file, Column_cursor& cursor, uint64_t count, std::vector<uint64_t>& values);
+        static void open_u8(Kero_file* file, uint64_t position, Column_cursor& cursor);
+        static void decode_u8(Kero_file* file, Column_cursor& cursor, uint64_t count, std::vector<uint8_t>& values);
+    };
+
+    /**
+     * Temporary files of the columns of a minimizer section being written, used once its buffers exceed
+     * the budget of the file. The values are stored raw, in the order of the super k-mers.
+     * The files are created next to the kero file, or in TMPDIR for the streams and the in-memory files,
+     * with unique names (see create_temp_file), and removed on destruction.
+     */
+    class Section_spill {
+    public:
+        enum Spill_column { N = 0, M_IDX, DATA, SEQ, NB_COLUMNS };
+
+    private:
+        std::string paths[NB_COLUMNS];
+        std::fstream streams[NB_COLUMNS];
+        uint64_t sizes[NB_COLUMNS] = {};
+
+        void remove_files();
+
+    public:
+        /**
+         * @param directory Directory of the files, TMPDIR when empty.
+         * @param name Beginning of the file names.
+         */
+        Section_spill(const std::string& directory, const std::string& name);
+        ~Section_spill();
+        Section_spill(const Section_spill&) = delete;
+        Section_spill& operator=(const Section_spill&) = delete;
+
+        void append(Spill_column column, const uint8_t* bytes, uint64_t size);
+        // Go back to the beginning of the files before reading them
+        void rewind();
+        void read(Spill_column column, uint8_t* bytes, uint64_t size);
+        // Bytes written into a column
+        uint64_t size(Spill_column column) const { return sizes[column]; }
+    };
+
+    /**
+     * Columnar layouts: the super k-mers are buffered and written column by column on close.
+     */
+    template<class Codec>
+    struct Columnar_layout {
+        // Move the buffers to the spill files when they exceed the budget of the file
+        static void spill_buffers(Section_Minimizer& sm);
+        static void write_columns(Section_Minimizer& sm);
+        static uint64_t read_compacted_sequence_without_mini(Section_Minimizer& sm, uint8_t* seq, uint8_t* data,
+                                                             uint64_t& mini_pos);
+        static void precache_columns_from_mmap(Section_Minimizer& sm, const uint8_t* mmap_ptr);
+        // Position of the first byte after the section: only the n column is decoded, by chunks
+        static uint64_t section_end(Section_Minimizer& sm);
+    };
+
+    using Columnar_nocomp_layout = Columnar_layout<Plain_codec>;
+    using Columnar_comp_layout = Columnar_layout<P4n_codec>;
+
+    /**
+     * Row layout: the header is written with the minimizer and the super k-mers are written directly.
+     * The number of super k-mers is backfilled on close.
+     */
+    struct Row_layout {
+        static void write_minimizer(Section_Minimizer& sm);
+        static void write_compacted_sequence_without_mini(Section_Minimizer& sm, uint8_t* seq, uint64_t seq_size,
+                                                          uint64_t mini_pos, uint8_t* data_array);
+        static void close(Section_Minimizer& sm);
+        static uint64_t read_compacted_sequence_without_mini(Section_Minimizer& sm, uint8_t* seq, uint8_t* data,
+                                                             uint64_t& mini_pos);
+        static void precache_columns_from_mmap(Section_Minimizer& sm, const uint8_t* mmap_ptr);
+        // Position of the first byte after the section: only the n field of the rows is read
+        static uint64_t section_end(Section_Minimizer& sm);
+    };
+
+    /**
+     * @return The name of a layout ("row", "columnar_nocomp" or "columnar_comp").
+     */
+    const char* layout_name(uint8_t layout);
+
+} // namespace kero
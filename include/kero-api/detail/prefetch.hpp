@@ -0,0 +1,125 @@
+/**
+* @file prefetch.hpp
+ *
+ * @brief This file defines the read-ahead of the sequence sections used by Kero_reader.
+ *
+ * A background thread walks the file through its own Kero_file and decodes the blocks of the next
+ * sequence sections into a bounded queue of chunks, while the consumer processes the current one.
+ * The thread also asks the kernel to read ahead of it (POSIX_FADV_WILLNEED).
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+
+namespace kero {
+
+    // Decoded bytes after which the blocks of a section are cut into a new chunk
+    constexpr uint64_t PREFETCH_CHUNK_BYTES = 4ull << 20;
+    // Bytes of the file announced to the kernel ahead of the read-ahead thread
+    constexpr uint64_t PREFETCH_ADVISE_BYTES = 16ull << 20;
+
+    /**
+     * Consecutive decoded blocks of a section. Each block is [nb k-mers: 8B][seq][data], as given by
+     * Block_section_reader::read_compacted_sequence(seq_data).
+     */
+    struct Prefetch_chunk {
+        bool first = false;  // First chunk of a section
+        // First chunk only: blocks of the section
+        uint64_t section_blocks = 0;
+        // First chunk of the first section after a global variable section: the new variables
+        bool new_vars = false;
+        std::unordered_map<std::string, uint64_t> vars;
+
+        uint64_t nb_blocks = 0;
+        std::vector<uint8_t> bytes;
+    };
+
+    class Section_prefetcher;
+
+    /**
+     * A sequence section served from the chunks decoded by a Section_prefetcher.
+     */
+    class Prefetched_section : public Block_section_reader {
+    private:
+        Section_prefetcher* prefetcher;
+        Prefetch_chunk chunk;
+        uint64_t chunk_offset;
+        uint64_t chunk_remaining;
+
+        // Position the next block at chunk_offset, waiting for the next chunk if needed
+        const uint8_t* next_block(uint64_t& nb_kmers, uint64_t& seq_bytes);
+
+    public:
+        // Variables of the section when they differ from the ones of the previous section
+        bool new_vars;
+        std::unordered_map<std::string, uint64_t> vars;
+
+        /**
+         * @param k, max, data_size Sizes of the previous section, used when the variables did not change.
+         */
+        Prefetched_section(Section_prefetcher* prefetcher, Prefetch_chunk&& first_chunk, uint64_t k, uint64_t max,
+                           uint64_t data_size);
+
+        uint64_t read_compacted_sequence(uint8_t* seq, uint8_t* data) override;
+        uint64_t read_compacted_sequence(uint8_t* seq_data) override;
+        void jump_sequence() override;
+    };
+
+    class Section_prefetcher {
+    private:
+        std::string filename;
+        uint64_t capacity;
+
+        std::mutex mutex;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+        std::deque<Prefetch_chunk> queue;
+        bool producer_done;
+        bool stopping;
+        std::exception_ptr error;
+        std::thread thread;
+
+        void run();
+        // Blocks while the queue is full. Returns false when the prefetcher stops.
+        bool push(Prefetch_chunk&& chunk);
+
+    public:
+        /**
+         * Start the read-ahead thread.
+         *
+         * @param filename Kero file to read.
+         * @param nb_chunks Capacity of the queue, in chunks (a section smaller than PREFETCH_CHUNK_BYTES is
+         * one chunk).
+         */
+        Section_prefetcher(const std::string& filename, uint64_t nb_chunks);
+        ~Section_prefetcher();
+        Section_prefetcher(const Section_prefetcher&) = delete;
+        Section_prefetcher& operator=(const Section_prefetcher&) = delete;
+
+        /**
+         * Wait for the next chunk. Rethrows the error of the read-ahead thread, if any.
+         *
+         * @return false at the end of the file.
+         */
+        bool pop(Prefetch_chunk& chunk);
+
+        /**
+         * @param k, max, data_size Sizes of the previous section, kept if the variables did not change.
+         * @return The next sequence section (to delete by the caller) or nullptr at the end of the file.
+         */
+        Prefetched_section* next_section(uint64_t k, uint64_t max, uint64_t data_size);
+    };
+
+} // namespace kero
@@ -0,0 +1,82 @@
+/**
+* @file stats.hpp
+ *
+ * @brief This file defines the optional I/O and decoding counters of the kero files.
+ *
+ * The counters are only updated when the library is compiled with KERO_ENABLE_STATS
+ * (cmake -DKERO_ENABLE_STATS=ON). Otherwise the macros below expand to nothing and the
+ * counters stay at 0.
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace kero {
+
+    struct Kero_stats {
+        // Calls to the underlying file stream
+        uint64_t bytes_read = 0;
+        uint64_t bytes_written = 0;
+        uint64_t read_calls = 0;
+        uint64_t write_calls = 0;
+        uint64_t seek_calls = 0;
+        uint64_t buffer_flushes = 0;           // Kero_file::write buffer spills to the disk
+        uint64_t spilled_bytes = 0;            // Minimizer section buffers moved to temporary files
+
+        // Decoded bytes of the minimizer section columns
+        uint64_t n_column_bytes = 0;
+        uint64_t m_idx_column_bytes = 0;
+        uint64_t data_column_bytes = 0;
+        uint64_t seq_column_bytes = 0;
+        uint64_t decode_ns = 0;                // integer and data columns decoding
+
+        uint64_t minimizer_reinsertions = 0;
+        uint64_t minimizer_reinsertion_ns = 0;
+
+        uint64_t mphf_lookups = 0;
+        uint64_t mphf_ns = 0;
+
+        void reset() {
+            *this = Kero_stats();
+        }
+
+        Kero_stats& operator+=(const Kero_stats& other) {
+            bytes_read += other.bytes_read;
+            bytes_written += other.bytes_written;
+            read_calls += other.read_calls;
+            write_calls += other.write_calls;
+            seek_calls += other.seek_calls;
+            buffer_flushes += other.buffer_flushes;
+            spilled_bytes += other.spilled_bytes;
+            n_column_bytes += other.n_column_bytes;
+            m_idx_column_bytes += other.m_idx_column_bytes;
+            data_column_bytes += other.data_column_bytes;
+            seq_column_bytes += other.seq_column_bytes;
+            decode_ns += other.decode_ns;
+            minimizer_reinsertions += other.minimizer_reinsertions;
+            minimizer_reinsertion_ns += other.minimizer_reinsertion_ns;
+            mphf_lookups += other.mphf_lookups;
+            mphf_ns += other.mphf_ns;
+            return *this;
+        }
+    };
+
+    inline uint64_t stats_now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+} // namespace kero
+
+#ifdef KERO_ENABLE_STATS
+#define KERO_STATS_ADD(stats, field, value) ((stats).field += (value))
+#define KERO_STATS_START(name) uint64_t name = kero::stats_now_ns()
+#define KERO_STATS_ELAPSED(stats, field, name) ((stats).field += kero::stats_now_ns() - (name))
+#else
+#define KERO_STATS_ADD(stats, field, value) ((void)0)
+#define KERO_STATS_START(name) ((void)0)
+#define KERO_STATS_ELAPSED(stats, field, name) ((void)0)
+#endif
@@ -0,0 +1,101 @@
+/**
+* @file threads.hpp
+ *
+ * @brief This file defines the worker threads of the parallel stages (sorted load, batched lookups,
+ * store merges, unitig compaction and conversion).
+ *
+ * An exception thrown by a worker never reaches the thread boundary: all the workers are joined, then
+ * the first exception, in worker order, is rethrown in the calling thread.
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kero {
+
+    /**
+     * Run worker(t) for t in [0, nb_threads), the calling thread being the thread 0.
+     * The threads are started for this call only, see Thread_pool to keep them.
+     */
+    template<typename Worker>
+    void run_threads(uint64_t nb_threads, Worker worker) {
+        if (nb_threads == 0)
+            nb_threads = 1;
+        std::vector<std::exception_ptr> errors(nb_threads);
+        auto guarded = [&errors, &worker](uint64_t t) {
+            try {
+                worker(t);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        try {
+            for (uint64_t t = 1; t < nb_threads; t++)
+                pool.emplace_back(guarded, t);
+        } catch (...) {
+            // The threads already started are still joined
+            errors[0] = std::current_exception();
+        }
+        if (errors[0] == nullptr)
+            guarded(0);
+        for (std::thread& thread : pool)
+            thread.join();
+
+        for (const std::exception_ptr& error : errors) {
+            if (error != nullptr)
+                std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * Threads kept between the calls of run(), for the stages called many times (batched lookups).
+     */
+    class Thread_pool {
+    private:
+        std::vector<std::thread> threads;
+        std::mutex run_mutex;   // One run at a time
+        std::mutex mutex;
+        std::condition_variable start;
+        std::condition_variable done;
+
+        const std::function<void(uint64_t)>* job;
+        uint64_t generation;
+        uint64_t nb_workers;
+        uint64_t nb_running;
+        bool stopping;
+        std::vector<std::exception_ptr> errors;
+
+        void loop(uint64_t t);
+        // Stop and join the threads
+        void stop();
+
+    public:
+        /**
+         * @param nb_threads Number of workers of a run, the calling thread included (nb_threads - 1 threads
+         * are started).
+         */
+        explicit Thread_pool(uint64_t nb_threads);
+        ~Thread_pool();
+        Thread_pool(const Thread_pool&) = delete;
+        Thread_pool& operator=(const Thread_pool&) = delete;
+
+        uint64_t size() const { return threads.size() + 1; }
+
+        /**
+         * Run worker(t) for t in [0, min(nb_threads, size())), the calling thread being the thread 0, and
+         * wait for all of them (see run_threads).
+         */
+        void run(uint64_t nb_threads, const std::function<void(uint64_t)>& worker);
+    };
+
+} // namespace kero
@@ -44,4 +44,82 @@ namespace kero {
     uint64_t mask_mini(uint64_t minimizer, uint64_t m);
 
     uint64_t mask_mini(const uint8_t* mini_arr, uint64_t m);
+
+    /**
+     * Hash of a minimizer value (splitmix64 finalizer), used to split the minimizers into ranges of
+     * hashes. Subsets and shards are described by these ranges, so the function must not change.
+     */
+    uint64_t minimizer_hash(uint64_t minimizer);
+
+    /**
+     * Order of the m-mers in the choice of a minimizer (smallest first). It is another hash than
+     * minimizer_hash, so that the chosen minimizers stay spread evenly over the hash ranges.
+     */
+    uint64_t minimizer_order(uint64_t mmer);
+
+    /**
+     * Minimizer of a k-mer: its m-mer of smallest minimizer_order, the leftmost one on ties.
+     * This is the minimizer of the files converted by convert_to_minimizers.
+     *
+     * @param kmer The k-mer value (2 bits per nucleotide, k <= 32).
+     * @param position If not null, filled with the position of the minimizer in the k-mer.
+     *
+     * @return The minimizer value.
+     */
+    uint64_t kmer_minimizer(uint64_t kmer, uint64_t k, uint64_t m, uint64_t* position = nullptr);
+
+    /**
+     * Extract all the k-mers of a 2-bit packed sequence as integers (first nucleotide on the high bits).
+     * The sequence is right aligned, i.e. the padding is on the left of the first byte, as in kero blocks.
+     *
+     * @param seq Packed sequence.
+     * @param seq_size Size of the sequence in nucleotides.
+     * @param k Size of the k-mers, at most 32.
+     * @param kmers Output array with room for seq_size - k + 1 values.
+     *
+     * @return The number of k-mers extracted.
+     */
+    uint64_t sequence_to_kmers(const uint8_t* seq, uint64_t seq_size, uint64_t k, uint64_t* kmers);
+
+    /**
+     * Extract all the k-mers of a super k-mer stored without its minimizer, as in the minimizer sections.
+     * The minimizer is inserted as a word in the rolling k-mer, the sequence is never rebuilt.
+     *
+     * @param seq Packed super k-mer without its minimizer (nb_kmers + k - 1 - m nucleotides, right aligned).
+     * @param nb_kmers Number of k-mers of the super k-mer.
+     * @param k Size of the k-mers, at most 32.
+     * @param minimizer The minimizer value (2 bits per nucleotide).
+     * @param m Size of the minimizer.
+     * @param mini_pos Position of the minimizer in the super k-mer.
+     * @param kmers Output array with room for nb_kmers values.
+     *
+     * @return The number of k-mers extracted.
+     */
+    uint64_t skmer_to_kmers(const uint8_t* seq, uint64_t nb_kmers, uint64_t k, uint64_t minimizer, uint64_t m,
+                            uint64_t mini_pos, uint64_t* kmers);
+
+    // Bit manipulation kernels of the 2-bit packed sequences
+
+    /* Bitshift to the left all the bits in the array with a maximum of 7 bits.
+     * Overflow on the left will be set into the previous cell.
+     */
+    void leftshift8(uint8_t* bitarray, size_t length, size_t bitshift);
+
+    /* Similar to the previous function but on the right */
+    void rightshift8(uint8_t* bitarray, size_t length, size_t bitshift);
+
+    /* Fusion to bytes into one.
+     * The merge_index higher bits are from left_bits the others from right_bits
+     */
+    uint8_t fusion8(uint8_t left_bits, uint8_t right_bits, size_t merge_index);
+
+    /**
+     * Fill shifts[1..3] with the sequence of shifts[0] shifted to the right by 1 to 3 nucleotides,
+     * so that every k-mer of the sequence starts on a byte boundary in one of the 4 arrays.
+     *
+     * @param shifts 4 arrays of at least seq_bytes bytes, the first one holding the sequence.
+     * @param seq_bytes Size of the sequence in bytes.
+     * @param nb_kmers Number of k-mers of the sequence. Only the shifts that are needed are computed.
+     */
+    void prepare_shifts(uint8_t** shifts, uint64_t seq_bytes, uint64_t nb_kmers);
 }
\ No newline at end of file
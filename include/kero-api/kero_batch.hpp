@@ -0,0 +1,111 @@
+/**
+* @file kero_batch.hpp
+ *
+ * @brief This file defines the batched k-mer lookups of kero files.
+ *
+ * The queries of a batch are grouped by minimizer section (through the hashtable of the file), then
+ * every section needed is read in a single request. The requests are all in flight at the same time:
+ * through io_uring when the library is built with liburing (KERO_HAVE_LIBURING), otherwise through a
+ * pool of threads doing blocking preads. The sections are decoded in the order the reads complete.
+ *
+ * A section is read from its position to the next known section position (hashtable and index), so
+ * the file must have a hashtable. The sections larger than the budget of the file
+ * (Kero_file::section_budget) are scanned in bounded memory through the usual stream path instead, by
+ * the pool of threads (while the calling thread drives the io_uring reads).
+ *
+ */
+
+#ifndef KERO_BATCH_HPP
+#define KERO_BATCH_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Kero_file;
+
+namespace kero {
+
+    class Thread_pool;
+
+    struct Kmer_query {
+        uint64_t minimizer;  // Minimizer of the k-mer (2 bits per nucleotide)
+        uint64_t kmer;       // K-mer value (2 bits per nucleotide, k <= 32)
+    };
+
+    struct Batch_options {
+        // Number of section reads in flight (io_uring queue depth or number of pread threads)
+        uint64_t queue_depth = 32;
+        // Use io_uring when available. When false, or when io_uring cannot be initialized, the
+        // pread threads are used.
+        bool use_io_uring = true;
+    };
+
+    class Batch_lookup {
+    private:
+        struct Section_read;
+
+        std::string filename;
+        Batch_options options;
+        std::unique_ptr<Kero_file> file;
+        int fd;
+        // Sorted positions of all the known sections, and the end of the last one
+        std::vector<uint64_t> boundaries;
+        bool uring_available;
+        // pread threads and threads of the streamed sections, started by the first batch that needs
+        // them and kept for the next ones
+        std::unique_ptr<Thread_pool> pool;
+
+        uint64_t k, m, data_size, layout;
+
+        void scan_bytes(const uint8_t* bytes, uint64_t size, Section_read& read,
+                        const std::vector<Kmer_query>& queries, std::vector<uint8_t>& found,
+                        std::vector<uint8_t>* data) const;
+        void scan_stream(Kero_file& section_file, Section_read& read, const std::vector<Kmer_query>& queries,
+                         std::vector<uint8_t>& found, std::vector<uint8_t>* data) const;
+        // Pool of the pread threads, started on first use
+        Thread_pool& thread_pool();
+        // Kero_file of a thread for the sections scanned with scan_stream
+        std::unique_ptr<Kero_file> open_stream_file() const;
+        void read_with_threads(std::vector<Section_read>& reads, const std::vector<Kmer_query>& queries,
+                               std::vector<uint8_t>& found, std::vector<uint8_t>* data);
+        bool read_with_uring(std::vector<Section_read>& reads, const std::vector<Kmer_query>& queries,
+                             std::vector<uint8_t>& found, std::vector<uint8_t>* data);
+
+    public:
+        /**
+         * Open a kero file for batched lookups and load its hashtable.
+         *
+         * @param filename Path of a kero file with a hashtable.
+         * @param options I/O settings.
+         */
+        explicit Batch_lookup(const std::string& filename, const Batch_options& options = Batch_options());
+        ~Batch_lookup();
+        Batch_lookup(const Batch_lookup&) = delete;
+        Batch_lookup& operator=(const Batch_lookup&) = delete;
+
+        /**
+         * Look for all the k-mers of a batch.
+         *
+         * @param queries The k-mers to find, with their minimizers.
+         * @param found Resized to the number of queries, found[i] is 1 if the k-mer i is present.
+         * @param data If not null, resized to queries.size() * data_size and filled with the data of the
+         * k-mers found.
+         *
+         * @return The number of k-mers found.
+         */
+        uint64_t find_kmers(const std::vector<Kmer_query>& queries, std::vector<uint8_t>& found,
+                            std::vector<uint8_t>* data = nullptr);
+
+        /**
+         * @return "io_uring" or "pread", the backend used by the next batches.
+         */
+        const char* backend_name() const;
+
+        uint64_t get_data_size() const { return data_size; }
+    };
+
+} // namespace kero
+
+#endif //KERO_BATCH_HPP
@@ -0,0 +1,114 @@
+/**
+* @file kero_concat.hpp
+ *
+ * @brief This file defines the concatenation, the re-indexation and the subsets of kero files.
+ *
+ * The sequence sections ('M' and 'r') are copied byte for byte (see Section_Minimizer::copy_bytes),
+ * so only their headers and the n columns are read. The output gets a single index and hashtable.
+ *
+ */
+
+#ifndef KERO_CONCAT_HPP
+#define KERO_CONCAT_HPP
+
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace kero {
+
+    struct Concat_stats {
+        uint64_t nb_files = 0;              // Number of input files
+        uint64_t nb_minimizer_sections = 0; // Number of 'M' sections copied or indexed
+        uint64_t nb_raw_sections = 0;       // Number of 'r' sections copied or indexed
+        uint64_t nb_variable_sections = 0;  // Number of 'v' sections written or indexed
+        uint64_t nb_bytes = 0;              // Bytes of the sequence sections copied or indexed
+    };
+
+    /**
+     * Inclusive range of minimizer hashes (see minimizer_hash in detail/util.hpp).
+     */
+    struct Hash_range {
+        uint64_t first = 0;
+        uint64_t last = UINT64_MAX;
+
+        /**
+         * @return True if the hash of the minimizer is in the range.
+         */
+        bool contains(uint64_t minimizer) const;
+
+        /**
+         * @return The range number part when the hashes are split into nb_parts ranges of equal size.
+         */
+        static Hash_range part(uint64_t part, uint64_t nb_parts);
+    };
+
+    /**
+     * @brief Concatenate kero files into a new indexed file.
+     *
+     * The sections of the inputs are copied in order, the index, hashtable and footer sections being
+     * replaced by a single index and hashtable. A variable section is only written when it changes the
+     * variables. The inputs must share their encoding, and their k, m, max, data_size and layout
+     * variables when they declare them. A minimizer can only have one section in the output: a
+     * minimizer present in several inputs throws. On any error, the output is removed (a stream keeps
+     * the sections already written, without footer).
+     * The encoding and metadata come from the first input. The canonicity is kept when all the inputs
+     * have it. The uniqueness is kept when all the inputs have it and only contain minimizer sections,
+     * the sections of distinct minimizers holding distinct k-mers. Both flags are computed from the
+     * inputs before the first section is written, so the output can be a stream ("-").
+     *
+     * @param inputs Paths of the kero files to concatenate, indexed or not.
+     * @param output Path of the kero file to create.
+     *
+     * @return Counters on the copy.
+     */
+    Concat_stats concatenate_files(const std::vector<std::string>& inputs, const std::string& output);
+
+    /**
+     * @brief Add an index and a hashtable to a kero file written without index (set_indexation(false)).
+     *
+     * The sections are located from their headers, then the file is opened in append mode and the
+     * footer (hashtable, index and variables) is written after the last section. Nothing is copied.
+     * A file that already has an index is left unchanged.
+     *
+     * @param path Path of the kero file to index, in place.
+     *
+     * @return Counters on the indexed sections, all 0 if the file was already indexed.
+     */
+    Concat_stats reindex_file(const std::string& path);
+
+    /**
+     * @brief Write a kero file with the minimizer sections of some minimizers only.
+     *
+     * The sections are located through the hashtable of the input and copied byte for byte, in the
+     * order of the input. The output has the header, the metadata and the variables of the input, and
+     * its own index and hashtable. The minimizers without section are ignored.
+     *
+     * @param input Path of an indexed kero file (see reindex_file otherwise).
+     * @param output Path of the kero file to create.
+     * @param minimizers The minimizers to extract (2 bits per nucleotide).
+     *
+     * @return Counters on the copy.
+     */
+    Concat_stats extract_minimizers(const std::string& input, const std::string& output,
+                                    const std::vector<uint64_t>& minimizers);
+
+    /**
+     * @brief Write a kero file with the minimizer sections selected by a predicate (see extract_minimizers).
+     * The minimizers of the input are listed from the hashtable and the section headers.
+     *
+     * @param keep Called on the minimizer of every section, true to keep the section.
+     */
+    Concat_stats extract_sections(const std::string& input, const std::string& output,
+                                  const std::function<bool(uint64_t)>& keep);
+
+    /**
+     * @brief Write a kero file with the minimizer sections of a range of minimizer hashes
+     * (see extract_minimizers).
+     */
+    Concat_stats extract_hash_range(const std::string& input, const std::string& output, const Hash_range& range);
+
+} // namespace kero
+
+#endif //KERO_CONCAT_HPP
@@ -0,0 +1,63 @@
+/**
+* @file kero_convert.hpp
+ *
+ * @brief This file defines the conversion of the sequence blocks of a kero file into minimizer sections.
+ *
+ * Files written with raw sections ('r') have no hashtable and no columnar layout. The conversion splits
+ * their blocks into super k-mers by minimizer (see kmer_minimizer in detail/util.hpp) and writes one
+ * indexed minimizer section ('M') per minimizer. The blocks are read in batches and the block ranges of a
+ * batch are split in parallel.
+ *
+ */
+
+#ifndef KERO_CONVERT_HPP
+#define KERO_CONVERT_HPP
+
+#include <string>
+#include <cstdint>
+
+namespace kero {
+
+    struct Convert_options {
+        // Size of the minimizers
+        uint64_t m = 11;
+        // Number of worker threads. 0 means one per hardware thread.
+        uint64_t nb_threads = 0;
+        // Number of input blocks loaded in memory and split together.
+        uint64_t batch_blocks = 1 << 16;
+        // Number of passes over the input. Each pass only keeps the super k-mers of one range of minimizer
+        // hashes in memory until they are written (see Hash_range::part).
+        uint64_t nb_passes = 1;
+    };
+
+    struct Convert_stats {
+        uint64_t nb_input_sections = 0;     // Number of sequence sections read
+        uint64_t nb_input_blocks = 0;       // Number of blocks read
+        uint64_t nb_kmers = 0;              // Number of k-mers read (and written)
+        uint64_t nb_super_kmers = 0;        // Number of super k-mers written
+        uint64_t nb_minimizer_sections = 0; // Number of 'M' sections written
+    };
+
+    /**
+     * @brief Convert the sequence sections of a kero file into indexed minimizer sections.
+     *
+     * Every block is cut into super k-mers, the maximal runs of consecutive k-mers that share the same
+     * minimizer occurrence, and the super k-mers of a minimizer are gathered into a single section, in the
+     * order of the input. The data of each k-mer are kept. Existing minimizer sections are split again
+     * with the minimizers of kmer_minimizer.
+     * The output has the encoding, flags and metadata of the input, its k and data_size, the m of the
+     * options, a max of k - m + 1 and the default layout of Kero_file. The k and data_size variables must
+     * be the same for all the sections.
+     *
+     * @param input Path of the kero file to convert. k must be at most 32.
+     * @param output Path of the kero file to create.
+     * @param options Minimizer size, threads and memory settings.
+     *
+     * @return Counters on the conversion.
+     */
+    Convert_stats convert_to_minimizers(const std::string& input, const std::string& output,
+                                        const Convert_options& options = Convert_options());
+
+} // namespace kero
+
+#endif //KERO_CONVERT_HPP
@@ -17,11 +17,17 @@
  */
 
 #include <fstream>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
 #include <vector>
 
 #include "kero-api/detail/mpht.hpp"
+#include "kero-api/detail/layout.hpp"
+#include "kero-api/detail/stats.hpp"
+#include "kero-api/detail/latency.hpp"
+#include "kero-api/detail/direct_io.hpp"
 #include "ic.h"
 
 #ifdef _WIN32
@@ -41,6 +47,9 @@ class Section_Minimizer;
 class Section_Index;
 class Section_Hashtable;
 class Kero_reader;
+namespace kero {
+	class Section_prefetcher;
+}
 
 /**
  * This class is the central class for the low level kero file API.
@@ -63,6 +72,33 @@ public:
 	bool delete_on_destruction;
 
 	bool tmp_closed;
+	// Reads of the file through O_DIRECT windows, null when the file is read through fs
+	kero::Direct_reader * direct_reader;
+
+	// In-memory file: written in file_buffer only, or read from memory_bytes (not owned)
+	bool in_memory;
+	const uint8_t * memory_bytes;
+
+	// Forward-only reading (pipes, stdin). The window keeps the bytes read since the beginning of the
+	// current section, the only ones that can be read again.
+	// Forward-only writing (pipes, stdout). The buffer keeps the current section, the only one that can
+	// be written again, and is written to the stream when the next section starts.
+	bool streaming;
+	std::vector<uint8_t> stream_window;
+	unsigned long stream_window_start;
+
+	/**
+	 * Read from the stream until the window reaches the position end.
+	 */
+	void stream_fill(unsigned long end);
+	/**
+	 * In forward-only writing mode, write the buffer to the stream. Called at the beginning of each
+	 * section: the bytes before it are final.
+	 */
+	void flush_stream();
+
+	// Initialize the members before opening
+	void init(const std::string filename);
 
 	/**
 	 * Read encoding from file and save it to the public argument "encoding".
@@ -75,9 +111,11 @@ public:
 	void read_size_metadata();
 
 	void write_footer();
+	void open_append();
 	void footer_discovery();
 	void index_discovery();
 	void read_index(long position);
+	void global_vars_discovery();
 
 public:
 	std::string filename;
@@ -98,13 +136,26 @@ public:
 
 	Section_GV * footer;
 	std::vector<Section_Index *> index;
+	Section_Hashtable * hashtable;
 
 	bool indexed;
+	// Absolute positions of the sections. Filled on section registration in w mode and from the index in r mode.
 	std::map<long, char> section_positions;
 
 	// encoding:        A:0  C:1 G:3 T:2
 	uint8_t encoding[4] = {0, 1, 3, 2};
 
+	// Storage layout of the minimizer sections (see Kero_layout).
+	// A "layout" global variable, when present, takes precedence over this value.
+	uint8_t layout = KERO_DEFAULT_LAYOUT;
+
+	// Memory budget in bytes of each minimizer section (0: unbounded). Readers decode the columns by
+	// chunks within the budget and writers spill their column buffers to temporary files beyond it.
+	uint64_t section_budget = KERO_DEFAULT_SECTION_BUDGET;
+
+	// I/O and decoding counters of the file and its sections, only updated with KERO_ENABLE_STATS.
+	kero::Kero_stats stats;
+
 	uint32_t metadata_size = 0;
 
 	std::unordered_map<std::string, uint64_t> global_vars;
@@ -113,15 +164,53 @@ public:
     std::vector<uint64_t> mini_list;
     std::vector<uint64_t> mini_pos;
 
+	// Append mode: position of the first index section of the original file (0 if none), chained
+	// after the new index section, and minimizers that already have a section.
+	uint64_t previous_index = 0;
+	std::unordered_set<uint64_t> previous_minimizers;
+
 	// --- Filesystem functions ---
 	/** Open the file filename with the mode.
-	 * mode must be chosen in the set of values {r: read, w: write}
+	 * mode must be chosen in the set of values {r: read, rs: forward-only read, w: write, ws: forward-only write,
+	 * a: append}
+	 *
+	 * In forward-only mode, the sections are parsed in order without looking at the footer first, so
+	 * the file can be a pipe. Only the current section can be read again: the footer, index and
+	 * hashtable are not discovered and the random accesses (hashtable lookups, jumps from the end)
+	 * are not available. The mode is selected automatically for "-" (standard input) and for files
+	 * that are not regular files (FIFOs, character devices).
+	 *
+	 * In forward-only writing mode, the bytes are written once, in order, so the file can be a pipe. Each
+	 * section is kept in memory until it is complete (its counts and offsets are written at close) and
+	 * written when the next one starts: the header (encoding, flags) must be set before the first
+	 * section. The mode is selected automatically for "-" (standard output) and for existing files that
+	 * are not regular files.
+	 *
+	 * In append mode, the sections are written after the sections of an existing file (created if
+	 * absent). Its footer variables and end signature are truncated, its index and hashtable stay in
+	 * place. On close, a new index section that lists the new sections is chained to the previous
+	 * ones, and a new hashtable covers the minimizer sections of both. The variables of the file are
+	 * loaded: sections with the same k, m, max and data_size can be appended directly. A minimizer can
+	 * only have one section, the sections of existing minimizers are refused. A file without index
+	 * stays without index.
 	 *
 	 * @param filename The path to the file to construct/read.
-	 * @param mode Opening mode of the file. w for writing, r for reading.
+	 * @param mode Opening mode of the file. w for writing, r for reading, rs for forward-only reading,
+	 * ws for forward-only writing, a for appending.
    *
 	 */
 	Kero_file(const std::string filename, const std::string mode);
+	/** Create a kero file in memory, in writing mode. The file grows in a memory buffer that is never
+	 * written on disk. After close(), the bytes are given by memory_data() and memory_size(), and the
+	 * file can be read again with open("r").
+	 */
+	Kero_file();
+	/** Read a kero file from memory. All the sections are read as from a file on disk.
+	 *
+	 * @param bytes The kero file. The bytes are not copied and must outlive the object.
+	 * @param size Size of the kero file in bytes.
+	 */
+	Kero_file(const uint8_t * bytes, size_t size);
 	/** Reopen from the beginning the KERO file defined at the construction.
 	 * The opening mode can differ from the original one.
 	 *
@@ -135,8 +224,9 @@ public:
 	/**
 	 * Close the file.
 	 *
-	 * @param write_buffer Write the buffer in writing mode. If set to false, the buffer is never
-	 * saved on disk and the file will be deleted on object destruction.
+	 * @param write_buffer Write the buffer in writing mode. If set to false, the footer and the
+	 * signature are not written, the buffer is never saved on disk and the file will be deleted on
+	 * object destruction.
 	 */
 	void close(bool write_buffer=true);
 
@@ -163,6 +253,15 @@ public:
 	 * @return position from the beginning of the file.
 	 */
 	unsigned long tellp();
+	/**
+	 * @return The bytes of an in-memory file (all of them once closed in writing mode), nullptr for a
+	 * file on disk.
+	 */
+	const uint8_t * memory_data() const;
+	/**
+	 * @return The size of an in-memory file.
+	 */
+	unsigned long memory_size() const;
 	/** Relative jump. Can be negative.
 	 * @param size Number of bytes to jump
 	 **/
@@ -173,6 +272,18 @@ public:
 	 * @param from_end If true, position from the end of the file.
 	 */
 	void jump_to(unsigned long position, bool from_end=false);
+	/**
+	 * In reading mode, read the rest of the file with O_DIRECT through two reused aligned windows, the
+	 * next window being read in the background. Full scans then bypass the page cache and do not evict
+	 * the pages of other files. The sections are decoded as usual.
+	 * When the filesystem refuses O_DIRECT, the windows are read through the page cache and their pages
+	 * are dropped (POSIX_FADV_DONTNEED) once copied.
+	 *
+	 * @param window_bytes Size of each window.
+	 *
+	 * @return true if O_DIRECT is used.
+	 */
+	bool use_direct_io(uint64_t window_bytes = kero::DIRECT_WINDOW_BYTES);
 
 	/**
 	 * In writing mode, the KERO files are indexed by default.
@@ -279,6 +390,49 @@ public:
      * @param position The file position of the section
      */
     void register_minimizer_section(uint64_t minimizer, uint64_t position);
+
+    /**
+     * Load the hashtable section registered in the index (the last one if the index has several).
+     * The global variables of the file are also reloaded to allow random access to the sections.
+     * Called automatically by the find functions.
+     *
+     * @return True if a hashtable is available.
+     */
+    bool hashtable_discovery();
+
+    /**
+     * Find the minimizer section of a minimizer through the hashtable.
+     * The minimizer stored in the section header is verified, so absent minimizers are detected.
+     *
+     * @param minimizer The minimizer value (2 bits per nucleotide).
+     * @param position Filled with the absolute position of the section when found.
+     *
+     * @return True if the file contains a section for this minimizer.
+     */
+    bool find_minimizer_section(uint64_t minimizer, uint64_t & position);
+
+    /**
+     * Look for a k-mer in the section of its minimizer.
+     * The file position is restored after the lookup.
+     *
+     * @param minimizer The minimizer of the k-mer.
+     * @param kmer The k-mer value (2 bits per nucleotide, k <= 32).
+     * @param data If not null and the k-mer is found, filled with its data_size bytes of data.
+     *
+     * @return True if the k-mer is present.
+     */
+    bool find_kmer(uint64_t minimizer, uint64_t kmer, uint8_t * data);
+
+    /**
+     * List the minimizer sections of the file through the hashtable. The minimizers are read from the
+     * section headers, in the order of the hashtable. The file position is restored.
+     *
+     * @param minimizers The minimizers of the sections are appended to this vector.
+     * @param positions The absolute positions of the sections are appended to this vector.
+     *
+     * @return False if the file has no hashtable.
+     */
+    bool minimizer_sections(std::vector<uint64_t> & minimizers, std::vector<uint64_t> & positions);
 };
 
 
@@ -354,6 +508,7 @@ public:
 	/**
 	 * Closes the section.
 	 * If w mode, go back to the beginning of the section to write the correct number of variables.
+	 * A section that declares m without a layout variable also records Kero_file::layout as "layout".
 	 *
 	 */
 	void close();
@@ -413,6 +568,16 @@ public:
 		while (this->remaining_blocks > 0)
 			this->jump_sequence();
 	}
+	/**
+	 * Read all the remaining blocks of the section as integer k-mers (k <= 32), first nucleotide on the
+	 * high bits.
+	 *
+	 * @param kmers The k-mers are appended to this vector.
+	 * @param data If not null, the data_size bytes of data of every k-mer are appended to this vector.
+	 *
+	 * @return The number of k-mers extracted.
+	 */
+	virtual uint64_t extract_kmers(std::vector<uint64_t> & kmers, std::vector<uint8_t> * data = nullptr);
 };
 
 /**
@@ -487,11 +652,26 @@ public:
 	 * Jumb over the next block of the section.
 	 */
 	void jump_sequence();
-	/** Copy the current section in the file pointed by the function.
+	/** Copy the current section in the file pointed by the function. The section is copied byte for
+	 * byte (see copy_bytes) when the k, max and data_size of both files are equal.
 	 *
 	 * @param file The file where to copy the section
 	 **/
 	void copy(Kero_file * file);
+	/** Copy the section byte for byte at the end of the file pointed by the function, without decoding
+	 * the blocks. The k, max and data_size variables of both files must be equal. The section must not
+	 * be partially read and is entirely read after the copy.
+	 *
+	 * @param file The file where to copy the section
+	 **/
+	void copy_bytes(Kero_file * file);
+	/**
+	 * @param nb_kmers If not null, set to the number of k-mers of the section.
+	 *
+	 * @return The position of the first byte after the section, found from the block sizes only. The
+	 * file position is restored.
+	 */
+	uint64_t section_end(uint64_t * nb_kmers = nullptr);
 	/**
 	 * Close the section.
 	 * If w mode, go back to the beginning of the section to write the correct number of blocks.
@@ -507,12 +687,21 @@ public:
  */
 class Section_Minimizer : public Section, public Block_section_reader {
 private:
+	template<class Codec> friend struct kero::Columnar_layout;
+	friend struct kero::Row_layout;
+
 	// Buffers
     std::vector<uint64_t> n_value_buffer;  // the number of k-mers in each block
     std::vector<uint64_t> m_idx_buffer;    // the minimizer index for each block
     std::vector<uint8_t> seq_buffer;       // the sequence buffer for each block
 	std::vector<uint8_t> data_buffer;      // the data buffer for each block
 
+	// Bounded memory (see Kero_file::section_budget)
+	std::unique_ptr<kero::Section_spill> spill;  // columns spilled while writing
+	kero::Column_cursor n_cursor;                // chunked decoding of the columns while reading
+	kero::Column_cursor m_idx_cursor;
+	kero::Column_cursor data_cursor;
+
 	// For sequence reading and writing
 	uint64_t cur_skmer_idx;                // current super k-mer index to read or write
 	uint64_t last_n_pos;				   // last n position to read or write
@@ -535,6 +724,8 @@ public:
     uint64_t data_size;                   // data size
 	uint64_t m;                           // m value of minimizer
 	uint8_t* minimizer;                   // minimizer
+	uint8_t layout;                       // storage layout (Kero_layout)
+	kero::Kero_stats stats;               // decoding counters of this section (KERO_ENABLE_STATS)
 
 	// Useful variables
     uint8_t nb_bytes_mini;                 // the number of bytes used to store the minimizer
@@ -555,10 +746,63 @@ public:
     uint64_t read_compacted_sequence(uint8_t* seq, uint8_t* data);
     uint64_t read_compacted_sequence(uint8_t* seq_data);
     uint64_t read_compacted_sequence_without_mini(uint8_t *seq, uint8_t *data, uint64_t &mini_pos);
+	/** Copy the current section in the file pointed by the function. The section is copied byte for
+	 * byte (see copy_bytes) when the k, m, max, data_size and layout of both files are equal, otherwise
+	 * its super k-mers are decoded and written again.
+	 *
+	 * @param file The file where to copy the section
+	 **/
 	void copy(Kero_file * file);
+	/** Copy the section byte for byte at the end of the file pointed by the function, without decoding
+	 * its columns. The column offsets are relative to the start of the section, so only the hashtable
+	 * entry of the minimizer is registered in the destination. The k, m, max, data_size and layout of
+	 * both files must be equal. The section must not be partially read and is entirely read after the copy.
+	 *
+	 * @param file The file where to copy the section
+	 **/
+	void copy_bytes(Kero_file * file);
+	/**
+	 * @return The position of the first byte after the section. Only the n column (or the n fields of
+	 * the rows) is read. The file position is restored.
+	 */
+	uint64_t section_end();
     void jump_sequence();
     void close();
 
+	/**
+	 * Scan the remaining super k-mers of the section for a k-mer.
+	 *
+	 * @param kmer The k-mer value (2 bits per nucleotide, k <= 32).
+	 * @param data If not null and the k-mer is found, filled with its data_size bytes of data.
+	 *
+	 * @return True if the k-mer is present.
+	 */
+	bool find_kmer(uint64_t kmer, uint8_t * data);
+
+	/**
+	 * Read all the remaining super k-mers of the section as integer k-mers (k <= 32).
+	 * The minimizer is inserted in the integer k-mers, the super k-mer sequences are never rebuilt.
+	 *
+	 * @param kmers The k-mers are appended to this vector.
+	 * @param data If not null, the data_size bytes of data of every k-mer are appended to this vector.
+	 *
+	 * @return The number of k-mers extracted.
+	 */
+	uint64_t extract_kmers(std::vector<uint64_t> & kmers, std::vector<uint8_t> * data = nullptr) override;
+
+	/**
+	 * Read all the remaining super k-mers of the section as integer k-mers (k <= 32), with the absolute
+	 * file positions of their data. The data are only stored as is in the row and uncompressed columnar
+	 * layouts: the compressed layout throws. In the columnar layout, the section must not be partially
+	 * read.
+	 *
+	 * @param kmers The k-mers are appended to this vector.
+	 * @param positions The positions of the data_size bytes of data of every k-mer are appended to this vector.
+	 *
+	 * @return The number of k-mers located.
+	 */
+	uint64_t locate_kmer_data(std::vector<uint64_t> & kmers, std::vector<uint64_t> & positions);
+
 	/**
 	 * @brief Reads and decompresses all column data (n, m_idx, data) from a memory-mapped file.
 	 * This method is designed to be called once to pre-cache data for parallel access.
@@ -597,6 +841,14 @@ public:
     ~Section_Hashtable() override;
     void reg_sm(uint64_t minimizer, uint64_t index);
     void close();
+	/**
+	 * Jump over the hashtable section at the current position of the file from its sizes only, without
+	 * loading the mphf.
+	 *
+	 * @param nb_mphf If not null, set to the size of the mphf in bytes.
+	 * @param nb_hashtable If not null, set to the number of entries of the hashtable.
+	 */
+	static void skip(Kero_file * file, uint64_t * nb_mphf = nullptr, uint64_t * nb_hashtable = nullptr);
 };
 
 
@@ -623,10 +875,16 @@ private:
 	Block_section_reader * current_section;
 	// Remaining blocks before end of the section
 	uint64_t remaining_blocks;
+	// Read-ahead thread, null when the sections are read in lockstep with the consumer
+	kero::Section_prefetcher * prefetcher;
+	bool prefetch_ended;
 
 
+	void init();
 	void read_until_first_section_block();
+	void read_next_prefetched_section();
 	void read_next_block();
+	void resize_buffers();
 
 public:
 	uint64_t k;
@@ -635,12 +893,39 @@ public:
 
 	Kero_file * file;
 
-	Kero_reader(std::string filename);
+	/**
+	 * Open a file for reading.
+	 *
+	 * @param filename Path of the kero file.
+	 * @param prefetch_chunks 0 to read and decode in lockstep with the consumer. Otherwise a background
+	 * thread decodes the next sections ahead, keeping at most prefetch_chunks chunks of decoded blocks
+	 * (see kero::PREFETCH_CHUNK_BYTES) ready. The file attribute is then only used for the header,
+	 * and its global_vars follow the section being read. The read-ahead needs to reopen the file, so
+	 * it is not used for the forward-only streams (see Kero_file::Kero_file).
+	 */
+	Kero_reader(std::string filename, uint64_t prefetch_chunks = 0);
+	/**
+	 * Read a kero file from memory (see Kero_file::Kero_file(const uint8_t *, size_t)).
+	 *
+	 * @param bytes The kero file, not copied: the bytes must outlive the reader.
+	 * @param size Size of the kero file in bytes.
+	 */
+	Kero_reader(const uint8_t * bytes, size_t size);
 	~Kero_reader();
 
 	bool has_next();
 	uint64_t next_block(uint8_t* & sequence, uint8_t* & data);
 	bool next_kmer(uint8_t* & sequence, uint8_t* & data);
+	/**
+	 * Extract all the remaining k-mers of the current section as integers (k <= 32), without the
+	 * per k-mer copies of next_kmer. The k-mers left in a block partially read by next_kmer are included.
+	 *
+	 * @param kmers The k-mers are appended to this vector.
+	 * @param data If not null, the data of every k-mer is appended to this vector.
+	 *
+	 * @return The number of k-mers extracted, 0 at the end of the file.
+	 */
+	uint64_t next_section_kmers(std::vector<uint64_t> & kmers, std::vector<uint8_t> * data = nullptr);
 
 	uint64_t get_var(std::string name);
 	uint8_t * get_encoding();
@@ -648,4 +933,19 @@ public:
 
 uint64_t bytes_from_bit_array(uint64_t bits_per_elem, uint64_t nb_elem);
 
+/**
+ * Read a big endian 8 bytes value at the current position of the file.
+ */
+uint64_t read_u64(Kero_file & file);
+
+/**
+ * Create a new empty temporary file, unique among the threads and the processes (mkstemp).
+ *
+ * @param directory Directory of the file. When empty, TMPDIR or /tmp.
+ * @param name Beginning of the file name, followed by a random suffix.
+ *
+ * @return The path of the file, to remove by the caller.
+ */
+std::string create_temp_file(const std::string & directory, const std::string & name);
+
 #endif
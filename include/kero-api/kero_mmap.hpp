@@ -16,20 +16,47 @@
 #include <cstdint>
 #include <stdexcept>
 
+class Kero_file;
+
 namespace kero {
 
+    /**
+     * Expected access pattern of a mapped range, given to the kernel with madvise.
+     */
+    enum Mmap_access : uint8_t {
+        MMAP_ACCESS_NORMAL = 0,   // Default read-ahead
+        MMAP_ACCESS_SEQUENTIAL,   // Full scans: aggressive read-ahead, pages freed soon after use
+        MMAP_ACCESS_RANDOM,       // Lookups: no read-ahead
+    };
+
+    struct Mmap_options {
+        // Access pattern of the whole mapping
+        Mmap_access access = MMAP_ACCESS_NORMAL;
+        // Start reading the whole file in the background (MADV_WILLNEED)
+        bool willneed = false;
+        // Fault all the pages when mapping (MAP_POPULATE): the constructor returns once the file is read
+        bool populate = false;
+        // Map the file read-write and shared: the writes to the mapping reach the file
+        bool writable = false;
+    };
+
     class Kero_Mmap_Accessor {
     private:
         int fd;                 // File descriptor
         uint8_t* file_ptr;      // Pointer to the mapped memory
         size_t file_size;       // Total size of the mapped file
+        bool writable;          // Shared read-write mapping
+
+        // madvise on the pages covering [offset, offset + length), clamped to the file
+        bool advise_range(size_t offset, size_t length, int advice);
 
     public:
         /**
          * @brief Construct a new Kero Mmap Accessor object and map the file into memory.
          * @param filename The path to the file to map.
+         * @param options Access pattern and pre-faulting of the mapping.
          */
-        Kero_Mmap_Accessor(const std::string& filename);
+        Kero_Mmap_Accessor(const std::string& filename, const Mmap_options& options = Mmap_options());
 
         /**
          * @brief Destroy the Kero Mmap Accessor object, unmapping the memory and closing the file.
@@ -48,6 +75,17 @@ namespace kero {
             return file_ptr;
         }
 
+        /**
+         * @brief Get a writable pointer to the beginning of the mapped file.
+         * @return uint8_t* The mapped memory, the writes reach the file.
+         * @throws std::runtime_error if the mapping is not writable (Mmap_options::writable).
+         */
+        uint8_t* get_mutable_ptr() {
+            if (not writable)
+                throw std::runtime_error("Mmap_Accessor: the file is mapped read-only.");
+            return file_ptr;
+        }
+
         /**
          * @brief Get the total size of the mapped file.
          * @return size_t The file size in bytes.
@@ -55,6 +93,50 @@ namespace kero {
         size_t get_size() const {
             return file_size;
         }
+
+        /**
+         * @brief Set the access pattern of a byte range (page aligned by the call).
+         * @return false if the kernel refused the advice.
+         */
+        bool advise(size_t offset, size_t length, Mmap_access access);
+
+        /**
+         * @brief Start reading a byte range in the background (MADV_WILLNEED), e.g. a section before its
+         * decoding.
+         * @return false if the kernel refused the advice.
+         */
+        bool prefetch(size_t offset, size_t length);
+
+        /**
+         * @brief Ask for transparent huge pages on a byte range (MADV_HUGEPAGE). File mappings only get
+         * them on kernels and filesystems with huge page cache support.
+         * @return false if the kernel refused the advice.
+         */
+        bool advise_huge_pages(size_t offset, size_t length);
+
+        /**
+         * @brief Warm the index and hashtable sections of a kero file (MADV_WILLNEED), with huge pages
+         * if requested. The sections are located with file.section_positions, each one extending to the
+         * next known section.
+         * @param file The same file, opened for reading.
+         * @param huge_pages Also advise huge pages on these regions.
+         * @return The number of bytes advised.
+         */
+        size_t warm_metadata(const Kero_file& file, bool huge_pages = false);
+
+        /**
+         * @brief Write the modified pages of a byte range of a writable mapping to the file and wait for
+         * the writes (msync).
+         * @return false if the kernel refused the synchronization.
+         */
+        bool sync(size_t offset, size_t length);
+
+        /**
+         * @brief Synchronize the whole writable mapping (see sync(offset, length)).
+         */
+        bool sync() {
+            return sync(0, file_size);
+        }
     };
 
 } // namespace kero
@@ -0,0 +1,140 @@
+/**
+* @file kero_shard.hpp
+ *
+ * @brief This file defines the sharding of kero files by minimizer hash.
+ *
+ * The minimizer sections are spread over N shard files by ranges of minimizer hashes (see Hash_range).
+ * Each shard is a complete indexed kero file with its own hashtable. A text manifest lists the shard
+ * files with their hash ranges, so a reader can open only the shards it owns and route each lookup to
+ * the shard of its minimizer.
+ *
+ * Manifest format, one entry per line:
+ *   kero_shards 1
+ *   m <minimizer size>
+ *   shards <N>
+ *   shard <index> <first hash> <last hash> <file name, relative to the manifest>
+ *
+ */
+
+#ifndef KERO_SHARD_HPP
+#define KERO_SHARD_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kero-api/kero_concat.hpp"
+
+class Kero_file;
+
+namespace kero {
+
+    struct Shard_manifest {
+        uint64_t m = 0;
+        std::vector<Hash_range> ranges;   // Hash range of each shard, in increasing order
+        std::vector<std::string> files;   // File of each shard, relative to the manifest
+
+        /**
+         * @return The index of the shard of a minimizer (masked on m).
+         */
+        uint64_t shard_of(uint64_t minimizer) const;
+
+        void save(const std::string& path) const;
+        static Shard_manifest load(const std::string& path);
+    };
+
+    /**
+     * @brief Write the minimizer sections of a build into N shard files.
+     *
+     * The shards are opened in w mode as prefix.<i>.kero. The header of every shard (encoding, flags,
+     * metadata) can be written through files before the first section, then write_vars writes the same
+     * variables in all the shards. Each minimizer section is written in the file given by shard().
+     * close() closes the shards and writes the manifest prefix.manifest.
+     */
+    class Shard_writer {
+    private:
+        std::string prefix;
+        Shard_manifest manifest;
+
+    public:
+        std::vector<std::unique_ptr<Kero_file>> files;
+
+        Shard_writer(const std::string& prefix, uint64_t nb_shards);
+        ~Shard_writer();
+
+        /**
+         * Write a variable section with the same variables in all the shards. m must be one of them.
+         */
+        void write_vars(const std::map<std::string, uint64_t>& vars);
+
+        /**
+         * @return The shard file where the section of a minimizer must be written.
+         */
+        Kero_file& shard(uint64_t minimizer);
+
+        /**
+         * Close all the shards and write the manifest.
+         *
+         * @return The manifest.
+         */
+        Shard_manifest close();
+    };
+
+    /**
+     * @brief Split the minimizer sections of an indexed kero file into N shards (see Shard_writer).
+     *
+     * The sections are located through the hashtable and copied byte for byte, in one pass over the
+     * input. The header, metadata and variables of the input are written in every shard. The raw
+     * sections ('r') have no minimizer and are not copied.
+     *
+     * @param input Path of an indexed kero file.
+     * @param prefix Prefix of the shard files and of the manifest.
+     * @param nb_shards Number of shards.
+     *
+     * @return The manifest of the shards.
+     */
+    Shard_manifest shard_file(const std::string& input, const std::string& prefix, uint64_t nb_shards);
+
+    /**
+     * @brief Lookups in a sharded kero file.
+     *
+     * Only the shards selected at construction are opened. A lookup is routed to the shard of its
+     * minimizer, and fails when this shard is not open.
+     */
+    class Shard_reader {
+    private:
+        std::vector<std::unique_ptr<Kero_file>> files;  // null for the shards not opened
+
+    public:
+        Shard_manifest manifest;
+
+        /**
+         * @param manifest_path Path of the manifest.
+         * @param shards Indexes of the shards to open. Empty to open all of them.
+         */
+        explicit Shard_reader(const std::string& manifest_path, const std::vector<uint64_t>& shards = {});
+        ~Shard_reader();
+
+        /**
+         * @return True if the shard of the minimizer is open.
+         */
+        bool owns(uint64_t minimizer) const;
+
+        /**
+         * @return The file of a shard, nullptr if it is not open.
+         */
+        Kero_file* shard_file(uint64_t shard);
+
+        /**
+         * Look for a k-mer in the shard of its minimizer (see Kero_file::find_kmer).
+         *
+         * @return True if the k-mer is present. False if it is absent or its shard is not open.
+         */
+        bool find_kmer(uint64_t minimizer, uint64_t kmer, uint8_t* data);
+    };
+
+} // namespace kero
+
+#endif //KERO_SHARD_HPP
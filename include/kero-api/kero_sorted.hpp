@@ -0,0 +1,66 @@
+/**
+* @file kero_sorted.hpp
+ *
+ * @brief This file defines the loading of a kero file as a sorted array of integer k-mers.
+ *
+ * The sequence sections ('M' and 'r') are decoded in parallel, each thread reading the file through
+ * its own Kero_file, and the k-mers are sorted with a parallel LSD radix sort that moves the data
+ * of the k-mers along with them.
+ *
+ */
+
+#ifndef KERO_SORTED_HPP
+#define KERO_SORTED_HPP
+
+#include <string>
+#include <cstdint>
+#include <vector>
+
+namespace kero {
+
+    struct Sorted_options {
+        // Number of worker threads. 0 means one per hardware thread.
+        uint64_t nb_threads = 0;
+        // Memory in bytes used by the sort on top of the result arrays. 0 means unbounded: the file is
+        // decoded once and the peak memory is about twice the result. Otherwise the k-mers are split in
+        // ranges of their first nucleotides that are decoded and sorted one after the other, the file
+        // being decoded once more per range: the limit should stay a sizable fraction of the result.
+        uint64_t memory_limit = 0;
+    };
+
+    struct Sorted_kmers {
+        uint64_t k = 0;
+        uint64_t data_size = 0;
+        // K-mers in increasing order, first nucleotide on the high bits. Duplicates are kept.
+        std::vector<uint64_t> kmers;
+        // data_size bytes per k-mer, in the order of the k-mers
+        std::vector<uint8_t> data;
+        // Number of decoding passes over the file (including the counting pass of the bounded mode)
+        uint64_t nb_passes = 0;
+    };
+
+    /**
+     * @brief Load all the k-mers of a kero file, sorted, with their data.
+     *
+     * @param input Path of the kero file. k must be at most 32 and the same in all the sections.
+     * @param options Threads and memory settings.
+     *
+     * @return The sorted k-mers and their data.
+     */
+    Sorted_kmers load_sorted_kmers(const std::string& input, const Sorted_options& options = Sorted_options());
+
+    /**
+     * @brief Sort k-mers and their data in parallel (LSD radix sort, 8 bits per pass).
+     * The sort is stable. The digits shared by all the k-mers are skipped.
+     *
+     * @param kmers K-mers to sort, only the nb_bits lower bits are used.
+     * @param data data_size bytes per k-mer, moved with the k-mers. Can be empty if data_size is 0.
+     * @param nb_bits Number of significant bits of the k-mers (2k).
+     * @param nb_threads Number of threads, 0 means one per hardware thread.
+     */
+    void radix_sort_kmers(std::vector<uint64_t>& kmers, std::vector<uint8_t>& data, uint64_t data_size,
+                          uint64_t nb_bits, uint64_t nb_threads = 0);
+
+} // namespace kero
+
+#endif //KERO_SORTED_HPP
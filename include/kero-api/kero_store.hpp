@@ -0,0 +1,188 @@
+/**
+* @file kero_store.hpp
+ *
+ * @brief This file defines a k-mer store made of several immutable kero files (log-structured merge).
+ *
+ * The k-mers inserted are gathered in memory, then written as a small kero file of level 0. When level 0
+ * has enough files, they are merged with the file of level 1, and every level above holds a single file
+ * that is merged into the next one when it grows past its size limit. A merge is partitioned by
+ * minimizer: the sections of a minimizer in all the input files are decoded and merged together,
+ * independently of the other minimizers, so the merges run in parallel and never hold more than a batch
+ * of partitions in memory.
+ *
+ * The lookups visit the memory table, then the files from the newest to the oldest. Each file keeps the
+ * set of its minimizers in memory, so only the files that have a section for the minimizer of the k-mer
+ * are read, through their hashtable.
+ *
+ * The files of the store are listed in a manifest (MANIFEST in the directory of the store), replaced
+ * atomically after every flush and merge.
+ *
+ */
+
+#ifndef KERO_STORE_HPP
+#define KERO_STORE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace kero {
+
+    // Combination of the data of a k-mer present in several files
+    enum class Store_merge : uint8_t {
+        sum = 0,      // The data are big endian counters (data_size <= 8), added with saturation
+        replace = 1,  // The data of the most recent insertion is kept
+    };
+
+    struct Store_options {
+        // Parameters of the k-mers. They are recorded in the manifest: when the store already exists,
+        // the recorded values are used.
+        uint64_t k = 31;
+        uint64_t m = 11;
+        uint64_t data_size = 4;
+        Store_merge merge = Store_merge::sum;
+
+        // Number of distinct k-mers kept in memory before they are written to a level 0 file
+        uint64_t memtable_kmers = 1ull << 20;
+        // Number of level 0 files that triggers their merge into level 1
+        uint64_t level0_files = 4;
+        // Size limit in bytes of the level 1 file. The limit of each following level is level_ratio
+        // times the one of the previous level.
+        uint64_t level1_bytes = 64ull << 20;
+        uint64_t level_ratio = 10;
+        // Merge the levels in a background thread. When false, the merges run in the call that
+        // writes the level 0 file.
+        bool background = true;
+        // Number of threads of a merge. 0 means one per hardware thread.
+        uint64_t nb_threads = 0;
+        // Number of minimizer partitions merged together in memory.
+        uint64_t batch_size = 1024;
+    };
+
+    struct Store_stats {
+        uint64_t memtable_kmers = 0;   // Distinct k-mers in memory
+        uint64_t nb_flushes = 0;       // Level 0 files written
+        uint64_t nb_merges = 0;        // Merges done
+        uint64_t bytes_flushed = 0;    // Bytes of the level 0 files
+        uint64_t bytes_merged = 0;     // Bytes of the files written by the merges
+        uint64_t files_read = 0;       // Files read by the lookups
+        uint64_t files_skipped = 0;    // Files skipped by the lookups thanks to their minimizer set
+        std::vector<uint64_t> level_files;  // Number of files in each level
+        std::vector<uint64_t> level_bytes;  // Size of each level
+    };
+
+    class Kero_store {
+    private:
+        struct Store_file;
+        struct Memtable_partition {
+            std::unordered_map<uint64_t, uint64_t> index;  // k-mer -> rank of its data
+            std::vector<uint8_t> data;
+        };
+
+        std::string directory;
+        Store_options options;
+        uint64_t max;  // Maximal number of k-mers in a block of the files
+
+        // Protects the memory table, the levels and the manifest
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Memtable_partition> memtable;
+        uint64_t memtable_size;
+        // Files of each level, the most recent first
+        std::vector<std::vector<std::shared_ptr<Store_file>>> levels;
+        uint64_t next_file_id;
+        Store_stats counters;
+
+        // Background merges
+        std::thread merger;
+        std::condition_variable merge_needed;
+        std::condition_variable merge_done;
+        bool merging;
+        bool stopping;
+        std::exception_ptr merge_error;
+
+        void load_manifest();
+        void write_manifest();
+        std::string file_path(uint64_t level, uint64_t id) const;
+        std::shared_ptr<Store_file> open_file(uint64_t level, uint64_t id);
+        void flush_locked(std::unique_lock<std::mutex>& lock);
+        // Level to merge into the next one, or -1 if the levels are within their limits
+        int64_t level_to_merge() const;
+        void merge_level(std::unique_lock<std::mutex>& lock, uint64_t level);
+        void merge_pending(std::unique_lock<std::mutex>& lock);
+        void run_merger();
+        void rethrow_merge_error();
+        void combine(uint8_t* into, const uint8_t* newer) const;
+
+    public:
+        /**
+         * Open a store, or create it if the directory has no manifest.
+         * The files of the directory named like store files but absent from the manifest (left by an
+         * interrupted merge) are removed.
+         *
+         * @param directory Directory of the store, created if absent.
+         * @param options Parameters and compaction settings.
+         */
+        Kero_store(const std::string& directory, const Store_options& options = Store_options());
+        /**
+         * Write the memory table, then wait for the merges in progress. The levels may stay over their
+         * limits: the next opening resumes the merges.
+         */
+        ~Kero_store();
+        Kero_store(const Kero_store&) = delete;
+        Kero_store& operator=(const Kero_store&) = delete;
+
+        /**
+         * Add a k-mer. Its data is combined with the data of the previous insertions of the k-mer
+         * (see Store_merge). Writes a level 0 file when the memory table is full.
+         *
+         * @param minimizer The minimizer of the k-mer (2 bits per nucleotide), present in the k-mer.
+         * @param kmer The k-mer value (2 bits per nucleotide, k <= 32).
+         * @param data data_size bytes.
+         */
+        void insert(uint64_t minimizer, uint64_t kmer, const uint8_t* data);
+
+        /**
+         * Write the memory table as a level 0 file, if it is not empty.
+         */
+        void flush();
+
+        /**
+         * Look for a k-mer in the memory table and the files.
+         *
+         * @param minimizer The minimizer of the k-mer.
+         * @param kmer The k-mer value (2 bits per nucleotide, k <= 32).
+         * @param data If not null and the k-mer is found, filled with its data_size bytes of data.
+         *
+         * @return True if the k-mer is present.
+         */
+        bool find_kmer(uint64_t minimizer, uint64_t kmer, uint8_t* data);
+
+        /**
+         * Write the memory table, then merge all the levels into a single file.
+         */
+        void compact();
+
+        /**
+         * Wait until the levels are within their limits. Rethrows the error of a background merge.
+         */
+        void wait_merges();
+
+        /**
+         * @return Paths of the files of the store, from the most recent to the oldest.
+         */
+        std::vector<std::string> files() const;
+
+        Store_stats stats() const;
+
+        const Store_options& get_options() const { return options; }
+    };
+
+} // namespace kero
+
+#endif //KERO_STORE_HPP
@@ -0,0 +1,60 @@
+/**
+* @file kero_unitig.hpp
+ *
+ * @brief This file defines the unitig compaction stage of kero files.
+ *
+ * The k-mers of each minimizer section ('M') are assembled into maximal non-branching paths
+ * and written back as raw sequence sections ('r') with their per-k-mer data.
+ * Each minimizer section is an independent partition, so the partitions are compacted in
+ * parallel without any global k-mer table.
+ *
+ */
+
+#ifndef KERO_UNITIG_HPP
+#define KERO_UNITIG_HPP
+
+#include <string>
+#include <cstdint>
+
+namespace kero {
+
+    struct Unitig_options {
+        // Number of worker threads. 0 means one per hardware thread.
+        uint64_t nb_threads = 0;
+        // Maximal number of k-mers in an output block. 0 keeps the "max" variable of the input file.
+        uint64_t max_kmers = 0;
+        // Number of partitions loaded in memory and compacted together.
+        uint64_t batch_size = 1024;
+    };
+
+    struct Unitig_stats {
+        uint64_t nb_partitions = 0;     // Number of input sections compacted
+        uint64_t nb_kmers = 0;          // Number of k-mers read (and written)
+        uint64_t nb_input_blocks = 0;   // Number of super-k-mers read
+        uint64_t nb_unitigs = 0;        // Number of blocks written
+        uint64_t input_nucleotides = 0; // Nucleotides of the input super-k-mers
+        uint64_t output_nucleotides = 0;// Nucleotides of the output unitigs
+    };
+
+    /**
+     * @brief Compact the k-mers of a kero file into unitigs.
+     *
+     * Every 'M' (and 'r') section of the input is a partition. Inside a partition, the k-mers are linked
+     * when they overlap by k-1 nucleotides and the maximal non-branching paths are written as blocks of
+     * one 'r' section per partition, the data of each k-mer being kept in the path order.
+     * Branching is evaluated inside the partition only: paths are never joined across two minimizers,
+     * so the output holds exactly the input k-mers but a unitig of the full graph can be cut at a
+     * minimizer change. Only the forward strand is followed.
+     *
+     * @param input Path of the kero file to compact. k must be at most 32.
+     * @param output Path of the kero file to create.
+     * @param options Threads and block size settings.
+     *
+     * @return Counters on the compaction.
+     */
+    Unitig_stats compact_unitigs(const std::string& input, const std::string& output,
+                                 const Unitig_options& options = Unitig_options());
+
+} // namespace kero
+
+#endif //KERO_UNITIG_HPP
@@ -0,0 +1,102 @@
+/**
+* @file kero_update.hpp
+ *
+ * @brief This file defines the in-place updates of the data of the k-mers of a kero file.
+ *
+ * In the row and uncompressed columnar layouts, the data of each k-mer are stored as is at a position
+ * that only depends on the position of the k-mer in its minimizer section. The k-mers are found through
+ * the hashtable of the file, their sections are scanned once to locate their data, and the new data
+ * are written through a shared read-write mapping of the file: the file keeps its size and its
+ * structure, only the data bytes change.
+ *
+ */
+
+#ifndef KERO_UPDATE_HPP
+#define KERO_UPDATE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kero-api/kero_batch.hpp"
+#include "kero-api/kero_mmap.hpp"
+
+class Kero_file;
+
+namespace kero {
+
+    // Position of the data of an absent k-mer
+    constexpr uint64_t NO_DATA_POSITION = UINT64_MAX;
+
+    class Data_updater {
+    private:
+        std::unique_ptr<Kero_file> file;
+        std::unique_ptr<Kero_Mmap_Accessor> mapping;
+        uint64_t data_size;
+
+    public:
+        /**
+         * Open a kero file for in-place data updates, load its hashtable and map it read-write.
+         *
+         * @param filename Path of a kero file with a hashtable. Its minimizer sections must use the row or
+         * the uncompressed columnar layout (KERO_LAYOUT_ROW, KERO_LAYOUT_COLUMNAR_NOCOMP).
+         */
+        explicit Data_updater(const std::string& filename);
+        ~Data_updater();
+        Data_updater(const Data_updater&) = delete;
+        Data_updater& operator=(const Data_updater&) = delete;
+
+        /**
+         * Locate the data of a batch of k-mers. The queries are grouped by minimizer section, and each
+         * section is scanned once, in the order of the file.
+         *
+         * @param queries The k-mers to locate, with their minimizers.
+         * @param positions Resized to the number of queries: the file position of the data of each k-mer,
+         * NO_DATA_POSITION if the k-mer is absent.
+         *
+         * @return The number of k-mers found.
+         */
+        uint64_t locate(const std::vector<Kmer_query>& queries, std::vector<uint64_t>& positions);
+
+        /**
+         * @return A pointer to the data_size bytes of data of a k-mer in the mapping, nullptr if the k-mer is
+         * absent. The data can be read and modified in place.
+         */
+        uint8_t* data(uint64_t minimizer, uint64_t kmer);
+
+        /**
+         * Replace the data of a k-mer.
+         *
+         * @return False if the k-mer is absent.
+         */
+        bool update(uint64_t minimizer, uint64_t kmer, const uint8_t* data);
+
+        /**
+         * Replace the data of a batch of k-mers. The k-mers are located with locate, then the data are
+         * written in the order of their positions in the file. When a k-mer is queried several times, the
+         * data of its last query is kept.
+         *
+         * @param queries The k-mers to update, with their minimizers.
+         * @param data data_size bytes per query, in the order of the queries.
+         * @param found If not null, resized to the number of queries, found[i] is 1 if the k-mer i was updated.
+         *
+         * @return The number of queries applied.
+         */
+        uint64_t update(const std::vector<Kmer_query>& queries, const uint8_t* data,
+                        std::vector<uint8_t>* found = nullptr);
+
+        /**
+         * Write the modified pages to the file and wait for the writes. Without it, the kernel writes
+         * them back later: the updates are visible to the other readers of the file in any case.
+         *
+         * @return false if the kernel refused the synchronization.
+         */
+        bool sync();
+
+        uint64_t get_data_size() const { return data_size; }
+    };
+
+} // namespace kero
+
+#endif //KERO_UPDATE_HPP
@@ -0,0 +1,497 @@
+/**
+* @file kero_batch.cpp
+ *
+ * @brief This file implements the batched k-mer lookups of kero files.
+ *
+ */
+
+#include "kero-api/kero_batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef KERO_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/threads.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    // One read per section needed by a batch, with the queries that map to it
+    struct Batch_lookup::Section_read {
+        uint64_t position = 0;
+        uint64_t size = 0;
+        std::vector<uint64_t> queries;
+        // io_uring only: destination of the read and number of bytes already read
+        std::vector<uint8_t> buffer;
+        uint64_t done = 0;
+    };
+
+    namespace {
+
+        // Maximal number of entries of the io_uring submission queue
+        constexpr uint64_t MAX_QUEUE_DEPTH = 4096;
+
+        uint64_t load_u64(const uint8_t* ptr) {
+            uint64_t value;
+            load_big_endian(ptr, 8, value);
+            return value;
+        }
+
+        void pread_all(int fd, uint8_t* buffer, uint64_t size, uint64_t position) {
+            uint64_t done = 0;
+            while (done < size) {
+                ssize_t nb_read = pread(fd, buffer + done, size - done, static_cast<off_t>(position + done));
+                if (nb_read < 0 and errno == EINTR)
+                    continue;
+                if (nb_read < 0)
+                    throw std::runtime_error(std::string("Batch_lookup: read error: ") + strerror(errno));
+                if (nb_read == 0)
+                    throw std::runtime_error("Batch_lookup: unexpected end of file");
+                done += static_cast<uint64_t>(nb_read);
+            }
+        }
+
+        /* The queries of a section whose minimizer is the one of the section, sorted by k-mer. */
+        class Pending_queries {
+        private:
+            std::vector<std::pair<uint64_t, uint64_t>> kmers;  // (k-mer, query index)
+            uint64_t remaining;
+
+        public:
+            Pending_queries(const std::vector<uint64_t>& indexes, const std::vector<Kmer_query>& queries,
+                            uint64_t minimizer, uint64_t m) {
+                for (uint64_t i : indexes) {
+                    if (mask_mini(queries[i].minimizer, m) == minimizer)
+                        kmers.emplace_back(queries[i].kmer, i);
+                }
+                std::sort(kmers.begin(), kmers.end());
+                remaining = kmers.size();
+            }
+
+            bool empty() const { return remaining == 0; }
+
+            /* Mark the queries found among the k-mers of a super k-mer. The first occurrence of a k-mer
+             * gives its data, as in Section_Minimizer::find_kmer.
+             */
+            void match(const uint64_t* skmer_kmers, uint64_t nb_kmers, const uint8_t* skmer_data,
+                       uint64_t data_size, std::vector<uint8_t>& found, std::vector<uint8_t>* data) {
+                for (uint64_t i = 0; i < nb_kmers and remaining > 0; i++) {
+                    auto it = std::lower_bound(kmers.begin(), kmers.end(), std::make_pair(skmer_kmers[i], uint64_t(0)));
+                    for (; it != kmers.end() and it->first == skmer_kmers[i]; ++it) {
+                        if (found[it->second])
+                            continue;
+                        found[it->second] = 1;
+                        remaining -= 1;
+                        if (data != nullptr and data_size > 0)
+                            memcpy(data->data() + it->second * data_size, skmer_data + i * data_size, data_size);
+                    }
+                }
+            }
+        };
+
+        /* Decode the integer columns of an in memory section. */
+        template<class Codec>
+        void load_columns(const uint8_t* section, const uint64_t* offsets, uint64_t nb_blocks, uint64_t data_size,
+                          std::vector<uint64_t>& n_values, std::vector<uint64_t>& m_idx_values,
+                          std::vector<uint8_t>& data_values) {
+            Codec::load_u64(section + offsets[0], nb_blocks, n_values);
+            Codec::load_u64(section + offsets[1], nb_blocks, m_idx_values);
+            if (data_size > 0)
+                Codec::load_u8(section + offsets[2], data_values);
+        }
+
+    } // namespace
+
+
+    Batch_lookup::Batch_lookup(const std::string& filename, const Batch_options& options)
+        : filename(filename), options(options), fd(-1), uring_available(false) {
+        this->file.reset(new Kero_file(filename, "r"));
+        if (not this->file->hashtable_discovery())
+            throw std::runtime_error("Batch_lookup: no hashtable in " + filename);
+
+        auto& vars = this->file->global_vars;
+        for (const char* name : {"k", "m", "max", "data_size"}) {
+            if (vars.find(name) == vars.end())
+                throw std::runtime_error(std::string("Batch_lookup: missing ") + name + " variable");
+        }
+        this->k = vars["k"];
+        this->m = vars["m"];
+        this->data_size = vars["data_size"];
+        auto layout_var = vars.find("layout");
+        this->layout = layout_var != vars.end() ? layout_var->second : this->file->layout;
+
+        // A section ends where the next known section starts
+        for (uint64_t position : this->file->hashtable->mpht.hashtable) {
+            if (position < this->file->end_position)
+                this->boundaries.push_back(position);
+        }
+        for (const auto& it : this->file->section_positions)
+            this->boundaries.push_back(static_cast<uint64_t>(it.first));
+        this->boundaries.push_back(this->file->end_position);
+        std::sort(this->boundaries.begin(), this->boundaries.end());
+        this->boundaries.erase(std::unique(this->boundaries.begin(), this->boundaries.end()), this->boundaries.end());
+
+        this->fd = open(filename.c_str(), O_RDONLY);
+        if (this->fd < 0)
+            throw std::runtime_error("Batch_lookup: cannot open " + filename + ": " + strerror(errno));
+
+#ifdef KERO_HAVE_LIBURING
+        // io_uring can be compiled in but refused by the kernel (old kernel, seccomp filters)
+        if (options.use_io_uring) {
+            struct io_uring ring;
+            if (io_uring_queue_init(1, &ring, 0) == 0) {
+                io_uring_queue_exit(&ring);
+                this->uring_available = true;
+            }
+        }
+#endif
+    }
+
+    Batch_lookup::~Batch_lookup() {
+        if (this->fd >= 0)
+            close(this->fd);
+    }
+
+    const char* Batch_lookup::backend_name() const {
+        return this->uring_available ? "io_uring" : "pread";
+    }
+
+    uint64_t Batch_lookup::find_kmers(const std::vector<Kmer_query>& queries, std::vector<uint8_t>& found,
+                                      std::vector<uint8_t>* data) {
+        found.assign(queries.size(), 0);
+        if (data != nullptr)
+            data->assign(queries.size() * this->data_size, 0);
+
+        // Group the queries by candidate section
+        std::vector<std::pair<uint64_t, uint64_t>> candidates;
+        candidates.reserve(queries.size());
+        for (uint64_t i = 0; i < queries.size(); i++) {
+            uint64_t candidate = this->file->hashtable->mpht.find(mask_mini(queries[i].minimizer, this->m));
+            if (candidate < this->file->end_position)
+                candidates.emplace_back(candidate, i);
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        std::vector<Section_read> reads;
+        for (const auto& candidate : candidates) {
+            if (reads.empty() or reads.back().position != candidate.first) {
+                reads.emplace_back();
+                Section_read& read = reads.back();
+                read.position = candidate.first;
+                auto next = std::upper_bound(this->boundaries.begin(), this->boundaries.end(), candidate.first);
+                read.size = (next != this->boundaries.end() ? *next : this->file->end_position) - candidate.first;
+            }
+            reads.back().queries.push_back(candidate.second);
+        }
+
+        if (not (this->uring_available and this->read_with_uring(reads, queries, found, data))) {
+            this->uring_available = false;
+            this->read_with_threads(reads, queries, found, data);
+        }
+
+        uint64_t nb_found = 0;
+        for (uint8_t is_found : found)
+            nb_found += is_found;
+        return nb_found;
+    }
+
+    /* Decode a section read in memory and look for its queries. The layout mirrors the precaching of the
+     * columns from a memory mapping (see Row_layout and Columnar_layout).
+     */
+    void Batch_lookup::scan_bytes(const uint8_t* bytes, uint64_t size, Section_read& read,
+                                  const std::vector<Kmer_query>& queries, std::vector<uint8_t>& found,
+                                  std::vector<uint8_t>* data) const {
+        uint64_t nb_bytes_mini = bytes_from_bit_array(2, this->m);
+        uint64_t header_size = 1 + nb_bytes_mini + 8;
+        if (size < header_size or bytes[0] != 'M')
+            throw std::runtime_error("Batch_lookup: no minimizer section at byte " + std::to_string(read.position));
+
+        uint64_t minimizer = mask_mini(bytes + 1, this->m);
+        Pending_queries pending(read.queries, queries, minimizer, this->m);
+        if (pending.empty())
+            return;
+
+        uint64_t nb_blocks = load_u64(bytes + 1 + nb_bytes_mini);
+        uint64_t max_kmers = 0;
+        std::vector<uint64_t> kmers;
+        auto scan_skmer = [&](const uint8_t* seq, uint64_t n, uint64_t mini_pos, const uint8_t* skmer_data) {
+            if (n > max_kmers) {
+                max_kmers = n;
+                kmers.resize(n);
+            }
+            skmer_to_kmers(seq, n, this->k, minimizer, this->m, mini_pos, kmers.data());
+            pending.match(kmers.data(), n, skmer_data, this->data_size, found, data);
+        };
+        const std::string truncated = "Batch_lookup: truncated minimizer section at byte " + std::to_string(read.position);
+
+        if (this->layout == KERO_LAYOUT_ROW) {
+            // Rows: [n:8B][m_idx:8B][seq][data]
+            uint64_t row = header_size;
+            for (uint64_t b = 0; b < nb_blocks and not pending.empty(); b++) {
+                if (row + 16 > size)
+                    throw std::runtime_error(truncated);
+                uint64_t n = load_u64(bytes + row);
+                uint64_t mini_pos = load_u64(bytes + row + 8);
+                uint64_t seq_bytes = bytes_from_bit_array(2, n + this->k - this->m - 1);
+                if (row + 16 + seq_bytes + n * this->data_size > size)
+                    throw std::runtime_error(truncated);
+                scan_skmer(bytes + row + 16, n, mini_pos, bytes + row + 16 + seq_bytes);
+                row += 16 + seq_bytes + n * this->data_size;
+            }
+            return;
+        }
+
+        // Columns n, m_idx, data and seq, at offsets relative to the section
+        if (size < header_size + 32)
+            throw std::runtime_error(truncated);
+        uint64_t offsets[4];
+        for (uint64_t c = 0; c < 4; c++) {
+            offsets[c] = load_u64(bytes + header_size + 8 * c);
+            // The seq column has no header
+            if (offsets[c] + (c < 3 ? 8 : 0) > size or (c > 0 and offsets[c] < offsets[c - 1]))
+                throw std::runtime_error(truncated);
+        }
+        std::vector<uint64_t> n_values, m_idx_values;
+        std::vector<uint8_t> data_values;
+        if (this->layout == KERO_LAYOUT_COLUMNAR_NOCOMP)
+            load_columns<Plain_codec>(bytes, offsets, nb_blocks, this->data_size, n_values, m_idx_values, data_values);
+        else
+            load_columns<P4n_codec>(bytes, offsets, nb_blocks, this->data_size, n_values, m_idx_values, data_values);
+
+        uint64_t seq = offsets[3];
+        uint64_t data_pos = 0;
+        for (uint64_t b = 0; b < nb_blocks and not pending.empty(); b++) {
+            uint64_t n = n_values[b];
+            uint64_t seq_bytes = bytes_from_bit_array(2, n + this->k - this->m - 1);
+            if (seq + seq_bytes > size or data_pos + n * this->data_size > data_values.size())
+                throw std::runtime_error(truncated);
+            scan_skmer(bytes + seq, n, m_idx_values[b], data_values.data() + data_pos);
+            seq += seq_bytes;
+            data_pos += n * this->data_size;
+        }
+    }
+
+    /* Look for the queries of a section larger than the budget through the bounded stream path. */
+    void Batch_lookup::scan_stream(Kero_file& section_file, Section_read& read, const std::vector<Kmer_query>& queries,
+                                   std::vector<uint8_t>& found, std::vector<uint8_t>* data) const {
+        section_file.jump_to(read.position);
+        Section_Minimizer sm(&section_file);
+        uint64_t minimizer = mask_mini(sm.minimizer, this->m);
+        Pending_queries pending(read.queries, queries, minimizer, this->m);
+
+        std::vector<uint8_t> seq(bytes_from_bit_array(2, sm.k + sm.max - 1));
+        std::vector<uint8_t> skmer_data(sm.max * sm.data_size + 1);
+        std::vector<uint64_t> kmers(sm.max);
+        while (sm.remaining_blocks > 0 and not pending.empty()) {
+            uint64_t mini_pos;
+            uint64_t n = sm.read_compacted_sequence_without_mini(seq.data(), skmer_data.data(), mini_pos);
+            skmer_to_kmers(seq.data(), n, this->k, minimizer, this->m, mini_pos, kmers.data());
+            pending.match(kmers.data(), n, skmer_data.data(), this->data_size, found, data);
+        }
+    }
+
+    Thread_pool& Batch_lookup::thread_pool() {
+        if (this->pool == nullptr)
+            this->pool.reset(new Thread_pool(std::max<uint64_t>(1, this->options.queue_depth)));
+        return *this->pool;
+    }
+
+    std::unique_ptr<Kero_file> Batch_lookup::open_stream_file() const {
+        std::unique_ptr<Kero_file> section_file(new Kero_file(this->filename, "r"));
+        section_file->complete_header();
+        section_file->global_vars = this->file->global_vars;
+        return section_file;
+    }
+
+    void Batch_lookup::read_with_threads(std::vector<Section_read>& reads, const std::vector<Kmer_query>& queries,
+                                         std::vector<uint8_t>& found, std::vector<uint8_t>* data) {
+        if (reads.empty())
+            return;
+        uint64_t nb_threads = std::max<uint64_t>(1, std::min<uint64_t>(this->options.queue_depth, reads.size()));
+        std::atomic<uint64_t> next(0);
+
+        this->thread_pool().run(nb_threads, [&](uint64_t) {
+            // Each thread streams the large sections through its own Kero_file
+            std::unique_ptr<Kero_file> section_file;
+            std::vector<uint8_t> buffer;
+            try {
+                for (uint64_t r = next++; r < reads.size(); r = next++) {
+                    Section_read& read = reads[r];
+                    if (this->file->section_budget != 0 and read.size > this->file->section_budget) {
+                        if (section_file == nullptr)
+                            section_file = this->open_stream_file();
+                        this->scan_stream(*section_file, read, queries, found, data);
+                        continue;
+                    }
+                    buffer.resize(read.size);
+                    pread_all(this->fd, buffer.data(), read.size, read.position);
+                    this->scan_bytes(buffer.data(), read.size, read, queries, found, data);
+                }
+            } catch (...) {
+                // The other threads stop after their current read
+                next = reads.size();
+                throw;
+            }
+        });
+    }
+
+#ifdef KERO_HAVE_LIBURING
+
+    namespace {
+
+        /* Ring of a batch. On destruction, waits for the reads still in flight (after an error) so that
+         * the kernel does not write into freed buffers.
+         */
+        struct Batch_ring {
+            struct io_uring ring;
+            bool initialized = false;
+            uint64_t in_flight = 0;
+
+            ~Batch_ring() {
+                if (not initialized)
+                    return;
+                while (in_flight > 0) {
+                    struct io_uring_cqe* cqe;
+                    int ret = io_uring_wait_cqe(&ring, &cqe);
+                    if (ret == -EINTR)
+                        continue;
+                    if (ret < 0)
+                        break;
+                    io_uring_cqe_seen(&ring, cqe);
+                    in_flight -= 1;
+                }
+                io_uring_queue_exit(&ring);
+            }
+        };
+
+    } // namespace
+
+    /* Submit the reads of all the sections, queue_depth at a time, and decode each section as soon as its
+     * read completes. Short reads are resubmitted for the missing bytes.
+     */
+    bool Batch_lookup::read_with_uring(std::vector<Section_read>& reads, const std::vector<Kmer_query>& queries,
+                                       std::vector<uint8_t>& found, std::vector<uint8_t>* data) {
+        std::vector<Section_read*> to_read, to_stream;
+        for (Section_read& read : reads) {
+            if (this->file->section_budget != 0 and read.size > this->file->section_budget)
+                to_stream.push_back(&read);
+            else
+                to_read.push_back(&read);
+        }
+
+        uint64_t depth = std::max<uint64_t>(1, std::min(this->options.queue_depth, MAX_QUEUE_DEPTH));
+        depth = std::min<uint64_t>(depth, std::max<uint64_t>(1, to_read.size()));
+        Batch_ring batch;
+        if (not to_read.empty()) {
+            if (io_uring_queue_init(static_cast<unsigned>(depth), &batch.ring, 0) < 0)
+                return false;
+            batch.initialized = true;
+        }
+
+        auto drive_ring = [&]() {
+            std::vector<Section_read*> resubmit;
+            uint64_t next = 0, nb_done = 0;
+            while (nb_done < to_read.size()) {
+                while (batch.in_flight < depth and (not resubmit.empty() or next < to_read.size())) {
+                    struct io_uring_sqe* sqe = io_uring_get_sqe(&batch.ring);
+                    if (sqe == nullptr)
+                        break;
+                    Section_read* read;
+                    if (not resubmit.empty()) {
+                        read = resubmit.back();
+                        resubmit.pop_back();
+                    } else {
+                        read = to_read[next++];
+                        read->buffer.resize(read->size);
+                        read->done = 0;
+                    }
+                    io_uring_prep_read(sqe, this->fd, read->buffer.data() + read->done,
+                                       static_cast<unsigned>(std::min<uint64_t>(read->size - read->done, 1u << 30)),
+                                       read->position + read->done);
+                    io_uring_sqe_set_data(sqe, read);
+                    batch.in_flight += 1;
+                }
+
+                int ret = io_uring_submit_and_wait(&batch.ring, 1);
+                if (ret < 0 and ret != -EINTR)
+                    throw std::runtime_error(std::string("Batch_lookup: io_uring submission error: ") + strerror(-ret));
+
+                // Decode every completed section
+                struct io_uring_cqe* cqe;
+                while (io_uring_peek_cqe(&batch.ring, &cqe) == 0) {
+                    int result = cqe->res;
+                    auto* read = static_cast<Section_read*>(io_uring_cqe_get_data(cqe));
+                    io_uring_cqe_seen(&batch.ring, cqe);
+                    batch.in_flight -= 1;
+
+                    if (result == -EINTR or result == -EAGAIN) {
+                        resubmit.push_back(read);
+                        continue;
+                    }
+                    if (result < 0)
+                        throw std::runtime_error(std::string("Batch_lookup: read error: ") + strerror(-result));
+                    if (result == 0)
+                        throw std::runtime_error("Batch_lookup: unexpected end of file");
+                    read->done += static_cast<uint64_t>(result);
+                    if (read->done < read->size) {
+                        resubmit.push_back(read);
+                        continue;
+                    }
+
+                    this->scan_bytes(read->buffer.data(), read->size, *read, queries, found, data);
+                    std::vector<uint8_t>().swap(read->buffer);
+                    nb_done += 1;
+                }
+            }
+        };
+
+        if (to_stream.empty()) {
+            drive_ring();
+            return true;
+        }
+
+        // The calling thread drives the ring while the other threads of the pool scan the large
+        // sections, each one through its own Kero_file
+        std::atomic<uint64_t> next_stream(0);
+        this->thread_pool().run(1 + to_stream.size(), [&](uint64_t t) {
+            std::unique_ptr<Kero_file> section_file;
+            try {
+                if (t == 0 and batch.initialized)
+                    drive_ring();
+                for (uint64_t r = next_stream++; r < to_stream.size(); r = next_stream++) {
+                    if (section_file == nullptr)
+                        section_file = this->open_stream_file();
+                    this->scan_stream(*section_file, *to_stream[r], queries, found, data);
+                }
+            } catch (...) {
+                // The other threads stop after their current section
+                next_stream = to_stream.size();
+                throw;
+            }
+        });
+        return true;
+    }
+
+#else
+
+    bool Batch_lookup::read_with_uring(std::vector<Section_read>&, const std::vector<Kmer_query>&,
+                                       std::vector<uint8_t>&, std::vector<uint8_t>*) {
+        return false;
+    }
+
+#endif
+
+} // namespace kero
@@ -0,0 +1,50 @@
+/**
+* @file kero_chain.cpp
+ *
+ * @brief This file implements the packing of the k-mer chains into blocks.
+ *
+ */
+
+#include "kero-api/detail/chain.hpp"
+
+#include "kero-api/kero_io.hpp"
+
+namespace kero {
+
+    void Chain_blocks::append(const std::vector<uint64_t>& kmers, const std::vector<uint8_t>& kmer_data,
+                              const uint64_t* path, uint64_t size, uint64_t k, uint64_t data_size, uint64_t m,
+                              uint64_t mini_pos) {
+        uint64_t nb_nucl = size + k - 1 - m;
+        uint64_t seq_start = this->seqs.size();
+        this->seqs.resize(seq_start + bytes_from_bit_array(2, nb_nucl), 0);
+        uint8_t* seq = this->seqs.data() + seq_start;
+
+        // Right aligned sequence, the nucleotides of the minimizer are skipped
+        uint64_t pos = (4 - nb_nucl % 4) % 4;
+        uint64_t nucl_idx = 0;
+        auto push_nucl = [&](uint64_t nucl) {
+            if (nucl_idx < mini_pos or nucl_idx >= mini_pos + m) {
+                seq[pos / 4] |= static_cast<uint8_t>(nucl << (6 - 2 * (pos % 4)));
+                pos++;
+            }
+            nucl_idx++;
+        };
+
+        // First k-mer entirely, then the last nucleotide of each following one
+        uint64_t first = kmers[path[0]];
+        for (uint64_t i = 0; i < k; i++)
+            push_nucl((first >> (2 * (k - 1 - i))) & 0b11);
+        for (uint64_t i = 1; i < size; i++)
+            push_nucl(kmers[path[i]] & 0b11);
+
+        for (uint64_t i = 0; i < size; i++) {
+            const uint8_t* data = kmer_data.data() + path[i] * data_size;
+            this->data.insert(this->data.end(), data, data + data_size);
+        }
+
+        this->nb_kmers.push_back(size);
+        if (m > 0)
+            this->mini_pos.push_back(mini_pos);
+    }
+
+} // namespace kero
@@ -0,0 +1,372 @@
+/**
+* @file kero_concat.cpp
+ *
+ * @brief This file implements the concatenation, the re-indexation and the subsets of kero files.
+ *
+ */
+
+#include "kero-api/kero_concat.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    namespace {
+
+        // Variables that must be the same in all the concatenated files
+        const char* const SHARED_VARS[] = {"k", "m", "max", "data_size", "layout"};
+
+        bool is_footer_var(const std::string& name) {
+            return name == "first_index" or name == "footer_size";
+        }
+
+        /* Read a variable section into vars, without the footer variables. */
+        void read_vars(Kero_file& file, std::map<std::string, uint64_t>& vars) {
+            Section_GV sgv(&file);
+            sgv.close();
+            for (const auto& var : sgv.vars) {
+                if (not is_footer_var(var.first))
+                    vars[var.first] = var.second;
+            }
+        }
+
+        /* True if the file has a raw section. The index lists them, an unindexed file is walked from the
+         * section headers without reading the blocks.
+         */
+        bool has_raw_sections(Kero_file& file) {
+            if (file.indexed) {
+                for (const auto& it : file.section_positions) {
+                    if (it.second == 'r')
+                        return true;
+                }
+                return false;
+            }
+
+            std::map<std::string, uint64_t> vars;
+            file.complete_header();
+            while (file.tellp() < file.end_position) {
+                char type = file.read_section_type();
+
+                if (type == 'r')
+                    return true;
+                else if (type == 'v')
+                    read_vars(file, vars);
+                else if (type == 'M') {
+                    for (const auto& var : vars)
+                        file.global_vars[var.first] = var.second;
+                    Section_Minimizer sm(&file);
+                    uint64_t end = sm.section_end();
+                    sm.remaining_blocks = 0;
+                    sm.close();
+                    file.jump_to(end);
+                }
+                else if (type == 'i') {
+                    Section_Index si(&file);
+                    si.close();
+                }
+                else if (type == 'h')
+                    Section_Hashtable::skip(&file);
+                else
+                    throw std::runtime_error("Concatenation: unknown section type " + std::string(1, type)
+                                             + " in " + file.filename);
+            }
+            return false;
+        }
+
+        /* Copy the minimizer sections at the positions into a new file, with the header, the metadata and the
+         * variables of the input. The positions must come from the hashtable of the input.
+         */
+        Concat_stats write_subset(Kero_file& infile, const std::vector<uint8_t>& metadata, const std::string& output,
+                                  std::vector<uint64_t> positions) {
+            Concat_stats stats;
+            stats.nb_files = 1;
+            std::sort(positions.begin(), positions.end());
+
+            Kero_file outfile(output, "w");
+            outfile.write_encoding(infile.encoding);
+            outfile.set_uniqueness(infile.uniqueness);
+            outfile.set_canonicity(infile.canonicity);
+            outfile.write_metadata(infile.metadata_size, metadata.data());
+
+            // The variables of all the sections, as found by the hashtable discovery
+            std::map<std::string, uint64_t> vars(infile.global_vars.begin(), infile.global_vars.end());
+            Section_GV sgv(&outfile);
+            for (const auto& var : vars) {
+                if (not is_footer_var(var.first))
+                    sgv.write_var(var.first, var.second);
+            }
+            sgv.close();
+            stats.nb_variable_sections = 1;
+
+            for (uint64_t position : positions) {
+                uint64_t start = outfile.tellp();
+                infile.jump_to(position);
+                Section_Minimizer sm(&infile);
+                sm.copy_bytes(&outfile);
+                sm.close();
+                stats.nb_minimizer_sections += 1;
+                stats.nb_bytes += outfile.tellp() - start;
+            }
+
+            outfile.close();
+            return stats;
+        }
+
+        /* Read the metadata of a file just opened, then load its hashtable. */
+        std::vector<uint8_t> open_subset_input(Kero_file& infile) {
+            std::vector<uint8_t> metadata(infile.metadata_size);
+            infile.read_metadata(metadata.data());
+            if (not infile.hashtable_discovery())
+                throw std::runtime_error("Subset: " + infile.filename + " has no hashtable, reindex it first.");
+            return metadata;
+        }
+
+    } // namespace
+
+
+    bool Hash_range::contains(uint64_t minimizer) const {
+        uint64_t hash = minimizer_hash(minimizer);
+        return first <= hash and hash <= last;
+    }
+
+    Hash_range Hash_range::part(uint64_t part, uint64_t nb_parts) {
+        if (nb_parts == 0 or part >= nb_parts)
+            throw std::invalid_argument("Hash range: part " + std::to_string(part) + " out of " + std::to_string(nb_parts));
+        Hash_range range;
+        if (nb_parts == 1)
+            return range;
+
+        // Parts of floor(2^64 / nb_parts) hashes, the last one taking the rest
+        uint64_t size = UINT64_MAX / nb_parts + (UINT64_MAX % nb_parts == nb_parts - 1 ? 1 : 0);
+        range.first = part * size;
+        range.last = part == nb_parts - 1 ? UINT64_MAX : range.first + size - 1;
+        return range;
+    }
+
+
+    Concat_stats concatenate_files(const std::vector<std::string>& inputs, const std::string& output) {
+        Concat_stats stats;
+        if (inputs.empty())
+            throw std::invalid_argument("Concatenation: no input file.");
+
+        // The header flags are known before the first section, for the outputs that cannot be written back
+        bool uniqueness = true, canonicity = true;
+        for (const std::string& input : inputs) {
+            Kero_file infile(input, "r");
+            uniqueness = uniqueness and infile.uniqueness;
+            canonicity = canonicity and infile.canonicity;
+            if (uniqueness)
+                uniqueness = not has_raw_sections(infile);
+        }
+
+        Kero_file outfile(output, "w");
+        std::map<std::string, uint64_t> shared;       // First value of the shared variables
+        std::map<std::string, uint64_t> written;      // Variables of the last section written
+        std::unordered_set<uint64_t> minimizers;
+
+        auto fail = [](const std::string& message) {
+            throw std::runtime_error("Concatenation: " + message);
+        };
+
+        // Any error discards the output, without building its footer
+        try {
+            for (const std::string& input : inputs) {
+                Kero_file infile(input, "r");
+                stats.nb_files += 1;
+
+                // Header of the first file
+                if (stats.nb_files == 1) {
+                    outfile.write_encoding(infile.encoding);
+                    outfile.set_uniqueness(uniqueness);
+                    outfile.set_canonicity(canonicity);
+                    std::vector<uint8_t> metadata(infile.metadata_size);
+                    infile.read_metadata(metadata.data());
+                    outfile.write_metadata(infile.metadata_size, metadata.data());
+                } else if (memcmp(infile.encoding, outfile.encoding, 4) != 0) {
+                    fail("the encoding of " + input + " differs from the first file.");
+                }
+
+                std::map<std::string, uint64_t> vars;
+                infile.complete_header();
+                while (infile.tellp() < infile.end_position) {
+                    char type = infile.read_section_type();
+
+                    if (type == 'v') {
+                        read_vars(infile, vars);
+                        for (const char* name : SHARED_VARS) {
+                            auto var = vars.find(name);
+                            if (var == vars.end())
+                                continue;
+                            auto first = shared.emplace(name, var->second).first;
+                            if (first->second != var->second)
+                                fail(std::string("the ") + name + " variable of " + input + " differs from the previous files.");
+                        }
+                    }
+                    else if (type == 'M' or type == 'r') {
+                        // The variables of the section are written before it when they changed
+                        if (vars != written) {
+                            Section_GV sgv(&outfile);
+                            for (const auto& var : vars)
+                                sgv.write_var(var.first, var.second);
+                            sgv.close();
+                            written = vars;
+                            stats.nb_variable_sections += 1;
+                        }
+                        for (const auto& var : vars)
+                            infile.global_vars[var.first] = var.second;
+
+                        uint64_t start = outfile.tellp();
+                        if (type == 'M') {
+                            Section_Minimizer sm(&infile);
+                            if (not minimizers.insert(mask_mini(sm.minimizer, sm.m)).second)
+                                fail("the minimizer " + std::to_string(mask_mini(sm.minimizer, sm.m))
+                                     + " has a section in several files.");
+                            sm.copy_bytes(&outfile);
+                            sm.close();
+                            stats.nb_minimizer_sections += 1;
+                        } else {
+                            Section_Raw sr(&infile);
+                            sr.copy_bytes(&outfile);
+                            sr.close();
+                            stats.nb_raw_sections += 1;
+                        }
+                        stats.nb_bytes += outfile.tellp() - start;
+                    }
+                    else if (type == 'i') {
+                        Section_Index si(&infile);
+                        si.close();
+                    }
+                    else if (type == 'h') {
+                        Section_Hashtable::skip(&infile);
+                    }
+                    else {
+                        fail("unknown section type " + std::string(1, type) + " in " + input);
+                    }
+                }
+            }
+        } catch (...) {
+            outfile.close(false);
+            throw;
+        }
+
+        outfile.close();
+        return stats;
+    }
+
+
+    Concat_stats reindex_file(const std::string& path) {
+        Concat_stats stats;
+        std::map<long, char> positions;
+        std::vector<uint64_t> minimizers, mini_positions;
+
+        // Locate the sections from their headers
+        {
+            Kero_file infile(path, "r");
+            if (infile.indexed)
+                return stats;
+            stats.nb_files = 1;
+
+            std::map<std::string, uint64_t> vars;
+            infile.complete_header();
+            while (infile.tellp() < infile.end_position) {
+                uint64_t start = infile.tellp();
+                char type = infile.read_section_type();
+
+                if (type == 'v') {
+                    read_vars(infile, vars);
+                    positions[start] = 'v';
+                    stats.nb_variable_sections += 1;
+                }
+                else if (type == 'M' or type == 'r') {
+                    for (const auto& var : vars)
+                        infile.global_vars[var.first] = var.second;
+
+                    uint64_t end;
+                    if (type == 'M') {
+                        Section_Minimizer sm(&infile);
+                        minimizers.push_back(mask_mini(sm.minimizer, sm.m));
+                        mini_positions.push_back(start);
+                        end = sm.section_end();
+                        sm.remaining_blocks = 0;
+                        sm.close();
+                        stats.nb_minimizer_sections += 1;
+                    } else {
+                        Section_Raw sr(&infile);
+                        positions[start] = 'r';
+                        end = sr.section_end();
+                        sr.remaining_blocks = 0;
+                        sr.close();
+                        stats.nb_raw_sections += 1;
+                    }
+                    infile.jump_to(end);
+                    stats.nb_bytes += end - start;
+                }
+                else {
+                    throw std::runtime_error("Reindexation: unexpected section type " + std::string(1, type) + " in " + path);
+                }
+            }
+        }
+
+        // The hashtable can only hold one section per minimizer
+        std::unordered_set<uint64_t> distinct(minimizers.begin(), minimizers.end());
+        if (distinct.size() != minimizers.size())
+            throw std::runtime_error("Reindexation: a minimizer has several sections in " + path);
+
+        // Write the footer after the last section
+        Kero_file outfile(path, "a");
+        outfile.set_indexation(true);
+        for (const auto& it : positions)
+            outfile.section_positions[it.first] = it.second;
+        for (size_t i = 0; i < minimizers.size(); i++)
+            outfile.register_minimizer_section(minimizers[i], mini_positions[i]);
+        outfile.close();
+
+        return stats;
+    }
+
+
+    Concat_stats extract_minimizers(const std::string& input, const std::string& output,
+                                    const std::vector<uint64_t>& minimizers) {
+        Kero_file infile(input, "r");
+        std::vector<uint8_t> metadata = open_subset_input(infile);
+
+        std::unordered_set<uint64_t> found;
+        std::vector<uint64_t> positions;
+        for (uint64_t minimizer : minimizers) {
+            uint64_t position;
+            if (infile.find_minimizer_section(minimizer, position) and found.insert(position).second)
+                positions.push_back(position);
+        }
+
+        return write_subset(infile, metadata, output, positions);
+    }
+
+    Concat_stats extract_sections(const std::string& input, const std::string& output,
+                                  const std::function<bool(uint64_t)>& keep) {
+        Kero_file infile(input, "r");
+        std::vector<uint8_t> metadata = open_subset_input(infile);
+
+        std::vector<uint64_t> minimizers, section_positions, positions;
+        infile.minimizer_sections(minimizers, section_positions);
+        for (size_t i = 0; i < minimizers.size(); i++) {
+            if (keep(minimizers[i]))
+                positions.push_back(section_positions[i]);
+        }
+
+        return write_subset(infile, metadata, output, positions);
+    }
+
+    Concat_stats extract_hash_range(const std::string& input, const std::string& output, const Hash_range& range) {
+        return extract_sections(input, output, [&range](uint64_t minimizer) { return range.contains(minimizer); });
+    }
+
+} // namespace kero
@@ -0,0 +1,320 @@
+/**
+* @file kero_convert.cpp
+ *
+ * @brief This file implements the conversion of the sequence blocks of a kero file into minimizer sections.
+ *
+ */
+
+#include "kero-api/kero_convert.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "kero-api/kero_concat.hpp"
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/threads.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    namespace {
+
+        // Input blocks stored back to back
+        struct Block_batch {
+            std::vector<uint64_t> nb_kmers;
+            std::vector<uint64_t> seq_offsets;
+            std::vector<uint64_t> data_offsets;
+            std::vector<uint8_t> seqs;
+            std::vector<uint8_t> data;
+
+            void clear() {
+                nb_kmers.clear();
+                seq_offsets.clear();
+                data_offsets.clear();
+                seqs.clear();
+                data.clear();
+            }
+        };
+
+        struct Super_kmer {
+            uint64_t minimizer;
+            uint64_t nb_kmers;
+            uint64_t mini_pos;
+            uint64_t seq_offset;
+            uint64_t data_offset;
+        };
+
+        // Super k-mers of one range of blocks, the sequences stored without their minimizer
+        struct Skmer_chunk {
+            std::vector<Super_kmer> skmers;
+            std::vector<uint8_t> seqs;
+            std::vector<uint8_t> data;
+        };
+
+        /* Append the super k-mer made of the k-mers kmers[0..size) to the chunk. The nucleotides of the
+         * minimizer, at mini_pos, are skipped and the sequence is right aligned, like any kero block.
+         */
+        void append_skmer(Skmer_chunk& chunk, const uint64_t* kmers, uint64_t size, uint64_t minimizer,
+                          uint64_t mini_pos, const uint8_t* data, uint64_t k, uint64_t m, uint64_t data_size) {
+            uint64_t nb_nucl = size + k - 1 - m;
+            uint64_t seq_start = chunk.seqs.size();
+            chunk.seqs.resize(seq_start + bytes_from_bit_array(2, nb_nucl), 0);
+            uint8_t* seq = chunk.seqs.data() + seq_start;
+
+            uint64_t pos = (4 - nb_nucl % 4) % 4;
+            uint64_t nucl_idx = 0;
+            auto push_nucl = [&](uint64_t nucl) {
+                if (nucl_idx < mini_pos or nucl_idx >= mini_pos + m) {
+                    seq[pos / 4] |= static_cast<uint8_t>(nucl << (6 - 2 * (pos % 4)));
+                    pos++;
+                }
+                nucl_idx++;
+            };
+
+            // First k-mer entirely, then the last nucleotide of each following one
+            for (uint64_t i = 0; i < k; i++)
+                push_nucl((kmers[0] >> (2 * (k - 1 - i))) & 0b11);
+            for (uint64_t i = 1; i < size; i++)
+                push_nucl(kmers[i] & 0b11);
+
+            uint64_t data_start = chunk.data.size();
+            chunk.data.insert(chunk.data.end(), data, data + size * data_size);
+
+            chunk.skmers.push_back(Super_kmer{minimizer, size, mini_pos, seq_start, data_start});
+        }
+
+        /* Cut the blocks [first, last) of the batch into super k-mers. Only the super k-mers whose minimizer
+         * is in the range are kept.
+         */
+        void split_blocks(Block_batch& batch, uint64_t first, uint64_t last, Skmer_chunk& chunk,
+                          uint64_t k, uint64_t m, uint64_t data_size, const Hash_range& range) {
+            std::vector<uint64_t> kmers, mmers, orders;
+
+            for (uint64_t b = first; b < last; b++) {
+                uint64_t nb_kmers = batch.nb_kmers[b];
+                if (nb_kmers == 0)
+                    continue;
+                const uint8_t* seq = batch.seqs.data() + batch.seq_offsets[b];
+                const uint8_t* data = batch.data.data() + batch.data_offsets[b];
+                uint64_t seq_size = nb_kmers + k - 1;
+
+                kmers.resize(nb_kmers);
+                sequence_to_kmers(seq, seq_size, k, kmers.data());
+                mmers.resize(seq_size - m + 1);
+                sequence_to_kmers(seq, seq_size, m, mmers.data());
+                orders.resize(mmers.size());
+                for (uint64_t i = 0; i < mmers.size(); i++)
+                    orders[i] = minimizer_order(mmers[i]);
+
+                // Sliding minimizer: the m-mers of the k-mer i are [i, i + k - m]
+                uint64_t best = 0, start = 0;
+                for (uint64_t i = 0; i < nb_kmers; i++) {
+                    uint64_t previous = best;
+                    if (i == 0 or best < i) {
+                        best = i;
+                        for (uint64_t j = i + 1; j <= i + k - m; j++) {
+                            if (orders[j] < orders[best])
+                                best = j;
+                        }
+                    } else if (orders[i + k - m] < orders[best]) {
+                        best = i + k - m;
+                    }
+
+                    if (i > 0 and best != previous) {
+                        if (range.contains(mmers[previous]))
+                            append_skmer(chunk, kmers.data() + start, i - start, mmers[previous], previous - start,
+                                         data + start * data_size, k, m, data_size);
+                        start = i;
+                    }
+                }
+                if (range.contains(mmers[best]))
+                    append_skmer(chunk, kmers.data() + start, nb_kmers - start, mmers[best], best - start,
+                                 data + start * data_size, k, m, data_size);
+            }
+        }
+
+    } // namespace
+
+
+    Convert_stats convert_to_minimizers(const std::string& input, const std::string& output,
+                                        const Convert_options& options) {
+        Convert_stats stats;
+
+        uint64_t nb_threads = options.nb_threads;
+        if (nb_threads == 0)
+            nb_threads = std::max(1u, std::thread::hardware_concurrency());
+        uint64_t batch_blocks = std::max<uint64_t>(1, options.batch_blocks);
+        uint64_t nb_passes = std::max<uint64_t>(1, options.nb_passes);
+        uint64_t m = options.m;
+        if (m == 0)
+            throw std::invalid_argument("Conversion: m must be positive.");
+
+        Kero_file outfile(output, "w");
+        bool vars_written = false;
+        uint64_t k = 0, data_size = 0;
+
+        for (uint64_t pass = 0; pass < nb_passes; pass++) {
+            Hash_range range = Hash_range::part(pass, nb_passes);
+            Kero_file infile(input, "r");
+
+            if (pass == 0) {
+                outfile.write_encoding(infile.encoding);
+                outfile.set_uniqueness(infile.uniqueness);
+                outfile.set_canonicity(infile.canonicity);
+                std::vector<uint8_t> metadata(infile.metadata_size);
+                infile.read_metadata(metadata.data());
+                outfile.write_metadata(infile.metadata_size, metadata.data());
+            }
+
+            Block_batch batch;
+            std::vector<Skmer_chunk> chunks;
+
+            // Split the batch in parallel, one chunk per range of blocks
+            auto split_batch = [&]() {
+                uint64_t nb_blocks = batch.nb_kmers.size();
+                if (nb_blocks == 0)
+                    return;
+                uint64_t nb_ranges = std::min<uint64_t>(nb_blocks, 4 * nb_threads);
+                uint64_t first_chunk = chunks.size();
+                chunks.resize(first_chunk + nb_ranges);
+
+                std::atomic<uint64_t> next_range(0);
+                run_threads(std::min<uint64_t>(nb_threads, nb_ranges), [&](uint64_t) {
+                    uint64_t r;
+                    while ((r = next_range++) < nb_ranges)
+                        split_blocks(batch, r * nb_blocks / nb_ranges, (r + 1) * nb_blocks / nb_ranges,
+                                     chunks[first_chunk + r], k, m, data_size, range);
+                });
+
+                batch.clear();
+            };
+
+            std::map<std::string, uint64_t> vars;
+            std::vector<uint8_t> seq, data;
+            infile.complete_header();
+            while (infile.tellp() < infile.end_position) {
+                char type = infile.read_section_type();
+
+                if (type == 'v') {
+                    Section_GV sgv(&infile);
+                    sgv.close();
+                    for (const auto& var : sgv.vars)
+                        vars[var.first] = var.second;
+                }
+                else if (type == 'M' or type == 'r') {
+                    if (vars.find("k") == vars.end() or vars.find("data_size") == vars.end())
+                        throw std::runtime_error("Conversion: k or data_size missing before a sequence section.");
+                    if (k == 0) {
+                        k = vars["k"];
+                        data_size = vars["data_size"];
+                        if (k > 32)
+                            throw std::runtime_error("Conversion: k must be at most 32.");
+                        if (m > k)
+                            throw std::runtime_error("Conversion: m must be at most k.");
+                    } else if (vars["k"] != k or vars["data_size"] != data_size) {
+                        throw std::runtime_error("Conversion: k and data_size must be the same for all the sections.");
+                    }
+
+                    // Sections read the variables from the file
+                    for (const auto& var : vars)
+                        infile.global_vars[var.first] = var.second;
+
+                    std::unique_ptr<Block_section_reader> section(Block_section_reader::construct_section(&infile));
+                    seq.resize(bytes_from_bit_array(2, section->max + k - 1));
+                    data.resize(section->max * data_size);
+                    if (pass == 0)
+                        stats.nb_input_sections += 1;
+
+                    while (section->remaining_blocks > 0) {
+                        uint64_t nb_kmers = section->read_compacted_sequence(seq.data(), data.data());
+                        uint64_t seq_bytes = bytes_from_bit_array(2, nb_kmers + k - 1);
+                        batch.nb_kmers.push_back(nb_kmers);
+                        batch.seq_offsets.push_back(batch.seqs.size());
+                        batch.data_offsets.push_back(batch.data.size());
+                        batch.seqs.insert(batch.seqs.end(), seq.data(), seq.data() + seq_bytes);
+                        batch.data.insert(batch.data.end(), data.data(), data.data() + nb_kmers * data_size);
+                        if (pass == 0) {
+                            stats.nb_input_blocks += 1;
+                            stats.nb_kmers += nb_kmers;
+                        }
+
+                        if (batch.nb_kmers.size() >= batch_blocks)
+                            split_batch();
+                    }
+                }
+                else if (type == 'i') {
+                    Section_Index si(&infile);
+                    si.close();
+                }
+                else if (type == 'h') {
+                    Section_Hashtable sh(&infile);
+                    sh.close();
+                }
+                else {
+                    throw std::runtime_error("Conversion: unknown section type " + std::string(1, type));
+                }
+            }
+            split_batch();
+
+            if (k == 0)
+                break;
+            if (not vars_written) {
+                Section_GV sgv(&outfile);
+                sgv.write_var("k", k);
+                sgv.write_var("m", m);
+                sgv.write_var("max", k - m + 1);
+                sgv.write_var("data_size", data_size);
+                sgv.write_var("layout", outfile.layout);
+                sgv.close();
+                vars_written = true;
+            }
+
+            // Partition by minimizer, the super k-mers of a minimizer staying in the order of the input
+            struct Skmer_ref {
+                uint64_t minimizer;
+                uint64_t chunk;
+                uint64_t idx;
+            };
+            std::vector<Skmer_ref> refs;
+            for (uint64_t c = 0; c < chunks.size(); c++) {
+                for (uint64_t i = 0; i < chunks[c].skmers.size(); i++)
+                    refs.push_back(Skmer_ref{chunks[c].skmers[i].minimizer, c, i});
+            }
+            std::stable_sort(refs.begin(), refs.end(),
+                             [](const Skmer_ref& a, const Skmer_ref& b) { return a.minimizer < b.minimizer; });
+
+            uint8_t mini_bytes[8];
+            uint64_t nb_bytes_mini = bytes_from_bit_array(2, m);
+            for (uint64_t first = 0; first < refs.size();) {
+                uint64_t last = first;
+                while (last < refs.size() and refs[last].minimizer == refs[first].minimizer)
+                    last++;
+
+                store_big_endian(mini_bytes, nb_bytes_mini, refs[first].minimizer);
+                Section_Minimizer sm(&outfile);
+                sm.write_minimizer(mini_bytes);
+                for (uint64_t r = first; r < last; r++) {
+                    Skmer_chunk& chunk = chunks[refs[r].chunk];
+                    const Super_kmer& skmer = chunk.skmers[refs[r].idx];
+                    sm.write_compacted_sequence_without_mini(chunk.seqs.data() + skmer.seq_offset,
+                                                             skmer.nb_kmers + k - 1 - m, skmer.mini_pos,
+                                                             chunk.data.data() + skmer.data_offset);
+                }
+                sm.close();
+
+                stats.nb_super_kmers += last - first;
+                stats.nb_minimizer_sections += 1;
+                first = last;
+            }
+        }
+
+        outfile.close();
+        return stats;
+    }
+
+} // namespace kero
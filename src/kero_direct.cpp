@@ -0,0 +1,136 @@
+/**
+* @file kero_direct.cpp
+ *
+ * @brief This file implements the direct I/O reads of Kero_file.
+ *
+ */
+
+#include "kero-api/detail/direct_io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace kero {
+
+    namespace {
+
+        constexpr uint64_t NO_WINDOW = UINT64_MAX;
+
+        uint8_t* aligned_buffer(uint64_t size) {
+            void* buffer = nullptr;
+            if (posix_memalign(&buffer, DIRECT_ALIGNMENT, size) != 0)
+                throw std::bad_alloc();
+            return static_cast<uint8_t*>(buffer);
+        }
+
+    } // namespace
+
+    Direct_reader::Direct_reader(const std::string& filename, uint64_t file_size, uint64_t window_bytes)
+        : fd(-1), direct(false), file_size(file_size) {
+        this->window_bytes = std::max<uint64_t>(1, (window_bytes + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT) *
+                             DIRECT_ALIGNMENT;
+
+#ifdef O_DIRECT
+        this->fd = open(filename.c_str(), O_RDONLY | O_DIRECT);
+        this->direct = this->fd >= 0;
+#endif
+        if (this->fd < 0)
+            this->fd = open(filename.c_str(), O_RDONLY);
+        if (this->fd < 0)
+            throw std::runtime_error("Direct_reader: cannot open " + filename);
+
+        this->current.buffer = aligned_buffer(this->window_bytes);
+        this->ahead.buffer = aligned_buffer(this->window_bytes);
+        this->ahead.start = NO_WINDOW;
+    }
+
+    Direct_reader::~Direct_reader() {
+        // The buffer of the ahead window is in use until its read ends
+        if (this->ahead_read.valid())
+            this->ahead_read.wait();
+        free(this->current.buffer);
+        free(this->ahead.buffer);
+        close(this->fd);
+    }
+
+    /* Fill a window from an aligned position. Called from the read-ahead thread. */
+    uint64_t Direct_reader::load(uint8_t* buffer, uint64_t start) const {
+        uint64_t loaded = 0;
+        while (loaded < this->window_bytes) {
+            ssize_t nb_read = pread(this->fd, buffer + loaded, this->window_bytes - loaded,
+                                    static_cast<off_t>(start + loaded));
+            if (nb_read < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error(std::string("Direct_reader: read error: ") + strerror(errno));
+            }
+            if (nb_read == 0)
+                break;
+            loaded += static_cast<uint64_t>(nb_read);
+        }
+
+#ifdef POSIX_FADV_DONTNEED
+        // Without O_DIRECT, drop the pages that are now copied in the window
+        if (not this->direct and loaded > 0)
+            posix_fadvise(this->fd, static_cast<off_t>(start), static_cast<off_t>(loaded), POSIX_FADV_DONTNEED);
+#endif
+        return loaded;
+    }
+
+    void Direct_reader::start_ahead() {
+        uint64_t next = this->current.start + this->current.length;
+        if (this->current.length < this->window_bytes or next >= this->file_size) {
+            this->ahead.start = NO_WINDOW;
+            return;
+        }
+        this->ahead.start = next;
+        this->ahead.length = 0;
+        this->ahead_read = std::async(std::launch::async, &Direct_reader::load, this, this->ahead.buffer, next);
+    }
+
+    void Direct_reader::wait_ahead() {
+        if (this->ahead_read.valid())
+            this->ahead.length = this->ahead_read.get();
+    }
+
+    void Direct_reader::move_to(uint64_t position) {
+        if (this->ahead.start != NO_WINDOW and position >= this->ahead.start and
+            position < this->ahead.start + this->window_bytes) {
+            // Sequential progress: the window read in the background becomes the current one
+            this->wait_ahead();
+            std::swap(this->current, this->ahead);
+        } else {
+            // Random jump: the buffer of the ahead window is reused after its read
+            this->wait_ahead();
+            this->current.start = position / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+            this->current.length = this->load(this->current.buffer, this->current.start);
+        }
+        this->start_ahead();
+    }
+
+    void Direct_reader::read(uint8_t* bytes, uint64_t size, uint64_t position) {
+        if (position + size > this->file_size)
+            throw std::out_of_range("Direct_reader: read out of the file, Byte " + std::to_string(position + size));
+
+        while (size > 0) {
+            if (position < this->current.start or position >= this->current.start + this->current.length) {
+                this->move_to(position);
+                if (position >= this->current.start + this->current.length)
+                    throw std::runtime_error("Direct_reader: the file is shorter than expected");
+            }
+            uint64_t available = std::min(size, this->current.start + this->current.length - position);
+            memcpy(bytes, this->current.buffer + (position - this->current.start), available);
+            bytes += available;
+            position += available;
+            size -= available;
+        }
+    }
+
+} // namespace kero
@@ -20,14 +20,21 @@
 #include <iostream>
 #include <cassert>
 #include <cstring>
+#include <cerrno>
+#include <cstdlib>
 #include <sstream>
 #include <cmath>
+#include <climits>
 
 #include <map>
 #include <vector>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "kero-api/kero_io.hpp"
 #include "kero-api/detail/util.hpp"
+#include "kero-api/detail/prefetch.hpp"
 #include "ic.h"
 
 using namespace std;
@@ -43,16 +50,101 @@ uint64_t bytes_from_bit_array(uint64_t bits_per_elem, uint64_t nb_elem) {
 		return ((bits_per_elem * nb_elem - 1) / 8) + 1;
 }
 
-static void leftshift8(uint8_t * bitarray, size_t length, size_t bitshift);
-static void rightshift8(uint8_t * bitarray, size_t length, size_t bitshift);
-static uint8_t fusion8(uint8_t left_bits, uint8_t right_bits, size_t merge_index);
-static inline size_t p4nenc_bound(size_t n, size_t size);
+uint64_t read_u64(Kero_file & file) {
+	uint8_t buff[8];
+	uint64_t value;
+	file.read(buff, 8);
+	load_big_endian(buff, 8, value);
+	return value;
+}
+
+string create_temp_file(const string & directory, const string & name) {
+	string dir = directory;
+	if (dir.empty()) {
+		const char * tmpdir = getenv("TMPDIR");
+		dir = (tmpdir != nullptr and tmpdir[0] != '\0') ? tmpdir : "/tmp";
+	}
+	string path = dir + "/" + name + ".XXXXXX";
+	vector<char> pattern(path.begin(), path.end());
+	pattern.push_back('\0');
+
+	int fd = mkstemp(pattern.data());
+	if (fd < 0)
+		throw runtime_error("Impossible to create a temporary file " + path + ": " + strerror(errno));
+	::close(fd);
+	return string(pattern.data());
+}
+
 static inline size_t round_up(size_t n, size_t a);
 
+/* Standard input and the special files (FIFOs, character devices) can only be read forward. */
+static bool is_seekable_file(const string & filename) {
+	if (filename == "-")
+		return false;
+	struct stat st;
+	// A missing file is reported by the opening
+	if (stat(filename.c_str(), &st) != 0)
+		return true;
+	return S_ISREG(st.st_mode) or S_ISBLK(st.st_mode);
+}
+
+static string stream_path(const string & filename, bool output) {
+	if (filename == "-")
+		return output ? "/dev/stdout" : "/dev/stdin";
+	return filename;
+}
+
+/* Copy the bytes [begin, end) of a file at the end of another one, by pieces of at most 1 MB. */
+static void copy_file_bytes(Kero_file * from, uint64_t begin, uint64_t end, Kero_file * to) {
+	vector<uint8_t> piece(min<uint64_t>(end - begin, 1 << 20));
+	from->jump_to(begin);
+	for (uint64_t position = begin ; position < end ; position += piece.size()) {
+		piece.resize(min<uint64_t>(end - position, piece.size()));
+		from->read(piece.data(), piece.size());
+		to->write(piece.data(), piece.size());
+	}
+}
+
+/* True if the variables are declared with the same values in both files. */
+static bool same_vars(Kero_file * a, Kero_file * b, const vector<string> & names) {
+	for (const string & name : names) {
+		auto var_a = a->global_vars.find(name);
+		auto var_b = b->global_vars.find(name);
+		if (var_a == a->global_vars.end() or var_b == b->global_vars.end() or var_a->second != var_b->second)
+			return false;
+	}
+	return true;
+}
+
+/* Layout of the minimizer sections of a file: the "layout" variable, or the layout of the object. */
+static uint8_t file_layout(Kero_file * file) {
+	auto layout_var = file->global_vars.find("layout");
+	return layout_var != file->global_vars.end() ? static_cast<uint8_t>(layout_var->second) : file->layout;
+}
+
 
 // ----- Open / Close functions -----
 
 Kero_file::Kero_file(const string filename, const string mode) {
+	this->init(filename);
+	this->open(mode);
+}
+
+Kero_file::Kero_file() {
+	this->init("");
+	this->in_memory = true;
+	this->open("w");
+}
+
+Kero_file::Kero_file(const uint8_t * bytes, size_t size) {
+	this->init("");
+	this->in_memory = true;
+	this->memory_bytes = bytes;
+	this->file_size = size;
+	this->open("r");
+}
+
+void Kero_file::init(const string filename) {
 	// Variable init
 	this->filename = filename;
 
@@ -68,23 +160,51 @@ Kero_file::Kero_file(const string filename, const string mode) {
 	this->file_buffer = new uint8_t[this->buffer_size];
 	this->file_size = 0;
 	this->delete_on_destruction = false;
-
-	this->open(mode);
+	this->hashtable = nullptr;
+	this->direct_reader = nullptr;
+	this->streaming = false;
+	this->stream_window_start = 0;
+	this->in_memory = false;
+	this->memory_bytes = nullptr;
 }
 
 void Kero_file::open(string mode) {
 	this->writing_started = false;
 	this->current_position = 0;
+	this->previous_index = 0;
+	this->previous_minimizers.clear();
+
+	if (mode[0] == 'a') {
+		this->open_append();
+		return;
+	}
 
 	// Determine the mode and open the file
 	if (mode[0] == 'w') {
 		this->is_writer = true;
 		this->file_size = 0;
 		this->next_free = 0;
+		this->streaming = not this->in_memory and
+			((mode.size() > 1 and mode[1] == 's') or not is_seekable_file(this->filename));
 	} else if (mode[0] == 'r') {
 		this->is_reader = true;
+		this->streaming = false;
 		// If no info on the file
-		if (this->file_size == 0 and this->next_free == 0) {
+		if (this->file_size == 0 and this->next_free == 0 and not this->in_memory) {
+			this->streaming = (mode.size() > 1 and mode[1] == 's') or not is_seekable_file(this->filename);
+		}
+
+		if (this->streaming) {
+			this->fs.open(stream_path(this->filename, false), fstream::binary | fstream::in);
+			if (this->fs.fail()) {
+				std::string msg = "Cannot open file " + this->filename;
+				throw std::runtime_error(msg);
+			}
+			this->stream_window.clear();
+			this->stream_window_start = 0;
+		}
+		// If no info on the file
+		else if (this->file_size == 0 and this->next_free == 0 and not this->in_memory) {
 			// Open the fp
 			this->fs.open(this->filename, fstream::binary | fstream::in);
 			if (this->fs.fail()) {
@@ -155,6 +275,12 @@ void Kero_file::open(string mode) {
 		this->read(buff, 4);
 		load_big_endian(buff, 4, this->metadata_size);
 
+		// The end of a stream is found by the first section type that is the end signature
+		if (this->streaming) {
+			this->end_position = ULONG_MAX;
+			this->index_discovery_ended = true;
+			return;
+		}
 
 		// Footer integrity marker
 		unsigned long saved_position = this->tellp();
@@ -176,33 +302,103 @@ void Kero_file::open(string mode) {
 	}
 }
 
+void Kero_file::open_append() {
+	struct stat st;
+	if (stat(this->filename.c_str(), &st) != 0) {
+		this->open("w");
+		return;
+	}
+	if (this->in_memory or not S_ISREG(st.st_mode))
+		throw std::runtime_error("Kero_file: append mode needs a regular file");
+
+	// Read the footer, the index and the hashtable of the file
+	this->open("r");
+	bool was_indexed = this->indexed;
+	unsigned long end = this->end_position;
+	if (this->footer != nullptr) {
+		end -= this->footer->vars["footer_size"];
+		if (this->footer->vars.find("first_index") != this->footer->vars.end())
+			this->previous_index = this->footer->vars["first_index"];
+	}
+
+	// The new hashtable also covers the previous minimizer sections: their minimizers are in their headers
+	this->mini_list.clear();
+	this->mini_pos.clear();
+	this->previous_minimizers.clear();
+	if (not was_indexed or not this->minimizer_sections(this->mini_list, this->mini_pos))
+		this->global_vars_discovery();
+	this->previous_minimizers.insert(this->mini_list.begin(), this->mini_list.end());
+	std::unordered_map<std::string, uint64_t> vars = this->global_vars;
+	this->close();
+
+	// Only the sections written from now are in the new index
+	this->section_positions.clear();
+	if (this->footer != nullptr) {
+		delete this->footer;
+		this->footer = nullptr;
+	}
+	for (Section_Index * si : this->index)
+		delete si;
+	this->index.clear();
+	if (this->hashtable != nullptr) {
+		delete this->hashtable;
+		this->hashtable = nullptr;
+	}
+
+	// Remove the footer variables and the signature, then write after the last section
+	if (truncate(this->filename.c_str(), end) != 0)
+		throw std::runtime_error("Kero_file: cannot truncate " + this->filename);
+	this->fs.clear();
+	this->fs.open(this->filename, fstream::binary | fstream::out | fstream::in | fstream::ate);
+	if (this->fs.fail())
+		throw std::runtime_error("Cannot open file " + this->filename);
+
+	this->is_writer = true;
+	this->writing_started = true;
+	this->streaming = false;
+	this->tmp_closed = false;
+	this->file_size = end;
+	this->next_free = 0;
+	this->current_position = end;
+	this->header_over = true;
+	this->footer_discovery_ended = true;
+	this->indexed = was_indexed;
+	this->end_position = 0;
+	this->global_vars = vars;
+}
+
 void Kero_file::close(bool write_buffer) {
 	if (this->is_writer) {
-		// Write the index
-		if (this->indexed)
-			this->write_footer();
-		// Write the signature
-		char signature[] = {'K', 'E', 'R'};
-		this->write((uint8_t *)signature, 3);
-
-		// Write the end of the file
+		// A discarded file gets no footer
 		if (write_buffer) {
+			// Write the index
+			if (this->indexed)
+				this->write_footer();
+			// Write the signature
+			char signature[] = {'K', 'E', 'R'};
+			this->write((uint8_t *)signature, 3);
+		}
+
+		// Write the end of the file (an in-memory file keeps it in the buffer)
+		if (write_buffer and not this->in_memory) {
 			// The file was never opened
 			if (not this->writing_started) {
 				this->writing_started = true;
-				this->fs.open(this->filename, fstream::binary | fstream::out);
+				this->fs.open(stream_path(this->filename, true), fstream::binary | fstream::out);
 			} else if (this->tmp_closed) {
 				this->reopen();
 			}
 			// Write the buffer
 			this->fs.write((char *)this->file_buffer, this->next_free);
+			KERO_STATS_ADD(this->stats, write_calls, 1);
+			KERO_STATS_ADD(this->stats, bytes_written, this->next_free);
 			if (this->fs.fail()) {
 				cerr << "Filesystem problem during buffer disk saving" << endl;
 				exit(1);
 			}
 			this->file_size += this->next_free;
 			this->next_free = 0;
-		} else {
+		} else if (not write_buffer) {
 			this->delete_on_destruction = true;
 		}
 
@@ -215,6 +411,9 @@ void Kero_file::close(bool write_buffer) {
 		if (fs.is_open()) {
 			fs.close();
 		}
+		delete this->direct_reader;
+		this->direct_reader = nullptr;
+		std::vector<uint8_t>().swap(this->stream_window);
 	}
 
 	this->tmp_closed = false;
@@ -227,7 +426,7 @@ Kero_file::~Kero_file() {
 	this->close();
 
 	delete[] this->file_buffer;
-	if (this->delete_on_destruction and this->file_size > 0) {
+	if (this->delete_on_destruction and this->file_size > 0 and not this->streaming) {
 		remove(this->filename.c_str());
 	}
 
@@ -236,6 +435,9 @@ Kero_file::~Kero_file() {
 
 	for (Section_Index * si : this->index)
 		delete si;
+
+	if (this->hashtable != nullptr)
+		delete this->hashtable;
 }
 
 
@@ -283,6 +485,7 @@ void Kero_file::footer_discovery() {
 		ss << c;
 	}
 	if (ss.str().compare("footer_size") != 0) {
+		this->jump_to(current_pos);
 		return;
 	}
 	this->jump(1); // remove the '\0'
@@ -315,7 +518,7 @@ void Kero_file::index_discovery() {
 
 	// Search first section
 	if (not this->indexed) {
-		char type = this->fs.peek();
+		char type = this->read_section_type();
 		if (type == 'i') {
 			this->indexed = true;
 			this->read_index(this->tellp());
@@ -340,6 +543,9 @@ void Kero_file::read_index(long position) {
 		Section_Index * si = new Section_Index(this);
 		this->index.push_back(si);
 		si->close();
+		// Save the absolute positions (relative to the end of the index section)
+		for (auto & it : si->index)
+			this->section_positions[this->tellp() + it.first] = it.second;
 		// Update index position to the next index section
 		if (si->next_index == 0)
 			position = 0;
@@ -352,12 +558,58 @@ void Kero_file::read_index(long position) {
 }
 
 
+void Kero_file::global_vars_discovery() {
+	long current_pos = this->tellp();
+	bool header_over = this->header_over;
+	// The sections are read out of order, the header must not be completed again
+	this->header_over = true;
+
+	// Merge all the indexed variable sections
+	std::unordered_map<std::string, uint64_t> vars;
+	bool found = false;
+	for (auto & it : this->section_positions) {
+		if (it.second != 'v')
+			continue;
+		this->jump_to(it.first);
+		Section_GV sgv(this);
+		sgv.close();
+		for (auto & var : sgv.vars)
+			vars[var.first] = var.second;
+		found = true;
+	}
+
+	// Without index, only the section following the header (signature, flags, metadata) is looked at
+	if (not found) {
+		this->jump_to(12 + this->metadata_size);
+		if (this->read_section_type() == 'v') {
+			Section_GV sgv(this);
+			sgv.close();
+			for (auto & var : sgv.vars)
+				vars[var.first] = var.second;
+		}
+	}
+
+	this->global_vars = vars;
+
+	this->header_over = header_over;
+	this->jump_to(current_pos);
+}
+
+
 void Kero_file::read(uint8_t * bytes, unsigned long size) {
 	if (not this->is_reader) {
 		cerr << "Cannot read a file in writing mode." << endl;
 		exit(1);
 	}
 
+	// Read in the window of a stream
+	if (this->streaming) {
+		this->stream_fill(this->current_position + size);
+		memcpy(bytes, this->stream_window.data() + (this->current_position - this->stream_window_start), size);
+		this->current_position += size;
+		return;
+	}
+
 	// Read in the file
 	if (this->current_position < this->file_size) {
 		// Read the end of the file and the beginning of the buffer
@@ -367,6 +619,16 @@ void Kero_file::read(uint8_t * bytes, unsigned long size) {
 			this->read(bytes + fs_read_size, size - fs_read_size);
 			return;
 		}
+		// Read inside the memory span
+		else if (this->memory_bytes != nullptr) {
+			memcpy(bytes, this->memory_bytes + this->current_position, size);
+		}
+		// Read inside the file, through the direct I/O windows
+		else if (this->direct_reader != nullptr) {
+			this->direct_reader->read(bytes, size, this->current_position);
+			KERO_STATS_ADD(this->stats, read_calls, 1);
+			KERO_STATS_ADD(this->stats, bytes_read, size);
+		}
 		// Read inside the file
 		else {
 			// File not opened
@@ -375,6 +637,8 @@ void Kero_file::read(uint8_t * bytes, unsigned long size) {
 
 			// long tp = this->fs.tellp();
 			this->fs.read((char *)bytes, size);
+			KERO_STATS_ADD(this->stats, read_calls, 1);
+			KERO_STATS_ADD(this->stats, bytes_read, size);
 			if (this->fs.fail()) {
 				// cout << tp << endl;
 				cerr << "Impossible to read the file " << this->filename << " on disk." << endl;
@@ -398,6 +662,44 @@ void Kero_file::read(uint8_t * bytes, unsigned long size) {
 	this->current_position += size;
 }
 
+void Kero_file::stream_fill(unsigned long end) {
+	unsigned long window_end = this->stream_window_start + this->stream_window.size();
+	if (end <= window_end)
+		return;
+
+	unsigned long missing = end - window_end;
+	this->stream_window.resize(this->stream_window.size() + missing);
+	this->fs.read((char *)this->stream_window.data() + (window_end - this->stream_window_start), missing);
+	KERO_STATS_ADD(this->stats, read_calls, 1);
+	KERO_STATS_ADD(this->stats, bytes_read, this->fs.gcount());
+	if ((unsigned long)this->fs.gcount() != missing) {
+		string error = string("Read out of the stream, Byte ") + to_string(window_end + this->fs.gcount());
+		throw out_of_range(error);
+	}
+}
+
+void Kero_file::flush_stream() {
+	if (not this->is_writer or not this->streaming or this->next_free == 0)
+		return;
+
+	if (not this->writing_started) {
+		this->fs.open(stream_path(this->filename, true), fstream::binary | fstream::out);
+		this->writing_started = true;
+	}
+	this->fs.write((char*)this->file_buffer, this->next_free);
+	this->fs.flush();
+	KERO_STATS_ADD(this->stats, write_calls, 1);
+	KERO_STATS_ADD(this->stats, bytes_written, this->next_free);
+	KERO_STATS_ADD(this->stats, buffer_flushes, 1);
+	this->file_size += this->next_free;
+	this->next_free = 0;
+
+	if (this->fs.fail()) {
+		cerr << "File system error while writing " << this->filename << endl;
+		exit(1);
+	}
+}
+
 void Kero_file::write(const uint8_t * bytes, unsigned long size) {
 	if (not this->is_writer) {
 		if (this->is_reader)
@@ -409,8 +711,8 @@ void Kero_file::write(const uint8_t * bytes, unsigned long size) {
 
 	unsigned long buff_space = this->buffer_size - this->next_free;
 
-	// Resize buffer
-	while (buff_space < size and this->buffer_size < this->max_buffer_size) {
+	// Resize buffer. A stream keeps the current section in the buffer until the next one starts.
+	while (buff_space < size and (this->buffer_size < this->max_buffer_size or this->streaming or this->in_memory)) {
 		// Enlarge the buffer
 		this->buffer_size *= 2;
 		uint8_t * next_buffer = new uint8_t[this->buffer_size];
@@ -441,6 +743,9 @@ void Kero_file::write(const uint8_t * bytes, unsigned long size) {
 
 		this->fs.write((char*)this->file_buffer, this->next_free);
 		this->fs.write((char*)bytes, size);
+		KERO_STATS_ADD(this->stats, write_calls, 2);
+		KERO_STATS_ADD(this->stats, bytes_written, this->next_free + size);
+		KERO_STATS_ADD(this->stats, buffer_flushes, 1);
 		this->file_size += this->next_free + size;
 		this->next_free = 0;
 
@@ -467,6 +772,9 @@ void Kero_file::write_at(const uint8_t * bytes, unsigned long size, unsigned lon
 		exit(1);
 	}
 
+	if (this->streaming and position < this->file_size)
+		throw std::runtime_error("Kero_file: cannot write back before the current section of a stream");
+
 	// Write the file on disk
 	if (position < this->file_size) {
 		// Only in file
@@ -481,6 +789,9 @@ void Kero_file::write_at(const uint8_t * bytes, unsigned long size, unsigned lon
 				exit(1);
 			}
 			this->fs.seekp(this->file_size);
+			KERO_STATS_ADD(this->stats, seek_calls, 2);
+			KERO_STATS_ADD(this->stats, write_calls, 1);
+			KERO_STATS_ADD(this->stats, bytes_written, size);
 		}
 		// On both file and buffer
 		else {
@@ -511,6 +822,16 @@ unsigned long Kero_file::tellp() {
 	return this->current_position;
 }
 
+const uint8_t * Kero_file::memory_data() const {
+	if (not this->in_memory)
+		return nullptr;
+	return this->memory_bytes != nullptr ? this->memory_bytes : this->file_buffer;
+}
+
+unsigned long Kero_file::memory_size() const {
+	return this->file_size + this->next_free;
+}
+
 
 void Kero_file::jump(long size) {
 	// cout << "Jump " << this->current_position << " " << size << " / " << this->file_size << " " << this->next_free << endl;
@@ -518,6 +839,17 @@ void Kero_file::jump(long size) {
 }
 
 void Kero_file::jump_to(unsigned long position, bool from_end) {
+	// The bytes jumped over in a stream are read with the next bytes needed
+	if (this->streaming) {
+		if (from_end)
+			throw std::runtime_error("Kero_file: cannot jump from the end of a forward-only stream");
+		unsigned long first_position = this->is_writer ? this->file_size : this->stream_window_start;
+		if (position < first_position or (this->is_writer and position > this->file_size + this->next_free))
+			throw std::runtime_error("Kero_file: cannot jump out of the current section of a forward-only stream");
+		this->current_position = position;
+		return;
+	}
+
 	if (this->file_size + this->next_free < position) {
 		cerr << "Jump out of the file." << endl;
 		exit(1);
@@ -529,20 +861,37 @@ void Kero_file::jump_to(unsigned long position, bool from_end) {
 	}
 	// cout << "position " << position << endl;
 
-	// Jump into the written file
+	// Jump into the written file (the direct I/O windows follow the reads)
 	if (position < this->file_size) {
-		this->fs.seekp(position);
+		if (this->direct_reader == nullptr and not this->in_memory)
+			this->fs.seekp(position);
 	}
 	// Jump into the buffer
-	else /*if (this->current_position < this->file_size)*/ {
+	else if (not this->in_memory) {
 		this->fs.seekg(0, this->fs.end);
 	}
+	KERO_STATS_ADD(this->stats, seek_calls, 1);
 	this->current_position = position;
 }
 
 
+bool Kero_file::use_direct_io(uint64_t window_bytes) {
+	if (not this->is_reader or this->streaming or this->in_memory)
+		throw std::runtime_error("Kero_file: direct I/O is only available in reading mode on regular files");
+
+	delete this->direct_reader;
+	this->direct_reader = nullptr;
+	this->direct_reader = new Direct_reader(this->filename, this->file_size, window_bytes);
+	// The stream is not read anymore
+	if (this->fs.is_open())
+		this->fs.close();
+	return this->direct_reader->is_direct();
+}
+
+
 void Kero_file::tmp_close() {
-	if (this->is_writer and this->fs.is_open()) {
+	// A stream cannot be reopened
+	if (this->is_writer and this->fs.is_open() and not this->streaming) {
 		this->fs.close();
 		this->fs.clear();
 		this->tmp_closed = true;
@@ -581,6 +930,9 @@ void Kero_file::write_footer() {
 	for (auto & it : this->section_positions) {
 		si.register_section(it.second, it.first - position);
 	}
+	// Chain the index of the sections before an append
+	if (this->previous_index != 0)
+		si.set_next_index((int64_t)this->previous_index - position);
 	si.close();
 
 	// Write a value section to register everything
@@ -687,7 +1039,33 @@ char Kero_file::read_section_type() {
 		this->complete_header();
 	}
 
+	if (this->streaming and this->is_reader) {
+		// A new section starts: the previous ones cannot be read again
+		unsigned long consumed = min(this->current_position - this->stream_window_start, (unsigned long)this->stream_window.size());
+		this->stream_window.erase(this->stream_window.begin(), this->stream_window.begin() + consumed);
+		this->stream_window_start += consumed;
+
+		this->stream_fill(this->current_position + 1);
+		char type = (char)this->stream_window[this->current_position - this->stream_window_start];
+		// End signature
+		if (type == 'K') {
+			this->stream_fill(this->current_position + 3);
+			const uint8_t * signature = this->stream_window.data() + (this->current_position - this->stream_window_start);
+			if (signature[1] != 'E' or signature[2] != 'R')
+				throw std::runtime_error("Kero_file: absent KERO signature at the end of the stream");
+			this->end_position = this->current_position;
+		}
+		return type;
+	}
+
 	if (this->current_position < this->file_size) {
+		if (this->memory_bytes != nullptr)
+			return (char)this->memory_bytes[this->current_position];
+		if (this->direct_reader != nullptr) {
+			uint8_t type;
+			this->direct_reader->read(&type, 1, this->current_position);
+			return (char)type;
+		}
 		return this->fs.peek();
 	}
 	else {
@@ -696,6 +1074,8 @@ char Kero_file::read_section_type() {
 }
 
 void Kero_file::register_minimizer_section(uint64_t minimizer) {
+    if (this->previous_minimizers.count(minimizer) > 0)
+        throw std::runtime_error("Kero_file: the minimizer " + std::to_string(minimizer) + " already has a section");
     if (this->is_writer and this->indexed) {
         this->mini_list.push_back(minimizer);
         this->mini_pos.push_back(this->tellp());
@@ -703,6 +1083,8 @@ void Kero_file::register_minimizer_section(uint64_t minimizer) {
 }
 
 void Kero_file::register_minimizer_section(uint64_t minimizer, uint64_t position) {
+    if (this->previous_minimizers.count(minimizer) > 0)
+        throw std::runtime_error("Kero_file: the minimizer " + std::to_string(minimizer) + " already has a section");
     if (this->is_writer and this->indexed) {
         this->mini_list.push_back(minimizer);
         this->mini_pos.push_back(position);
@@ -710,12 +1092,124 @@ void Kero_file::register_minimizer_section(uint64_t minimizer, uint64_t position
 }
 
 
+bool Kero_file::hashtable_discovery() {
+	if (this->hashtable != nullptr)
+		return true;
+	if (not this->is_reader)
+		return false;
+
+	// The last registered hashtable covers all the minimizer sections
+	long position = -1;
+	for (auto & it : this->section_positions) {
+		if (it.second == 'h')
+			position = it.first;
+	}
+	if (position < 0)
+		return false;
+
+	long current_pos = this->tellp();
+	bool header_over = this->header_over;
+	this->header_over = true;
+
+	this->jump_to(position);
+	this->hashtable = new Section_Hashtable(this);
+	this->hashtable->close();
+
+	this->header_over = header_over;
+	this->jump_to(current_pos);
+
+	// Minimizer sections need k, m, max and data_size
+	this->global_vars_discovery();
+
+	return true;
+}
+
+bool Kero_file::find_minimizer_section(uint64_t minimizer, uint64_t & position) {
+	if (not this->hashtable_discovery())
+		return false;
+	if (this->global_vars.find("m") == this->global_vars.end())
+		throw std::runtime_error("Impossible to find a minimizer section due to missing m variable");
+
+	KERO_LATENCY_SPAN(probe_span, LOOKUP_HASHTABLE_PROBE);
+	uint64_t m = this->global_vars["m"];
+	minimizer = mask_mini(minimizer, m);
+	KERO_STATS_START(mphf_start);
+	uint64_t candidate = this->hashtable->mpht.find(minimizer);
+	KERO_STATS_ELAPSED(this->stats, mphf_ns, mphf_start);
+	KERO_STATS_ADD(this->stats, mphf_lookups, 1);
+	if (candidate >= this->end_position)
+		return false;
+
+	// The mphf gives a position for any key: verify the minimizer of the section
+	long current_pos = this->tellp();
+	uint8_t buff[8];
+	uint64_t nb_bytes_mini = bytes_from_bit_array(2, m);
+	this->jump_to(candidate);
+	this->read(buff, 1);
+	bool found = false;
+	if (buff[0] == 'M') {
+		this->read(buff, nb_bytes_mini);
+		found = mask_mini(buff, m) == minimizer;
+	}
+	this->jump_to(current_pos);
+
+	if (found)
+		position = candidate;
+	return found;
+}
+
+bool Kero_file::find_kmer(uint64_t minimizer, uint64_t kmer, uint8_t * data) {
+	KERO_LATENCY_SPAN(lookup_span, LOOKUP_TOTAL);
+	uint64_t position;
+	if (not this->find_minimizer_section(minimizer, position))
+		return false;
+
+	long current_pos = this->tellp();
+	bool header_over = this->header_over;
+	this->header_over = true;
+
+	this->jump_to(position);
+	KERO_LATENCY_SPAN(header_span, LOOKUP_SECTION_HEADER);
+	Section_Minimizer sm(this);
+	KERO_LATENCY_SPAN_END(header_span);
+	bool found = sm.find_kmer(kmer, data);
+
+	this->header_over = header_over;
+	this->jump_to(current_pos);
+
+	return found;
+}
+
+bool Kero_file::minimizer_sections(std::vector<uint64_t> & minimizers, std::vector<uint64_t> & positions) {
+	if (not this->hashtable_discovery())
+		return false;
+
+	long current_pos = this->tellp();
+	uint64_t m = this->global_vars["m"];
+	uint64_t nb_bytes_mini = bytes_from_bit_array(2, m);
+	uint8_t buff[9];
+	for (uint64_t position : this->hashtable->mpht.hashtable) {
+		this->jump_to(position);
+		this->read(buff, 1 + nb_bytes_mini);
+		if (buff[0] != 'M')
+			throw std::runtime_error("Kero_file: the hashtable of " + this->filename + " does not point to a minimizer section");
+		minimizers.push_back(mask_mini(buff + 1, m));
+		positions.push_back(position);
+	}
+	this->jump_to(current_pos);
+
+	return true;
+}
+
+
 Section::Section(Kero_file * file) {
 	this->file = file;
 
 	if (not file->header_over and file->footer_discovery_ended) {
 		file->complete_header();
 	}
+	// The bytes before the section are final
+	file->flush_stream();
 
 	this->beginning = file->tellp();
 }
@@ -825,6 +1319,11 @@ void Section_GV::copy(Kero_file * file) {
 
 void Section_GV::close() {
 	if (file->is_writer) {
+		// The minimizer sections are decoded with the layout they are written with: it is recorded
+		// with m, unless the writer declared it
+		if (this->vars.find("m") != this->vars.end() and this->vars.find("layout") == this->vars.end())
+			this->write_var("layout", this->file->layout);
+
 		uint8_t buff[8];
 		// write the number of block values
 		store_big_endian(buff, 8, this->nb_vars);
@@ -926,6 +1425,25 @@ Block_section_reader * Block_section_reader::construct_section(Kero_file * file)
 		return nullptr;
 }
 
+/* Generic extraction: the blocks are read with their full sequence, then split into k-mers. */
+uint64_t Block_section_reader::extract_kmers(vector<uint64_t> & kmers, vector<uint8_t> * data) {
+	vector<uint8_t> seq(bytes_from_bit_array(2, this->k + this->max - 1));
+	vector<uint8_t> block_data(this->max * this->data_size + 1);
+	uint64_t nb_extracted = 0;
+
+	while (this->remaining_blocks > 0) {
+		uint64_t nb_kmers = this->read_compacted_sequence(seq.data(), block_data.data());
+		uint64_t offset = kmers.size();
+		kmers.resize(offset + nb_kmers);
+		sequence_to_kmers(seq.data(), nb_kmers + this->k - 1, this->k, kmers.data() + offset);
+		if (data != nullptr)
+			data->insert(data->end(), block_data.data(), block_data.data() + nb_kmers * this->data_size);
+		nb_extracted += nb_kmers;
+	}
+
+	return nb_extracted;
+}
+
 
 // ----- Raw sequence section -----
 
@@ -1037,6 +1555,11 @@ uint64_t Section_Raw::read_compacted_sequence(uint8_t* seq_data) {
 
 
 void Section_Raw::copy(Kero_file * file) {
+	if (this->remaining_blocks == this->nb_blocks and same_vars(this->file, file, {"k", "max", "data_size"})) {
+		this->copy_bytes(file);
+		return;
+	}
+
 	uint max_nucl = this->k + this->max - 1;
 	uint8_t * seq_buffer = new uint8_t[(max_nucl + 3) / 4];
 	uint8_t * data_buffer = new uint8_t[this->max * this->data_size];
@@ -1057,6 +1580,43 @@ void Section_Raw::copy(Kero_file * file) {
 }
 
 
+void Section_Raw::copy_bytes(Kero_file * file) {
+	if (this->remaining_blocks != this->nb_blocks)
+		throw std::runtime_error("Section_Raw: a partially read section cannot be copied byte for byte");
+	if (not same_vars(this->file, file, {"k", "max", "data_size"}))
+		throw std::runtime_error("Section_Raw: the k, max and data_size variables of the files differ");
+
+	uint64_t end = this->section_end();
+	Section destination(file);
+	file->register_position('r');
+	copy_file_bytes(this->file, this->beginning, end, file);
+	this->remaining_blocks = 0;
+}
+
+
+/* The blocks are [nb kmers][seq][data], with the header [r][nb blocks: 8B] before them. */
+uint64_t Section_Raw::section_end(uint64_t * nb_kmers) {
+	uint64_t current_pos = this->file->tellp();
+	uint8_t buff[8];
+	uint64_t position = this->beginning + 9;
+	uint64_t total_kmers = 0;
+	for (uint64_t i=0 ; i<this->nb_blocks ; i++) {
+		uint64_t nb_kmers_in_block = 1;
+		if (nb_kmers_bytes != 0) {
+			this->file->jump_to(position);
+			this->file->read(buff, this->nb_kmers_bytes);
+			load_big_endian(buff, this->nb_kmers_bytes, nb_kmers_in_block);
+		}
+		position += this->nb_kmers_bytes + (nb_kmers_in_block + k - 1 + 3) / 4 + data_size * nb_kmers_in_block;
+		total_kmers += nb_kmers_in_block;
+	}
+	this->file->jump_to(current_pos);
+	if (nb_kmers != nullptr)
+		*nb_kmers = total_kmers;
+	return position;
+}
+
+
 void Section_Raw::jump_sequence() {
 	uint8_t buff[8];
 	uint64_t nb_kmers_in_block = 1;
@@ -1093,48 +1653,6 @@ void Section_Raw::close() {
 }
 
 
-/* Bitshift to the left all the bits in the array with a maximum of 7 bits.
- * Overflow on the left will be set into the previous cell.
- */
-static void leftshift8(uint8_t * bitarray, size_t length, size_t bitshift) {
-	assert(bitshift < 8);
-
-	if (length > 0) {
-		for (uint64_t i=0 ; i<length-1 ; i++) {
-			bitarray[i] = (bitarray[i] << bitshift) | (bitarray[i+1] >> (8-bitshift));
-		}
-		bitarray[length-1] <<= bitshift;
-	}
-}
-
-/* Similar to the previous function but on the right */
-static void rightshift8(uint8_t * bitarray, size_t length, size_t bitshift) {
-	assert(bitshift < 8);
-
-	if (length > 0) {
-		for (uint64_t i=length-1 ; i>0 ; i--) {
-			bitarray[i] = (bitarray[i-1] << (8-bitshift)) | (bitarray[i] >> bitshift);
-		}
-		bitarray[0] >>= bitshift;
-	}
-}
-
-/* Fusion to bytes into one.
- * The merge_index higher bits are from left_bits the others from right_bits
- */
-static uint8_t fusion8(uint8_t left_bits, uint8_t right_bits, size_t merge_index) {
-	uint8_t mask = 0xFF << (8-merge_index);
-	return (left_bits & mask) | (right_bits & ~mask);
-}
-
-/* Computes the number of bytes needed to store a bit array of size bits.
- * The result is rounded up to the next byte.
- */
-static size_t p4nenc_bound(size_t n, size_t size) {
-	// return ((n + 127) / 128 + (n + 32) * sizeof(uint64_t));
-	return (n + 127) / 128 + (n + 32) * size;
-}
-
 // ----- Vertical Minimizer Section -----
 
 /* Vertical Minimizer Section is a section that contains the minimizers of a sequence.
@@ -1160,7 +1678,12 @@ void Section_Minimizer::read_section_header() {
 	load_big_endian(buff, 8, this->nb_blocks);
 	this->remaining_blocks = this->nb_blocks;
 
-#ifndef KERO_MODE_ROW
+	if (this->layout == KERO_LAYOUT_ROW) {
+		// ROW mode: data starts right after header
+		this->n_col_offset = this->file->tellp();
+		return;
+	}
+
 	// 4. Read offsets of columns
 	this->file->read(buff, 8);
 	load_big_endian(buff, 8, this->n_col_offset);
@@ -1177,10 +1700,6 @@ void Section_Minimizer::read_section_header() {
 	this->file->read(buff, 8);
 	load_big_endian(buff, 8, this->seq_col_offset);
 	this->seq_col_offset += this->start_pos;
-#else
-	// ROW mode: data starts right after header
-	this->n_col_offset = this->file->tellp();
-#endif
 }
 
 
@@ -1224,106 +1743,21 @@ void Section_Minimizer::write_section_header() {
 
 
 /* Write the columns of the vertical minimizer section.
- * This function supports three storage modes for ablation study:
- * - KERO_MODE_ROW: Row-oriented storage (no compression)
- * - KERO_MODE_COLUMNAR_NOCOMP: Columnar storage (no integer array compression)
- * - KERO_MODE_COLUMNAR_COMP: Columnar storage + integer array compression (default)
+ * The columns are written by the layout policy of the section (see layout.hpp):
+ * - KERO_LAYOUT_ROW: Row-oriented storage, already written in write_compacted_sequence_without_mini()
+ * - KERO_LAYOUT_COLUMNAR_NOCOMP: Columnar storage (no integer array compression)
+ * - KERO_LAYOUT_COLUMNAR_COMP: Columnar storage + integer array compression (default)
  */
 void Section_Minimizer::write_columns() {
-	uint8_t buff[8];
-
-#ifdef KERO_MODE_ROW
-	// ===== MODE 1: ROW-ORIENTED STORAGE =====
-	// In ROW mode, data has already been written in write_compacted_sequence_without_mini()
-	// Nothing to do here
-
-#elif defined(KERO_MODE_COLUMNAR_NOCOMP)
-	// ===== MODE 2: COLUMNAR STORAGE (No Integer Array Compression) =====
-
-	// 1. Write n value column (uncompressed)
-	this->n_col_offset = this->file->tellp();
-	store_big_endian(buff, 8, n_value_buffer.size() * 8);  // Total bytes
-	this->file->write(buff, 8);
-	for (uint64_t val : n_value_buffer) {
-		store_big_endian(buff, 8, val);
-		this->file->write(buff, 8);
-	}
-
-	// 2. Write m_idx column (uncompressed)
-	this->m_idx_col_offset = this->file->tellp();
-	store_big_endian(buff, 8, m_idx_buffer.size() * 8);  // Total bytes
-	this->file->write(buff, 8);
-	for (uint64_t val : m_idx_buffer) {
-		store_big_endian(buff, 8, val);
-		this->file->write(buff, 8);
-	}
-
-	// 3. Write data column (uncompressed)
-	this->data_col_offset = this->file->tellp();
-	store_big_endian(buff, 8, data_buffer.size());
-	this->file->write(buff, 8);
-	if (!data_buffer.empty()) {
-		this->file->write(data_buffer.data(), data_buffer.size());
-	}
-
-	// 4. Write seq column
-	this->seq_col_offset = this->file->tellp();
-	this->file->write(this->seq_buffer.data(), this->seq_buffer.size());
-
-#else  // KERO_MODE_COLUMNAR_COMP (default)
-	// ===== MODE 3: COLUMNAR STORAGE + INTEGER ARRAY COMPRESSION (Current/Default) =====
-
-	// Pre-allocate buffers for compression
-	size_t compressed_buf_size = std::max(p4nenc_bound(n_value_buffer.size(), sizeof(uint64_t)),
-		std::max(p4nenc_bound(m_idx_buffer.size(), sizeof(uint64_t)), p4nenc_bound(data_buffer.size(), sizeof(uint8_t))));
-	auto* compressed_buf = new uint8_t[compressed_buf_size];
-
-	// 1. Write n value column (compressed)
-	this->n_col_offset = this->file->tellp();
-	{
-		// Compress n_value_buffer
-		uint64_t compressed_n_size = p4nenc64(n_value_buffer.data(), n_value_buffer.size(), compressed_buf);
-		// Write the size of the compressed data
-		store_big_endian(buff, 8, compressed_n_size);
-		this->file->write(buff, 8);
-		// Write the compressed data
-		this->file->write(compressed_buf, compressed_n_size);
-	}
-
-	// 2. Write m_idx column (compressed)
-	{
-		this->m_idx_col_offset = this->file->tellp();
-		// Compress m_idx_buffer
-		uint64_t compressed_m_idx_size = p4nenc64(m_idx_buffer.data(), m_idx_buffer.size(), compressed_buf);
-		// Write the size of the compressed data
-		store_big_endian(buff, 8, compressed_m_idx_size);
-		this->file->write(buff, 8);
-		// Write the compressed data
-		this->file->write(compressed_buf, compressed_m_idx_size);
-	}
-
-	// 3. Write data column (compressed)
-	{
-		this->data_col_offset = this->file->tellp();
-		// Write the size of the data
-		store_big_endian(buff, 8, this->data_buffer.size());
-		this->file->write(buff, 8);
-		// Compress data_buffer
-		std::vector<unsigned char> compressed_data_buf(p4nenc_bound(data_buffer.size(), sizeof(uint8_t)));
-		uint64_t compressed_data_size = p4nenc8(data_buffer.data(), data_buffer.size(), compressed_data_buf.data());
-		// Write the size of the compressed data
-		store_big_endian(buff, 8, compressed_data_size);
-		this->file->write(buff, 8);
-		// Write the compressed data
-		this->file->write(compressed_data_buf.data(), compressed_data_size);
+	switch (this->layout) {
+		case KERO_LAYOUT_ROW:
+			break;
+		case KERO_LAYOUT_COLUMNAR_NOCOMP:
+			Columnar_nocomp_layout::write_columns(*this);
+			break;
+		default:
+			Columnar_comp_layout::write_columns(*this);
 	}
-
-	// 4. Write seq column
-	this->seq_col_offset = this->file->tellp();
-	this->file->write(this->seq_buffer.data(), this->seq_buffer.size());
-
-	delete[] compressed_buf;
-#endif
 }
 
 
@@ -1332,8 +1766,10 @@ void Section_Minimizer::write_columns() {
  * It is called at the end of the section writing process.
  */
 void Section_Minimizer::backfill_column_offsets() {
-#ifndef KERO_MODE_ROW
-	// Only backfill in columnar modes
+	// ROW mode: no backfill needed
+	if (this->layout == KERO_LAYOUT_ROW)
+		return;
+
 	// Save the original position
 	uint64_t original_pos = this->file->tellp();
 
@@ -1355,8 +1791,6 @@ void Section_Minimizer::backfill_column_offsets() {
 
 	// Return to the original position
 	this->file->jump_to(original_pos);
-#endif
-	// ROW mode: no backfill needed
 }
 
 
@@ -1413,6 +1847,10 @@ Section_Minimizer::Section_Minimizer(Kero_file* file) : Section(file) {
 	uint64_t mini_pos_bits = static_cast<uint8_t>(ceil(log2(k+max-1)));
 	this->mini_pos_bytes = bytes_from_bit_array(mini_pos_bits, 1);
 
+	// The layout declared in the file takes precedence over the default one
+	auto layout_var = file->global_vars.find("layout");
+	this->layout = layout_var != file->global_vars.end() ? static_cast<uint8_t>(layout_var->second) : file->layout;
+
 	if (file->is_reader) {
 		this->read_section_header();
 	}
@@ -1438,6 +1876,8 @@ Section_Minimizer& Section_Minimizer::operator= (Section_Minimizer && smv) {
 	this->nb_kmers_bytes = nb_kmers_bytes;
 
 	nb_bytes_mini = smv.nb_bytes_mini;
+	layout = smv.layout;
+	stats = smv.stats;
 
 	n_col_offset = smv.n_col_offset;
 	m_idx_col_offset = smv.m_idx_col_offset;
@@ -1445,6 +1885,7 @@ Section_Minimizer& Section_Minimizer::operator= (Section_Minimizer && smv) {
 	data_col_offset = smv.data_col_offset;
 
 	std::swap(minimizer, smv.minimizer);
+	std::swap(spill, smv.spill);
 
 	return *this;
 }
@@ -1469,26 +1910,10 @@ void Section_Minimizer::write_minimizer(uint8_t* minimizer) {
 	// Copy minimizer to internal variable
 	memcpy(this->minimizer, minimizer, this->nb_bytes_mini);
 
-#ifdef KERO_MODE_ROW
-	// ROW mode: Write header immediately (with nb_blocks=0 as placeholder)
-	// This ensures the file structure is [header][data] instead of [data][header]
-
-	uint64_t write_start_pos = this->file->tellp();
-
-	// 1. Write Section type
-	char type = 'M';
-	this->file->write(reinterpret_cast<uint8_t *>(&type), 1);
-
-	// 2. Write minimizer
-	this->file->write(this->minimizer, this->nb_bytes_mini);
-
-	// 3. Write nb_blocks placeholder (will be backfilled in close())
-	uint8_t buff[8];
-	store_big_endian(buff, 8, 0);  // Placeholder: 0 blocks
-	this->n_col_offset = this->file->tellp();  // Save position for backfilling
-	this->file->write(buff, 8);
-#endif
+	// ROW mode: Write header immediately.
 	// In columnar modes, writing will be done in the close() function.
+	if (this->layout == KERO_LAYOUT_ROW)
+		Row_layout::write_minimizer(*this);
 }
 
 
@@ -1499,38 +1924,17 @@ void Section_Minimizer::write_minimizer(uint8_t* minimizer) {
  */
 void Section_Minimizer::write_compacted_sequence_without_mini(
 	uint8_t* seq, uint64_t seq_size, uint64_t mini_pos, uint8_t* data_array) {
-	// 1. Calculate the number of k-mers in the current super k-mer
-	uint64_t nb_kmers = seq_size + this->m - this->k + 1;
-
-#ifdef KERO_MODE_ROW
-	// ===== ROW MODE: Direct write without buffering =====
-	// Format: [n:8B][m_idx:8B][seq:nB][data:nB]
-	uint8_t buff[8];
-
-	// 1. Write n (number of k-mers)
-	store_big_endian(buff, 8, nb_kmers);
-	this->file->write(buff, 8);
-
-	// 2. Write m_idx (minimizer position)
-	store_big_endian(buff, 8, mini_pos);
-	this->file->write(buff, 8);
-
-	// 3. Write sequence (without minimizer)
-	size_t seq_bytes = bytes_from_bit_array(2, seq_size);
-	this->file->write(seq, seq_bytes);
-
-	// 4. Write data (if any)
-	size_t data_bytes = this->data_size * nb_kmers;
-	if (data_bytes > 0) {
-		this->file->write(data_array, data_bytes);
+	// ROW MODE: Direct write without buffering
+	if (this->layout == KERO_LAYOUT_ROW) {
+		Row_layout::write_compacted_sequence_without_mini(*this, seq, seq_size, mini_pos, data_array);
+		return;
 	}
 
-	// Update the number of super k-mers
-	this->nb_blocks++;
-
-#else
 	// ===== COLUMNAR MODE: Buffer for later column-wise write =====
 
+	// 1. Calculate the number of k-mers in the current super k-mer
+	uint64_t nb_kmers = seq_size + this->m - this->k + 1;
+
 	// 2. Write the number of k-mers and the minimizer index into memory buffers column-wise
 	n_value_buffer.push_back(nb_kmers);
 	m_idx_buffer.push_back(mini_pos);
@@ -1545,7 +1949,12 @@ void Section_Minimizer::write_compacted_sequence_without_mini(
 
 	// 5. Update the number of super k-mers
 	this->nb_blocks++;
-#endif
+
+	// 6. Keep the buffers within the memory budget of the file
+	if (this->layout == KERO_LAYOUT_COLUMNAR_NOCOMP)
+		Columnar_nocomp_layout::spill_buffers(*this);
+	else
+		Columnar_comp_layout::spill_buffers(*this);
 }
 
 
@@ -1599,6 +2008,7 @@ void Section_Minimizer::write_compacted_sequence(
  * It shifts the suffix to align with the minimizer and merges them into the sequence.
  */
 void Section_Minimizer::add_minimizer(uint64_t nb_kmer, uint8_t* seq, uint64_t mini_pos) {
+	KERO_STATS_START(reinsertion_start);
 	uint64_t seq_size = nb_kmer + k - 1;
 	uint64_t seq_bytes = bytes_from_bit_array(2, seq_size);
 	uint64_t seq_left_offset = (4 - (seq_size % 4)) % 4;
@@ -1675,6 +2085,11 @@ void Section_Minimizer::add_minimizer(uint64_t nb_kmer, uint8_t* seq, uint64_t m
 
 	delete[] suffix;
 	delete[] mini;
+
+	KERO_STATS_ELAPSED(this->stats, minimizer_reinsertion_ns, reinsertion_start);
+	KERO_STATS_ADD(this->stats, minimizer_reinsertions, 1);
+	KERO_STATS_ELAPSED(this->file->stats, minimizer_reinsertion_ns, reinsertion_start);
+	KERO_STATS_ADD(this->file->stats, minimizer_reinsertions, 1);
 }
 
 
@@ -1747,189 +2162,18 @@ uint64_t Section_Minimizer::read_compacted_sequence_without_mini(
 	uint8_t *seq, uint8_t *data, uint64_t &mini_pos) {
 	if (this->cur_skmer_idx >= this->nb_blocks) return 0;
 
-	uint8_t buff[8];
-	uint64_t n = 0;
-
-#ifdef KERO_MODE_ROW
-	// ===== ROW MODE: Read directly from file =====
-	// Format: [n:8B][m_idx:8B][seq:nB][data:nB]
-
-	// 1. Read n (number of k-mers)
-	this->file->read(buff, 8);
-	load_big_endian(buff, 8, n);
-
-	// 2. Read m_idx (minimizer position)
-	this->file->read(buff, 8);
-	load_big_endian(buff, 8, mini_pos);
-
-	// 3. Read seq
-	uint64_t seq_size = n + this->k - this->m - 1;
-	size_t seq_bytes = bytes_from_bit_array(2, seq_size);
-	this->file->read(seq, seq_bytes);
-
-	// 4. Read data
-	if (data != nullptr && this->data_size > 0) {
-		size_t data_bytes = this->data_size * n;
-		this->file->read(data, data_bytes);
-	}
-
-#elif defined(KERO_MODE_COLUMNAR_NOCOMP)
-	// ===== COLUMNAR NOCOMP MODE: Read from uncompressed columns =====
-
-	// Initialize on first read
-	if (this->cur_skmer_idx == 0) {
-		this->last_n_pos = 0;
-		this->last_m_idx_pos = 0;
-		this->last_data_pos = 0;
-		this->last_seq_pos = seq_col_offset;
-
-		// Read n_value column (uncompressed)
-		this->file->jump_to(this->n_col_offset);
-		// First read the column size
-		this->file->read(buff, 8);
-		uint64_t n_col_size;
-		load_big_endian(buff, 8, n_col_size);  // Total bytes (should be nb_blocks * 8)
-		// Then read the values
-		this->n_value_buffer.resize(this->nb_blocks);
-		for (size_t i = 0; i < this->nb_blocks; i++) {
-			this->file->read(buff, 8);
-			load_big_endian(buff, 8, this->n_value_buffer[i]);
-		}
-
-		// Read m_idx column (uncompressed)
-		this->file->jump_to(this->m_idx_col_offset);
-		// First read the column size
-		this->file->read(buff, 8);
-		uint64_t m_idx_col_size;
-		load_big_endian(buff, 8, m_idx_col_size);  // Total bytes (should be nb_blocks * 8)
-		// Then read the values
-		this->m_idx_buffer.resize(this->nb_blocks);
-		for (size_t i = 0; i < this->nb_blocks; i++) {
-			this->file->read(buff, 8);
-			load_big_endian(buff, 8, this->m_idx_buffer[i]);
-		}
-
-		// Read data column (uncompressed)
-		if (this->data_size > 0) {
-			this->file->jump_to(this->data_col_offset);
-			// Read the size of the data buffer
-			this->file->read(buff, 8);
-			uint64_t nb_data_buf;
-			load_big_endian(buff, 8, nb_data_buf);
-			this->data_buffer.resize(nb_data_buf);
-			this->file->read(this->data_buffer.data(), nb_data_buf);
-		}
-	}
-
-	// Read from buffers
-	n = this->n_value_buffer[this->last_n_pos++];
-	mini_pos = this->m_idx_buffer[this->last_m_idx_pos++];
-
-	if (data != nullptr && this->data_size > 0) {
-		uint64_t nb_data_bytes = this->data_size * n;
-		for (int i = 0; i < nb_data_bytes; i++) {
-			data[i] = this->data_buffer[this->last_data_pos++];
-		}
-	}
-
-	uint64_t nb_seq_bytes = bytes_from_bit_array(2, n + this->k - this->m - 1);
-	this->file->jump_to(this->last_seq_pos);
-	this->file->read(seq, nb_seq_bytes);
-	this->last_seq_pos += nb_seq_bytes;
-
-#else
-	// ===== COLUMNAR COMP MODE: Read from compressed columns (default) =====
-
-	// Initialize the related positions
-	if (this->cur_skmer_idx == 0) {
-		this->last_n_pos = 0;
-		this->last_m_idx_pos = 0;
-		if (this->data_size > 0) {
-			// this->last_data_pos = data_col_offset;
-			this->last_data_pos = 0;
-		}
-
-		// last_seq_pos is special because seq is read from the file, not from the buffer in memory
-		this->last_seq_pos = seq_col_offset;
-
-		// Uncompress the n_value column
-		this->file->jump_to(this->n_col_offset);
-		this->file->read(buff, 8);
-		uint64_t compressed_n_size;
-		load_big_endian(buff, 8, compressed_n_size);
-		{
-			std::vector<uint8_t> compressed_n_buf(compressed_n_size);
-			this->file->read(compressed_n_buf.data(), compressed_n_size);
-			// Align the buffer to 8 bytes for p4ndec64
-			while (compressed_n_buf.size() < 8) {
-				compressed_n_buf.push_back(0);
-			}
-			this->n_value_buffer.resize(this->nb_blocks);
-			p4ndec64(compressed_n_buf.data(), this->nb_blocks, this->n_value_buffer.data());
-		}
-
-		// Uncompress the m_idx column
-		this->file->jump_to(this->m_idx_col_offset);
-		this->file->read(buff, 8);
-		uint64_t compressed_m_idx_size;
-		load_big_endian(buff, 8, compressed_m_idx_size);
-		{
-			std::vector<uint8_t> compressed_m_idx_buf(compressed_m_idx_size);
-			this->file->read(compressed_m_idx_buf.data(), compressed_m_idx_size);
-			// Align the buffer to 8 bytes for p4ndec64
-			while (compressed_m_idx_buf.size() < 8) {
-				compressed_m_idx_buf.push_back(0);
-			}
-			this->m_idx_buffer.resize(this->nb_blocks);
-			p4ndec64(compressed_m_idx_buf.data(), this->nb_blocks, this->m_idx_buffer.data());
-		}
-
-		// Uncompress the data column
-		if (this->data_size > 0) {
-			this->file->jump_to(this->data_col_offset);
-			// Read the size of the data
-			this->file->read(buff, 8);
-			uint64_t nb_data_buf;
-			load_big_endian(buff, 8, nb_data_buf);
-			// Read the size of the compressed data
-			this->file->read(buff, 8);
-			uint64_t compressed_data_size;
-			load_big_endian(buff, 8, compressed_data_size);
-			{
-				std::vector<uint8_t> compressed_data_buf(compressed_data_size);
-				this->file->read(compressed_data_buf.data(), compressed_data_size);
-				// Align the buffer to 8 bytes for p4ndec64
-				while (compressed_data_buf.size() < 8) {
-					compressed_data_buf.push_back(0);
-				}
-				this->data_buffer.resize(nb_data_buf);
-				p4ndec8(compressed_data_buf.data(), nb_data_buf, this->data_buffer.data());
-			}
-		}
-	}
-
-	// Read n
-	n = this->n_value_buffer[this->last_n_pos++];
-
-	// Read m_idx
-	mini_pos = this->m_idx_buffer[this->last_m_idx_pos++];
-
-	// Read data
-	if (data != nullptr && this->data_size > 0) {
-		uint64_t nb_data_bytes = this->data_size * n;
-		for (int i = 0; i < nb_data_bytes; i++) {
-			data[i] = this->data_buffer[this->last_data_pos++];
-		}
+	uint64_t n;
+	switch (this->layout) {
+		case KERO_LAYOUT_ROW:
+			n = Row_layout::read_compacted_sequence_without_mini(*this, seq, data, mini_pos);
+			break;
+		case KERO_LAYOUT_COLUMNAR_NOCOMP:
+			n = Columnar_nocomp_layout::read_compacted_sequence_without_mini(*this, seq, data, mini_pos);
+			break;
+		default:
+			n = Columnar_comp_layout::read_compacted_sequence_without_mini(*this, seq, data, mini_pos);
 	}
 
-	// Read seq
-	uint64_t nb_seq_bytes = bytes_from_bit_array(2, n + this->k - this->m - 1);
-	this->file->jump_to(this->last_seq_pos);
-	this->file->read(seq, nb_seq_bytes);
-	this->last_seq_pos += nb_seq_bytes;
-
-#endif
-
 	this->cur_skmer_idx++;
 	this->remaining_blocks--;
 	return n;
@@ -1941,6 +2185,12 @@ uint64_t Section_Minimizer::read_compacted_sequence_without_mini(
  * It does not write the minimizer directly, but stores it in the new section.
  */
 void Section_Minimizer::copy(Kero_file * file) {
+	if (this->remaining_blocks == this->nb_blocks and this->layout == file_layout(file)
+			and same_vars(this->file, file, {"k", "m", "max", "data_size"})) {
+		this->copy_bytes(file);
+		return;
+	}
+
 	uint max_nucl = this->k + this->max - 1;
 	uint8_t * tmp_seq_buffer = new uint8_t[(max_nucl + 3) / 4];
 	uint8_t * tmp_data_buffer = new uint8_t[this->max * this->data_size];
@@ -1964,6 +2214,127 @@ void Section_Minimizer::copy(Kero_file * file) {
 }
 
 
+/* Copy the header and the columns (or the rows) as they are. The destination only learns the position
+ * of the section for its hashtable.
+ */
+void Section_Minimizer::copy_bytes(Kero_file * file) {
+	if (this->remaining_blocks != this->nb_blocks)
+		throw std::runtime_error("Section_Minimizer: a partially read section cannot be copied byte for byte");
+	if (this->layout != file_layout(file) or not same_vars(this->file, file, {"k", "m", "max", "data_size"}))
+		throw std::runtime_error("Section_Minimizer: the k, m, max, data_size and layout of the files differ");
+
+	uint64_t end = this->section_end();
+	Section destination(file);
+	file->register_minimizer_section(mask_mini(this->minimizer, this->m), destination.beginning);
+	copy_file_bytes(this->file, this->start_pos, end, file);
+
+	this->cur_skmer_idx = this->nb_blocks;
+	this->remaining_blocks = 0;
+}
+
+
+uint64_t Section_Minimizer::section_end() {
+	uint64_t current_pos = this->file->tellp();
+	uint64_t end;
+	switch (this->layout) {
+		case KERO_LAYOUT_ROW:
+			end = Row_layout::section_end(*this);
+			break;
+		case KERO_LAYOUT_COLUMNAR_NOCOMP:
+			end = Columnar_nocomp_layout::section_end(*this);
+			break;
+		default:
+			end = Columnar_comp_layout::section_end(*this);
+	}
+	this->file->jump_to(current_pos);
+	return end;
+}
+
+
+/* Look for a k-mer in the remaining super k-mers of the section.
+ * Each super k-mer is rebuilt with its minimizer and split into integer k-mers.
+ */
+bool Section_Minimizer::find_kmer(uint64_t kmer, uint8_t * data) {
+	KERO_LATENCY_SPAN(scan_span, LOOKUP_SKMER_SCAN);
+	std::vector<uint8_t> seq(bytes_from_bit_array(2, this->k + this->max - 1));
+	std::vector<uint8_t> skmer_data(this->max * this->data_size + 1);
+	std::vector<uint64_t> kmers(this->max);
+	uint64_t minimizer = mask_mini(this->minimizer, this->m);
+
+	while (this->remaining_blocks > 0) {
+		uint64_t mini_pos;
+		uint64_t nb_kmers = this->read_compacted_sequence_without_mini(seq.data(), skmer_data.data(), mini_pos);
+		skmer_to_kmers(seq.data(), nb_kmers, this->k, minimizer, this->m, mini_pos, kmers.data());
+		for (uint64_t i = 0; i < nb_kmers; i++) {
+			if (kmers[i] != kmer)
+				continue;
+			if (data != nullptr)
+				memcpy(data, skmer_data.data() + i * this->data_size, this->data_size);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/* Extract the k-mers of the remaining super k-mers without minimizer reinsertion. */
+uint64_t Section_Minimizer::extract_kmers(vector<uint64_t> & kmers, vector<uint8_t> * data) {
+	vector<uint8_t> seq(bytes_from_bit_array(2, this->k + this->max - 1));
+	vector<uint8_t> skmer_data(this->max * this->data_size + 1);
+	uint64_t minimizer = mask_mini(this->minimizer, this->m);
+	uint64_t nb_extracted = 0;
+
+	while (this->remaining_blocks > 0) {
+		uint64_t mini_pos;
+		uint64_t nb_kmers = this->read_compacted_sequence_without_mini(seq.data(), skmer_data.data(), mini_pos);
+		uint64_t offset = kmers.size();
+		kmers.resize(offset + nb_kmers);
+		skmer_to_kmers(seq.data(), nb_kmers, this->k, minimizer, this->m, mini_pos, kmers.data() + offset);
+		if (data != nullptr)
+			data->insert(data->end(), skmer_data.data(), skmer_data.data() + nb_kmers * this->data_size);
+		nb_extracted += nb_kmers;
+	}
+
+	return nb_extracted;
+}
+
+
+/* Extract the k-mers of the remaining super k-mers with the file positions of their data.
+ * The data are stored as is in the row layout ([n:8B][m_idx:8B][seq][data] per super k-mer) and in the
+ * data column of the uncompressed columnar layout ([size: 8B][bytes]).
+ */
+uint64_t Section_Minimizer::locate_kmer_data(vector<uint64_t> & kmers, vector<uint64_t> & positions) {
+	if (this->layout != KERO_LAYOUT_ROW and this->layout != KERO_LAYOUT_COLUMNAR_NOCOMP)
+		throw std::runtime_error("Section_Minimizer: the data of a compressed section cannot be located.");
+	if (this->layout != KERO_LAYOUT_ROW and this->remaining_blocks != this->nb_blocks)
+		throw std::runtime_error("Section_Minimizer: the data can only be located from the first super k-mer.");
+
+	vector<uint8_t> seq(bytes_from_bit_array(2, this->k + this->max - 1));
+	uint64_t minimizer = mask_mini(this->minimizer, this->m);
+	uint64_t data_position = this->data_col_offset + 8;
+	uint64_t nb_located = 0;
+
+	while (this->remaining_blocks > 0) {
+		uint64_t block_position = this->file->tellp();
+		uint64_t mini_pos;
+		uint64_t nb_kmers = this->read_compacted_sequence_without_mini(seq.data(), nullptr, mini_pos);
+		if (this->layout == KERO_LAYOUT_ROW)
+			data_position = block_position + 16 + bytes_from_bit_array(2, nb_kmers + this->k - this->m - 1);
+
+		uint64_t offset = kmers.size();
+		kmers.resize(offset + nb_kmers);
+		skmer_to_kmers(seq.data(), nb_kmers, this->k, minimizer, this->m, mini_pos, kmers.data() + offset);
+		for (uint64_t i = 0; i < nb_kmers; i++)
+			positions.push_back(data_position + i * this->data_size);
+		data_position += nb_kmers * this->data_size;
+		nb_located += nb_kmers;
+	}
+
+	return nb_located;
+}
+
+
 /* Jump to the next sequence in the minimizer section.
  * This function is used when reading the section in a reader mode.
  * It skips the current sequence and prepares for the next one.
@@ -1993,15 +2364,13 @@ void Section_Minimizer::close() {
 			this->file->register_minimizer_section(mini_val, this->start_pos);
 		}
 
-#ifdef KERO_MODE_ROW
-		uint8_t buff[8];
-		store_big_endian(buff, 8, this->nb_blocks);
-		this->file->write_at(buff, 8, this->n_col_offset);
-#else
-		this->write_section_header();
-		this->write_columns();
-		this->backfill_column_offsets();
-#endif
+		if (this->layout == KERO_LAYOUT_ROW) {
+			Row_layout::close(*this);
+		} else {
+			this->write_section_header();
+			this->write_columns();
+			this->backfill_column_offsets();
+		}
 	}
 
 	if (this->file->is_reader) {
@@ -2015,11 +2384,6 @@ void Section_Minimizer::close() {
 	Section::close();
 }
 
-// Helper function to read data from a mmap pointer instead of a file stream
-static void mmap_read(const uint8_t* mmap_ptr, uint64_t offset, uint8_t* dest, uint64_t size) {
-    memcpy(dest, mmap_ptr + offset, size);
-}
-
 /* Precache columns from a memory-mapped file.
  * This function reads the compressed columns from the mmap pointer and decompresses them into internal buffers.
  * It is used to avoid repeated file I/O when accessing the columns multiple times.
@@ -2027,166 +2391,16 @@ static void mmap_read(const uint8_t* mmap_ptr, uint64_t offset, uint8_t* dest, u
 void Section_Minimizer::precache_columns_from_mmap(const uint8_t* mmap_ptr) {
     if (!n_value_buffer.empty()) return; // Already cached
 
-    uint8_t buff[8];
-
-#ifdef KERO_MODE_ROW
-    // ===== MODE 1: ROW-ORIENTED STORAGE (Read row-by-row) =====
-    // Format: [n:8B][m_idx:8B][seq:nB][data:nB] per row
-    this->n_value_buffer.resize(this->nb_blocks);
-    this->m_idx_buffer.resize(this->nb_blocks);
-
-    size_t current_offset = this->n_col_offset;
-    size_t total_data_size = 0;
-    size_t total_seq_size = 0;
-
-    // First pass: read n and m_idx, calculate total sizes
-    for (size_t i = 0; i < nb_blocks; i++) {
-        // Read n
-        mmap_read(mmap_ptr, current_offset, buff, 8);
-        load_big_endian(buff, 8, n_value_buffer[i]);
-        current_offset += 8;
-
-        // Read m_idx
-        mmap_read(mmap_ptr, current_offset, buff, 8);
-        load_big_endian(buff, 8, m_idx_buffer[i]);
-        current_offset += 8;
-
-        // Calculate seq_size (seq without minimizer)
-        uint64_t seq_size = n_value_buffer[i] + k - m - 1;
-        size_t seq_bytes = bytes_from_bit_array(2, seq_size);
-        total_seq_size += seq_bytes;
-
-        // Calculate data size
-        total_data_size += n_value_buffer[i] * data_size;
-
-        // Skip seq and data for this row
-        current_offset += seq_bytes;
-        current_offset += n_value_buffer[i] * data_size;
-    }
-
-    // Second pass: read seq and data
-    current_offset = this->n_col_offset;
-
-    // Allocate buffers
-    if (total_seq_size > 0) {
-        this->seq_buffer.resize(total_seq_size);
+    switch (this->layout) {
+        case KERO_LAYOUT_ROW:
+            Row_layout::precache_columns_from_mmap(*this, mmap_ptr);
+            break;
+        case KERO_LAYOUT_COLUMNAR_NOCOMP:
+            Columnar_nocomp_layout::precache_columns_from_mmap(*this, mmap_ptr);
+            break;
+        default:
+            Columnar_comp_layout::precache_columns_from_mmap(*this, mmap_ptr);
     }
-    if (total_data_size > 0) {
-        this->data_buffer.resize(total_data_size);
-    }
-
-    size_t seq_offset = 0;
-    size_t data_offset = 0;
-
-    for (size_t i = 0; i < nb_blocks; i++) {
-        // Skip n and m_idx
-        current_offset += 16;
-
-        // Read seq
-        uint64_t seq_size = n_value_buffer[i] + k - m - 1;
-        size_t seq_bytes = bytes_from_bit_array(2, seq_size);
-        if (seq_bytes > 0) {
-            mmap_read(mmap_ptr, current_offset, &seq_buffer[seq_offset], seq_bytes);
-            seq_offset += seq_bytes;
-            current_offset += seq_bytes;
-        }
-
-        // Read data
-        size_t row_data_size = n_value_buffer[i] * data_size;
-        if (row_data_size > 0) {
-            mmap_read(mmap_ptr, current_offset, &data_buffer[data_offset], row_data_size);
-            data_offset += row_data_size;
-            current_offset += row_data_size;
-        }
-    }
-
-#elif defined(KERO_MODE_COLUMNAR_NOCOMP)
-    // ===== MODE 2: COLUMNAR STORAGE (Read uncompressed columns) =====
-
-    // Read n value column (uncompressed)
-    uint64_t n_total_bytes;
-    mmap_read(mmap_ptr, this->n_col_offset, buff, 8);
-    load_big_endian(buff, 8, n_total_bytes);
-
-    this->n_value_buffer.resize(this->nb_blocks);
-    for (size_t i = 0; i < nb_blocks; i++) {
-        mmap_read(mmap_ptr, this->n_col_offset + 8 + i * 8, buff, 8);
-        load_big_endian(buff, 8, n_value_buffer[i]);
-    }
-
-    // Read m_idx column (uncompressed)
-    uint64_t m_idx_total_bytes;
-    mmap_read(mmap_ptr, this->m_idx_col_offset, buff, 8);
-    load_big_endian(buff, 8, m_idx_total_bytes);
-
-    this->m_idx_buffer.resize(this->nb_blocks);
-    for (size_t i = 0; i < nb_blocks; i++) {
-        mmap_read(mmap_ptr, this->m_idx_col_offset + 8 + i * 8, buff, 8);
-        load_big_endian(buff, 8, m_idx_buffer[i]);
-    }
-
-    // Read data column (uncompressed)
-    if (this->data_size > 0) {
-        uint64_t data_total_bytes;
-        mmap_read(mmap_ptr, this->data_col_offset, buff, 8);
-        load_big_endian(buff, 8, data_total_bytes);
-
-        if (data_total_bytes > 0) {
-            this->data_buffer.resize(data_total_bytes);
-            mmap_read(mmap_ptr, this->data_col_offset + 8, data_buffer.data(), data_total_bytes);
-        }
-    }
-
-#else  // KERO_MODE_COLUMNAR_COMP (default, compressed)
-    // ===== MODE 3: COLUMNAR STORAGE + INTEGER ARRAY COMPRESSION (Decompress columns) =====
-
-    // Uncompress the n_value column
-    uint64_t compressed_n_size;
-    mmap_read(mmap_ptr, this->n_col_offset, buff, 8); // Read compressed size
-    load_big_endian(buff, 8, compressed_n_size);
-    {
-        std::vector<uint8_t> compressed_n_buf(compressed_n_size);
-        mmap_read(mmap_ptr, this->n_col_offset + 8, compressed_n_buf.data(), compressed_n_size);
-
-        this->n_value_buffer.resize(this->nb_blocks);
-        if (compressed_n_size > 0) {
-           p4ndec64(compressed_n_buf.data(), this->nb_blocks, this->n_value_buffer.data());
-        }
-    }
-
-    // Uncompress the m_idx column
-    uint64_t compressed_m_idx_size;
-    mmap_read(mmap_ptr, this->m_idx_col_offset, buff, 8); // Read compressed size
-    load_big_endian(buff, 8, compressed_m_idx_size);
-    {
-        std::vector<uint8_t> compressed_m_idx_buf(compressed_m_idx_size);
-        mmap_read(mmap_ptr, this->m_idx_col_offset + 8, compressed_m_idx_buf.data(), compressed_m_idx_size);
-
-        this->m_idx_buffer.resize(this->nb_blocks);
-        if (compressed_m_idx_size > 0) {
-            p4ndec64(compressed_m_idx_buf.data(), this->nb_blocks, this->m_idx_buffer.data());
-        }
-    }
-
-    // Uncompress the data column
-    if (this->data_size > 0) {
-        uint64_t nb_data_buf;
-        mmap_read(mmap_ptr, this->data_col_offset, buff, 8); // Read total data buffer size
-        load_big_endian(buff, 8, nb_data_buf);
-
-        uint64_t compressed_data_size;
-        mmap_read(mmap_ptr, this->data_col_offset + 8, buff, 8); // Read compressed data size
-        load_big_endian(buff, 8, compressed_data_size);
-
-        if (compressed_data_size > 0) {
-            std::vector<uint8_t> compressed_data_buf(compressed_data_size);
-            mmap_read(mmap_ptr, this->data_col_offset + 16, compressed_data_buf.data(), compressed_data_size);
-
-            this->data_buffer.resize(nb_data_buf);
-            p4ndec8(compressed_data_buf.data(), nb_data_buf, this->data_buffer.data());
-        }
-    }
-#endif
 }
 
 // ----- Hash Table Section -----
@@ -2212,10 +2426,13 @@ Section_Hashtable::Section_Hashtable(Kero_file *file) : Section(file) {
         this->file->read(buff, 8);
         load_big_endian(buff, 8, this->nb_mphf);
 
-        // Read the mphf part and generate a temporary file
-        std::ofstream temp_file("mphf.bin", std::ios::binary);
-        if (!temp_file.is_open())
-            throw "Impossible to open the temporary file mphf.bin.";
+        // Read the mphf part and generate a temporary file, unique to this section
+        std::string temp_path = create_temp_file("", "kero_mphf");
+        std::ofstream temp_file(temp_path, std::ios::binary);
+        if (!temp_file.is_open()) {
+            std::remove(temp_path.c_str());
+            throw "Impossible to open the temporary mphf file.";
+        }
     	std::vector<uint8_t> buff_chunk(BUFF_CHUNK_SIZE);
         uint64_t nb_bytes_read = 0;
         while (nb_bytes_read < nb_mphf) {
@@ -2225,8 +2442,8 @@ Section_Hashtable::Section_Hashtable(Kero_file *file) : Section(file) {
             nb_bytes_read += nb_bytes_to_read;
         }
         temp_file.close();
-        mpht.load("mphf.bin");
-        std::remove("mphf.bin");
+        mpht.load(temp_path);
+        std::remove(temp_path.c_str());
 
         // Read the length of the hashtable
         uint64_t nb_hashtable;
@@ -2246,6 +2463,26 @@ Section_Hashtable::Section_Hashtable(Kero_file *file) : Section(file) {
 
 Section_Hashtable::~Section_Hashtable() = default;
 
+/* Jump over the section from its sizes: [h][mphf size:8B][mphf][nb entries:8B][entries:8B each].
+ * Loading it would rebuild the mphf for nothing.
+ */
+void Section_Hashtable::skip(Kero_file * file, uint64_t * nb_mphf, uint64_t * nb_hashtable) {
+    char type;
+    file->read((uint8_t *)&type, 1);
+    if (type != 'h')
+        throw "The section do not start with the 'h' char, you can not skip a Hashtable section.";
+
+    uint64_t mphf_size = read_u64(*file);
+    file->jump(mphf_size);
+    uint64_t nb_entries = read_u64(*file);
+    file->jump(8 * nb_entries);
+
+    if (nb_mphf != nullptr)
+        *nb_mphf = mphf_size;
+    if (nb_hashtable != nullptr)
+        *nb_hashtable = nb_entries;
+}
+
 /* Register a minimizer and its index in the hashtable.
  * This function adds a minimizer and its corresponding index to the internal vectors.
  * It is used when writing the hashtable section to store the minimizers and their positions.
@@ -2273,11 +2510,14 @@ void Section_Hashtable::close() {
         this->file->register_position('h');
         this->file->write((uint8_t *)&type, 1);
 
-		// Save temporary  mphf.bin
-    	this->mpht.save("mpht.bin");
-        std::ifstream temp_file("mpht.bin", std::ios::binary);
-        if (!temp_file.is_open())
-            throw "Impossible to open the temporary file mphf.bin.";
+		// Save the mphf in a temporary file, unique to this section
+        std::string temp_path = create_temp_file("", "kero_mphf");
+    	this->mpht.save(temp_path);
+        std::ifstream temp_file(temp_path, std::ios::binary);
+        if (!temp_file.is_open()) {
+            std::remove(temp_path.c_str());
+            throw "Impossible to open the temporary mphf file.";
+        }
 
     	// Write the length of the mphf
         temp_file.seekg(0, std::ios::end);
@@ -2296,7 +2536,7 @@ void Section_Hashtable::close() {
             nb_bytes_written += nb_bytes_to_write;
         }
         temp_file.close();
-        std::remove("mphf.bin");
+        std::remove(temp_path.c_str());
 
         // Write the length of the hashtable
         store_big_endian(buff, 8, this->mpht.size());
@@ -2315,10 +2555,26 @@ void Section_Hashtable::close() {
 
 // -------- Start of the high level API -----------
 
-Kero_reader::Kero_reader(std::string filename) {
+Kero_reader::Kero_reader(std::string filename, uint64_t prefetch_chunks) {
 	// Open the file
 	this->file = new Kero_file(filename, "r");
+	this->init();
+
+	if (prefetch_chunks > 0 and not this->file->streaming) {
+		this->file->complete_header();
+		this->prefetcher = new kero::Section_prefetcher(filename, prefetch_chunks);
+	}
+
+	this->has_next();
+}
+
+Kero_reader::Kero_reader(const uint8_t * bytes, size_t size) {
+	this->file = new Kero_file(bytes, size);
+	this->init();
+	this->has_next();
+}
 
+void Kero_reader::init() {
 	this->current_seq_data = new uint8_t[1];
 	this->current_seq_data[0] = 0;
 
@@ -2338,7 +2594,8 @@ Kero_reader::Kero_reader(std::string filename) {
 	this->max = 0;
 	this->data_size = 0;
 
-	this->has_next();
+	this->prefetcher = nullptr;
+	this->prefetch_ended = false;
 }
 
 Kero_reader::~Kero_reader() {
@@ -2346,6 +2603,8 @@ Kero_reader::~Kero_reader() {
 	delete[] this->current_seq_data;
 	if (this->current_section != NULL)
 		delete this->current_section;
+	// After the section, that can still pull chunks from the prefetcher
+	delete this->prefetcher;
 
 	for (uint i=1 ; i<4 ; i++)
 		delete[] this->current_shifts[i];
@@ -2367,48 +2626,18 @@ void Kero_reader::read_until_first_section_block() {
 		{
 			// Read the global variable block
 			Section_GV gvs(file);
-			// Update sequence size if k or max change
+			// Update the buffer sizes if k, max or data_size change
 			if (gvs.vars.find("k") != gvs.vars.end()
-				or gvs.vars.find("max") != gvs.vars.end())
-			{
-				// Compute the max size of a sequence
-				this->k = this->file->global_vars["k"];
-				this->max = this->file->global_vars["max"];
-				uint64_t seq_max_size = bytes_from_bit_array(2, max + k - 1);
-				uint64_t data_max_size = data_size * max;
-				// sequence + data buffer
-				delete[] this->current_seq_data;
-				this->current_seq_data = new uint8_t[seq_max_size + data_max_size];
-
-				// Shifts
-				this->current_shifts[0] = this->current_seq_data;
-				for (uint8_t i=1 ; i<4 ; i++)
-				{
-					delete[] this->current_shifts[i];
-					this->current_shifts[i] = new uint8_t[seq_max_size];
-					memset(this->current_shifts[i], 0, seq_max_size);
-				}
-
-				// Current kmer
-				delete[] this->current_kmer;
-				this->current_kmer = new uint8_t[k/4 + 1];
-				memset(this->current_kmer, 0, (k/4+1));
-			}
-
-			// Update the data array size
-			if (gvs.vars.find("data_size") != gvs.vars.end()
-				or gvs.vars.find("max") != gvs.vars.end())
+				or gvs.vars.find("max") != gvs.vars.end()
+				or gvs.vars.find("data_size") != gvs.vars.end())
 			{
-				// Update global variables
-				this->max = this->file->global_vars["max"];
-				this->data_size = this->file->global_vars["data_size"];
-				// Update buffer size
-				uint64_t seq_max_size = bytes_from_bit_array(2, max + k - 1);
-				uint64_t data_max_size = this->data_size * max;
-				delete[] this->current_seq_data;
-				this->current_seq_data = new uint8_t[seq_max_size + data_max_size];
-				this->current_shifts[0] = this->current_seq_data;
-				memset(this->current_seq_data, 0, seq_max_size + data_max_size);
+				if (gvs.vars.find("k") != gvs.vars.end())
+					this->k = gvs.vars["k"];
+				if (gvs.vars.find("max") != gvs.vars.end())
+					this->max = gvs.vars["max"];
+				if (gvs.vars.find("data_size") != gvs.vars.end())
+					this->data_size = gvs.vars["data_size"];
+				this->resize_buffers();
 			}
 		}
 		// Mount data from the files to the datastructures.
@@ -2429,6 +2658,60 @@ void Kero_reader::read_until_first_section_block() {
 }
 
 
+/* Take the next section decoded by the read-ahead thread, with the variables that apply to it. */
+void Kero_reader::read_next_prefetched_section() {
+	while (current_section == NULL or remaining_blocks == 0) {
+		if (current_section != NULL) {
+			delete current_section;
+			current_section = NULL;
+		}
+
+		kero::Prefetched_section * section = this->prefetcher->next_section(this->k, this->max, this->data_size);
+		if (section == nullptr) {
+			this->prefetch_ended = true;
+			return;
+		}
+
+		if (section->new_vars)
+			this->file->global_vars = section->vars;
+		if (section->k != this->k or section->max != this->max or section->data_size != this->data_size) {
+			this->k = section->k;
+			this->max = section->max;
+			this->data_size = section->data_size;
+			this->resize_buffers();
+		}
+		current_section = section;
+		remaining_blocks = section->nb_blocks;
+	}
+}
+
+
+/* Allocate the sequence, shifts and k-mer buffers for the current k, max and data_size. */
+void Kero_reader::resize_buffers() {
+	// Compute the max size of a sequence
+	uint64_t seq_max_size = bytes_from_bit_array(2, max + k - 1);
+	uint64_t data_max_size = data_size * max;
+	// sequence + data buffer
+	delete[] this->current_seq_data;
+	this->current_seq_data = new uint8_t[seq_max_size + data_max_size];
+	memset(this->current_seq_data, 0, seq_max_size + data_max_size);
+
+	// Shifts
+	this->current_shifts[0] = this->current_seq_data;
+	for (uint8_t i=1 ; i<4 ; i++)
+	{
+		delete[] this->current_shifts[i];
+		this->current_shifts[i] = new uint8_t[seq_max_size];
+		memset(this->current_shifts[i], 0, seq_max_size);
+	}
+
+	// Current kmer
+	delete[] this->current_kmer;
+	this->current_kmer = new uint8_t[k/4 + 1];
+	memset(this->current_kmer, 0, (k/4+1));
+}
+
+
 void Kero_reader::read_next_block() {
 	// Read from the file
 	current_seq_kmers = remaining_kmers = current_section->read_compacted_sequence(current_seq_data);
@@ -2436,18 +2719,20 @@ void Kero_reader::read_next_block() {
 	current_seq_bytes = bytes_from_bit_array(2, current_seq_nucleotides);
 
 	// Create the 4 possible shifts of the sequence for easy use.
-	for (uint8_t i=1 ; i<min((uint64_t)4, remaining_kmers) ; i++) {
-		// Copy
-		memcpy(current_shifts[i], current_shifts[0], current_seq_bytes);
-		// Shift
-		rightshift8(current_shifts[i], current_seq_bytes, 2 * i);
-	}
+	prepare_shifts(current_shifts, current_seq_bytes, remaining_kmers);
 }
 
 bool Kero_reader::has_next() {
+	if (this->prefetcher != nullptr) {
+		if (current_section == NULL and not this->prefetch_ended)
+			read_next_prefetched_section();
+		return current_section != NULL;
+	}
+
 	if (current_section == NULL and (file->end_position > file->tellp()))
 		read_until_first_section_block();
-	return file->end_position > file->tellp();
+	// Without footer, the last block of the file can be loaded with the position at the end
+	return current_section != NULL or file->end_position > file->tellp();
 }
 
 uint64_t Kero_reader::next_block(uint8_t* & sequence, uint8_t* & data) {
@@ -2510,6 +2795,38 @@ bool Kero_reader::next_kmer(uint8_t* & kmer, uint8_t* & data) {
 }
 
 
+uint64_t Kero_reader::next_section_kmers(vector<uint64_t> & kmers, vector<uint8_t> * data) {
+	if (!this->has_next() or this->current_section == nullptr)
+		return 0;
+
+	uint64_t nb_extracted = 0;
+
+	// End of a block partially read by next_kmer
+	if (remaining_kmers > 0) {
+		vector<uint64_t> block_kmers(current_seq_kmers);
+		sequence_to_kmers(current_seq_data, current_seq_nucleotides, this->k, block_kmers.data());
+		uint64_t first = current_seq_kmers - remaining_kmers;
+		kmers.insert(kmers.end(), block_kmers.begin() + first, block_kmers.end());
+		if (data != nullptr) {
+			uint8_t * block_data = current_seq_data + current_seq_bytes;
+			data->insert(data->end(), block_data + first * this->data_size,
+			             block_data + current_seq_kmers * this->data_size);
+		}
+		nb_extracted += remaining_kmers;
+		remaining_kmers = 0;
+		remaining_blocks -= 1;
+	}
+
+	nb_extracted += current_section->extract_kmers(kmers, data);
+
+	remaining_blocks = 0;
+	delete current_section;
+	current_section = nullptr;
+
+	return nb_extracted;
+}
+
+
 uint64_t Kero_reader::get_var(string name) {
 	if (file->global_vars.find(name) != file->global_vars.end())
 		return file->global_vars[name];
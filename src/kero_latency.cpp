@@ -0,0 +1,230 @@
+/**
+* @file kero_latency.cpp
+ *
+ * @brief This file implements the latency histograms and the spans of the lookup path.
+ *
+ */
+
+#include "kero-api/detail/latency.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "kero-api/detail/stats.hpp"
+#include "logfault.h"
+
+namespace kero {
+
+    const char* lookup_stage_name(uint8_t stage) {
+        switch (stage) {
+            case LOOKUP_TOTAL:
+                return "lookup";
+            case LOOKUP_HASHTABLE_PROBE:
+                return "hashtable_probe";
+            case LOOKUP_SECTION_HEADER:
+                return "section_header";
+            case LOOKUP_COLUMN_DECODE:
+                return "column_decode";
+            case LOOKUP_SKMER_SCAN:
+                return "skmer_scan";
+            default:
+                return "unknown";
+        }
+    }
+
+
+    // ----- Histogram -----
+
+    Latency_histogram::Latency_histogram() {
+        reset();
+    }
+
+    Latency_histogram::Latency_histogram(const Latency_histogram& other) {
+        reset();
+        merge(other);
+    }
+
+    Latency_histogram& Latency_histogram::operator=(const Latency_histogram& other) {
+        if (this != &other) {
+            reset();
+            merge(other);
+        }
+        return *this;
+    }
+
+    uint64_t Latency_histogram::bucket_index(uint64_t value) {
+        if (value < SUB_BUCKETS)
+            return value;
+        uint64_t exponent = 63 - __builtin_clzll(value);
+        uint64_t sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+    }
+
+    uint64_t Latency_histogram::bucket_value(uint64_t index) {
+        if (index < SUB_BUCKETS)
+            return index;
+        uint64_t exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+        uint64_t sub_bucket = index % SUB_BUCKETS;
+        uint64_t width = 1ull << (exponent - SUB_BUCKET_BITS);
+        return ((SUB_BUCKETS + sub_bucket) << (exponent - SUB_BUCKET_BITS)) + width - 1;
+    }
+
+    void Latency_histogram::merge(const Latency_histogram& other) {
+        for (uint64_t i = 0; i < NB_BUCKETS; i++)
+            counts[i].fetch_add(other.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        total_count.fetch_add(other.total_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        total_ns.fetch_add(other.total_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        uint64_t other_max = other.max_ns.load(std::memory_order_relaxed);
+        if (other_max > max_ns.load(std::memory_order_relaxed))
+            max_ns.store(other_max, std::memory_order_relaxed);
+    }
+
+    void Latency_histogram::reset() {
+        for (auto& count : counts)
+            count.store(0, std::memory_order_relaxed);
+        total_count.store(0, std::memory_order_relaxed);
+        total_ns.store(0, std::memory_order_relaxed);
+        max_ns.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t Latency_histogram::count() const {
+        return total_count.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Latency_histogram::max() const {
+        return max_ns.load(std::memory_order_relaxed);
+    }
+
+    double Latency_histogram::mean() const {
+        uint64_t nb = count();
+        return nb == 0 ? 0.0 : static_cast<double>(total_ns.load(std::memory_order_relaxed)) / nb;
+    }
+
+    uint64_t Latency_histogram::percentile(double p) const {
+        uint64_t nb = 0;
+        uint64_t bucket_counts[NB_BUCKETS];
+        for (uint64_t i = 0; i < NB_BUCKETS; i++) {
+            bucket_counts[i] = counts[i].load(std::memory_order_relaxed);
+            nb += bucket_counts[i];
+        }
+        if (nb == 0)
+            return 0;
+
+        auto rank = static_cast<uint64_t>(p / 100.0 * (nb - 1) + 0.5) + 1;
+        uint64_t seen = 0;
+        for (uint64_t i = 0; i < NB_BUCKETS; i++) {
+            seen += bucket_counts[i];
+            if (seen >= rank)
+                return std::min(bucket_value(i), max());
+        }
+        return max();
+    }
+
+
+    // ----- Per thread profiles -----
+
+    void Lookup_profile::merge(const Lookup_profile& other) {
+        for (uint64_t i = 0; i < NB_LOOKUP_STAGES; i++)
+            stages[i].merge(other.stages[i]);
+    }
+
+    void Lookup_profile::reset() {
+        for (auto& stage : stages)
+            stage.reset();
+    }
+
+    namespace {
+
+        // Profiles of the running threads, and the sum of the profiles of the finished ones
+        struct Profile_registry {
+            std::mutex mutex;
+            std::vector<Lookup_profile*> profiles;
+            Lookup_profile retired;
+        };
+
+        // Built on first use, so that it outlives the profiles of all the threads
+        Profile_registry& registry() {
+            static Profile_registry instance;
+            return instance;
+        }
+
+        // Profile of a thread, allocated on its first lookup and retired at the end of the thread
+        struct Thread_profile {
+            std::unique_ptr<Lookup_profile> profile;
+
+            ~Thread_profile() {
+                if (profile == nullptr)
+                    return;
+                Profile_registry& reg = registry();
+                std::lock_guard<std::mutex> lock(reg.mutex);
+                reg.retired.merge(*profile);
+                reg.profiles.erase(std::find(reg.profiles.begin(), reg.profiles.end(), profile.get()));
+            }
+        };
+
+    } // namespace
+
+    Lookup_profile& thread_lookup_profile() {
+        thread_local Thread_profile thread_profile;
+        if (thread_profile.profile == nullptr) {
+            thread_profile.profile.reset(new Lookup_profile());
+            Profile_registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.profiles.push_back(thread_profile.profile.get());
+        }
+        return *thread_profile.profile;
+    }
+
+    Lookup_profile collect_lookup_profile() {
+        Profile_registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        Lookup_profile total;
+        total.merge(reg.retired);
+        for (Lookup_profile* profile : reg.profiles)
+            total.merge(*profile);
+        return total;
+    }
+
+    void reset_lookup_profiles() {
+        Profile_registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.retired.reset();
+        for (Lookup_profile* profile : reg.profiles)
+            profile->reset();
+    }
+
+
+    // ----- Spans -----
+
+    thread_local Latency_span* Latency_span::current = nullptr;
+
+    Latency_span::Latency_span(uint8_t stage)
+            : parent(current), start_ns(0), nested_ns(0), stage(stage), active(stage == LOOKUP_TOTAL or current != nullptr) {
+        if (active) {
+            current = this;
+            start_ns = stats_now_ns();
+        }
+    }
+
+    Latency_span::~Latency_span() {
+        end();
+    }
+
+    void Latency_span::end() {
+        if (not active)
+            return;
+        active = false;
+
+        uint64_t elapsed = stats_now_ns() - start_ns;
+        uint64_t own = stage == LOOKUP_TOTAL ? elapsed : elapsed - nested_ns;
+        thread_lookup_profile().stages[stage].record(own);
+        if (parent != nullptr)
+            parent->nested_ns += elapsed;
+        current = parent;
+
+        LFLOG_TRACE << "kero span " << lookup_stage_name(stage) << " " << own << "ns";
+    }
+
+} // namespace kero
@@ -0,0 +1,763 @@
+/**
+* @file kero_layout.cpp
+ *
+ * @brief This file implements the storage layouts of the minimizer sections ('M').
+ *
+ */
+
+#include "kero-api/detail/layout.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+#include "ic.h"
+
+namespace kero {
+
+    namespace {
+
+        // TurboPFor decoders may read a few bytes after the end of the compressed input
+        constexpr uint64_t P4N_PADDING = 32;
+        // Number of values encoded at once when a column is written
+        constexpr uint64_t WRITE_CHUNK = 1ull << 16;
+        // Size of the pieces copied from the spilled sequences
+        constexpr uint64_t SPILL_COPY_SIZE = 1ull << 20;
+
+        /* Upper bound of the p4n compressed size of n values of size bytes. */
+        size_t p4nenc_bound(size_t n, size_t size) {
+            return (n + 127) / 128 + (n + 32) * size;
+        }
+
+        uint64_t read_u64_field(Kero_file* file) {
+            uint8_t buff[8];
+            uint64_t value;
+            file->read(buff, 8);
+            load_big_endian(buff, 8, value);
+            return value;
+        }
+
+        void write_u64_field(Kero_file* file, uint64_t value) {
+            uint8_t buff[8];
+            store_big_endian(buff, 8, value);
+            file->write(buff, 8);
+        }
+
+        void write_u64_field_at(Kero_file* file, uint64_t value, uint64_t position) {
+            uint8_t buff[8];
+            store_big_endian(buff, 8, value);
+            file->write_at(buff, 8, position);
+        }
+
+        uint64_t load_u64_field(const uint8_t* ptr) {
+            uint64_t value;
+            load_big_endian(ptr, 8, value);
+            return value;
+        }
+
+        /* Make at least needed compressed bytes available in the window of the cursor (or all the rest
+         * of the column), followed by P4N_PADDING zeros.
+         */
+        void fill_window(Kero_file* file, Column_cursor& cursor, uint64_t needed) {
+            uint64_t available = cursor.end - cursor.begin;
+            if (cursor.begin > 0) {
+                memmove(cursor.window.data(), cursor.window.data() + cursor.begin, available);
+                cursor.begin = 0;
+                cursor.end = available;
+            }
+
+            uint64_t to_read = needed > available ? std::min(needed - available, cursor.remaining_bytes) : 0;
+            if (cursor.window.size() < cursor.end + to_read + P4N_PADDING)
+                cursor.window.resize(cursor.end + to_read + P4N_PADDING);
+            if (to_read > 0) {
+                file->jump_to(cursor.position);
+                file->read(cursor.window.data() + cursor.end, to_read);
+                cursor.position += to_read;
+                cursor.remaining_bytes -= to_read;
+                cursor.end += to_read;
+            }
+            memset(cursor.window.data() + cursor.end, 0, P4N_PADDING);
+        }
+
+        /* Number of values of the next chunk of a column: aligned on COLUMN_CHUNK_ALIGN, at least target
+         * values and at most all the remaining ones. A budget of 0 decodes all the column at once.
+         */
+        uint64_t chunk_size(uint64_t remaining, uint64_t target, uint64_t budget) {
+            if (budget == 0)
+                return remaining;
+            uint64_t aligned = (std::max<uint64_t>(target, 1) + COLUMN_CHUNK_ALIGN - 1) / COLUMN_CHUNK_ALIGN
+                               * COLUMN_CHUNK_ALIGN;
+            return std::min(aligned, remaining);
+        }
+
+        /* Give the values of a column to encode by chunks of WRITE_CHUNK values: first the spilled values,
+         * then the buffered ones. Only the last chunk can be smaller.
+         */
+        template<typename T, typename Encode>
+        void stream_column(Section_spill* spill, Section_spill::Spill_column column, std::vector<T>& buffer,
+                           Encode encode) {
+            uint64_t spilled = spill == nullptr ? 0 : spill->size(column) / sizeof(T);
+            uint64_t used = 0;
+            std::vector<T> chunk;
+            while (spilled > 0) {
+                uint64_t count = std::min(WRITE_CHUNK, spilled);
+                chunk.resize(count);
+                spill->read(column, reinterpret_cast<uint8_t*>(chunk.data()), count * sizeof(T));
+                spilled -= count;
+                // The last spilled chunk is completed with the first buffered values
+                if (spilled == 0 and count < WRITE_CHUNK) {
+                    used = std::min<uint64_t>(WRITE_CHUNK - count, buffer.size());
+                    chunk.insert(chunk.end(), buffer.begin(), buffer.begin() + used);
+                }
+                encode(chunk.data(), chunk.size());
+            }
+            for (; used < buffer.size(); used += WRITE_CHUNK)
+                encode(buffer.data() + used, std::min<uint64_t>(WRITE_CHUNK, buffer.size() - used));
+        }
+
+        /* Count the bytes of the n, m_idx and data columns once decoded.
+         * The decoding time is accumulated on the file, the section gets its share since file_decode_ns.
+         */
+        void count_decoded_columns(Kero_stats& section, Kero_stats& file, uint64_t nb_blocks, uint64_t data_bytes,
+                                   uint64_t file_decode_ns) {
+#ifdef KERO_ENABLE_STATS
+            for (Kero_stats* stats : {&section, &file}) {
+                stats->n_column_bytes += nb_blocks * sizeof(uint64_t);
+                stats->m_idx_column_bytes += nb_blocks * sizeof(uint64_t);
+                stats->data_column_bytes += data_bytes;
+            }
+            section.decode_ns += file.decode_ns - file_decode_ns;
+#else
+            (void) section;
+            (void) file;
+            (void) nb_blocks;
+            (void) data_bytes;
+            (void) file_decode_ns;
+#endif
+        }
+
+    } // namespace
+
+
+    const char* layout_name(uint8_t layout) {
+        switch (layout) {
+            case KERO_LAYOUT_ROW:
+                return "row";
+            case KERO_LAYOUT_COLUMNAR_NOCOMP:
+                return "columnar_nocomp";
+            case KERO_LAYOUT_COLUMNAR_COMP:
+                return "columnar_comp";
+            default:
+                return "unknown";
+        }
+    }
+
+
+    // ----- Plain codec -----
+
+    void Plain_codec::write_u64(Kero_file* file, std::vector<uint64_t>& values) {
+        uint64_t header = begin_u64(file);
+        uint64_t bytes = encode_u64(file, values.data(), values.size());
+        end_u64(file, header, values.size(), bytes);
+    }
+
+    void Plain_codec::read_u64(Kero_file* file, uint64_t count, std::vector<uint64_t>& values) {
+        read_u64_field(file);  // Total bytes (count * 8)
+        std::vector<uint8_t> bytes(count * 8);
+        file->read(bytes.data(), bytes.size());
+        values.resize(count);
+        KERO_STATS_START(decode_start);
+        for (size_t i = 0; i < count; i++)
+            load_big_endian(bytes.data() + 8 * i, 8, values[i]);
+        KERO_STATS_ELAPSED(file->stats, decode_ns, decode_start);
+    }
+
+    void Plain_codec::load_u64(const uint8_t* column, uint64_t count, std::vector<uint64_t>& values) {
+        values.resize(count);
+        for (size_t i = 0; i < count; i++)
+            load_big_endian(column + 8 + 8 * i, 8, values[i]);
+    }
+
+    void Plain_codec::write_u8(Kero_file* file, std::vector<uint8_t>& values) {
+        uint64_t header = begin_u8(file);
+        uint64_t bytes = encode_u8(file, values.data(), values.size());
+        end_u8(file, header, values.size(), bytes);
+    }
+
+    void Plain_codec::read_u8(Kero_file* file, std::vector<uint8_t>& values) {
+        values.resize(read_u64_field(file));
+        file->read(values.data(), values.size());
+    }
+
+    void Plain_codec::load_u8(const uint8_t* column, std::vector<uint8_t>& values) {
+        uint64_t size = load_u64_field(column);
+        values.assign(column + 8, column + 8 + size);
+    }
+
+    uint64_t Plain_codec::begin_u64(Kero_file* file) {
+        uint64_t header = file->tellp();
+        write_u64_field(file, 0);  // Total bytes, backfilled
+        return header;
+    }
+
+    uint64_t Plain_codec::encode_u64(Kero_file* file, uint64_t* values, uint64_t count) {
+        std::vector<uint8_t> bytes(count * 8);
+        for (size_t i = 0; i < count; i++)
+            store_big_endian(bytes.data() + 8 * i, 8, values[i]);
+        if (count > 0)
+            file->write(bytes.data(), bytes.size());
+        return bytes.size();
+    }
+
+    void Plain_codec::end_u64(Kero_file* file, uint64_t header, uint64_t, uint64_t bytes) {
+        write_u64_field_at(file, bytes, header);
+    }
+
+    uint64_t Plain_codec::begin_u8(Kero_file* file) {
+        uint64_t header = file->tellp();
+        write_u64_field(file, 0);  // Size, backfilled
+        return header;
+    }
+
+    uint64_t Plain_codec::encode_u8(Kero_file* file, uint8_t* values, uint64_t count) {
+        if (count > 0)
+            file->write(values, count);
+        return count;
+    }
+
+    void Plain_codec::end_u8(Kero_file* file, uint64_t header, uint64_t count, uint64_t) {
+        write_u64_field_at(file, count, header);
+    }
+
+    void Plain_codec::open_u64(Kero_file*, uint64_t position, uint64_t count, Column_cursor& cursor) {
+        cursor = Column_cursor();
+        cursor.position = position + 8;
+        cursor.remaining_values = count;
+        cursor.remaining_bytes = count * 8;
+    }
+
+    void Plain_codec::decode_u64(Kero_file* file, Column_cursor& cursor, uint64_t count,
+                                 std::vector<uint64_t>& values) {
+        std::vector<uint8_t> bytes(count * 8);
+        file->jump_to(cursor.position);
+        file->read(bytes.data(), bytes.size());
+        cursor.position += bytes.size();
+        cursor.remaining_bytes -= bytes.size();
+        cursor.remaining_values -= count;
+
+        uint64_t offset = values.size();
+        values.resize(offset + count);
+        KERO_STATS_START(decode_start);
+        for (size_t i = 0; i < count; i++)
+            load_big_endian(bytes.data() + 8 * i, 8, values[offset + i]);
+        KERO_STATS_ELAPSED(file->stats, decode_ns, decode_start);
+    }
+
+    void Plain_codec::open_u8(Kero_file* file, uint64_t position, Column_cursor& cursor) {
+        cursor = Column_cursor();
+        file->jump_to(position);
+        cursor.remaining_values = cursor.remaining_bytes = read_u64_field(file);
+        cursor.position = position + 8;
+    }
+
+    void Plain_codec::decode_u8(Kero_file* file, Column_cursor& cursor, uint64_t count,
+                                std::vector<uint8_t>& values) {
+        uint64_t offset = values.size();
+        values.resize(offset + count);
+        file->jump_to(cursor.position);
+        file->read(values.data() + offset, count);
+        cursor.position += count;
+        cursor.remaining_bytes -= count;
+        cursor.remaining_values -= count;
+    }
+
+
+    // ----- TurboPFor codec -----
+
+    void P4n_codec::write_u64(Kero_file* file, std::vector<uint64_t>& values) {
+        uint64_t header = begin_u64(file);
+        uint64_t bytes = encode_u64(file, values.data(), values.size());
+        end_u64(file, header, values.size(), bytes);
+    }
+
+    void P4n_codec::read_u64(Kero_file* file, uint64_t count, std::vector<uint64_t>& values) {
+        uint64_t compressed_size = read_u64_field(file);
+        std::vector<uint8_t> compressed(compressed_size + P4N_PADDING, 0);
+        file->read(compressed.data(), compressed_size);
+        values.resize(count);
+        KERO_STATS_START(decode_start);
+        if (count > 0)
+            p4ndec64(compressed.data(), count, values.data());
+        KERO_STATS_ELAPSED(file->stats, decode_ns, decode_start);
+    }
+
+    void P4n_codec::load_u64(const uint8_t* column, uint64_t count, std::vector<uint64_t>& values) {
+        uint64_t compressed_size = load_u64_field(column);
+        std::vector<uint8_t> compressed(compressed_size + P4N_PADDING, 0);
+        memcpy(compressed.data(), column + 8, compressed_size);
+        values.resize(count);
+        if (count > 0)
+            p4ndec64(compressed.data(), count, values.data());
+    }
+
+    void P4n_codec::write_u8(Kero_file* file, std::vector<uint8_t>& values) {
+        uint64_t header = begin_u8(file);
+        uint64_t bytes = encode_u8(file, values.data(), values.size());
+        end_u8(file, header, values.size(), bytes);
+    }
+
+    void P4n_codec::read_u8(Kero_file* file, std::vector<uint8_t>& values) {
+        uint64_t size = read_u64_field(file);
+        uint64_t compressed_size = read_u64_field(file);
+        std::vector<uint8_t> compressed(compressed_size + P4N_PADDING, 0);
+        file->read(compressed.data(), compressed_size);
+        values.resize(size);
+        KERO_STATS_START(decode_start);
+        if (size > 0)
+            p4ndec8(compressed.data(), size, values.data());
+        KERO_STATS_ELAPSED(file->stats, decode_ns, decode_start);
+    }
+
+    void P4n_codec::load_u8(const uint8_t* column, std::vector<uint8_t>& values) {
+        uint64_t size = load_u64_field(column);
+        uint64_t compressed_size = load_u64_field(column + 8);
+        std::vector<uint8_t> compressed(compressed_size + P4N_PADDING, 0);
+        memcpy(compressed.data(), column + 16, compressed_size);
+        values.resize(size);
+        if (size > 0)
+            p4ndec8(compressed.data(), size, values.data());
+    }
+
+    uint64_t P4n_codec::begin_u64(Kero_file* file) {
+        uint64_t header = file->tellp();
+        write_u64_field(file, 0);  // Compressed size, backfilled
+        return header;
+    }
+
+    uint64_t P4n_codec::encode_u64(Kero_file* file, uint64_t* values, uint64_t count) {
+        std::vector<uint8_t> compressed(p4nenc_bound(count, sizeof(uint64_t)));
+        uint64_t compressed_size = p4nenc64(values, count, compressed.data());
+        if (compressed_size > 0)
+            file->write(compressed.data(), compressed_size);
+        return compressed_size;
+    }
+
+    void P4n_codec::end_u64(Kero_file* file, uint64_t header, uint64_t, uint64_t bytes) {
+        write_u64_field_at(file, bytes, header);
+    }
+
+    uint64_t P4n_codec::begin_u8(Kero_file* file) {
+        uint64_t header = file->tellp();
+        write_u64_field(file, 0);  // Size, backfilled
+        write_u64_field(file, 0);  // Compressed size, backfilled
+        return header;
+    }
+
+    uint64_t P4n_codec::encode_u8(Kero_file* file, uint8_t* values, uint64_t count) {
+        std::vector<uint8_t> compressed(p4nenc_bound(count, sizeof(uint8_t)));
+        uint64_t compressed_size = p4nenc8(values, count, compressed.data());
+        if (compressed_size > 0)
+            file->write(compressed.data(), compressed_size);
+        return compressed_size;
+    }
+
+    void P4n_codec::end_u8(Kero_file* file, uint64_t header, uint64_t count, uint64_t bytes) {
+        write_u64_field_at(file, count, header);
+        write_u64_field_at(file, bytes, header + 8);
+    }
+
+    void P4n_codec::open_u64(Kero_file* file, uint64_t position, uint64_t count, Column_cursor& cursor) {
+        cursor = Column_cursor();
+        file->jump_to(position);
+        cursor.remaining_bytes = read_u64_field(file);
+        cursor.remaining_values = count;
+        cursor.position = position + 8;
+    }
+
+    void P4n_codec::decode_u64(Kero_file* file, Column_cursor& cursor, uint64_t count,
+                               std::vector<uint64_t>& values) {
+        bool last = count == cursor.remaining_values;
+        fill_window(file, cursor, last ? UINT64_MAX : p4nenc_bound(count, sizeof(uint64_t)));
+
+        uint64_t offset = values.size();
+        values.resize(offset + count);
+        KERO_STATS_START(decode_start);
+        if (count > 0)
+            cursor.begin += p4ndec64(cursor.window.data() + cursor.begin, count, values.data() + offset);
+        KERO_STATS_ELAPSED(file->stats, decode_ns, decode_start);
+        cursor.remaining_values -= count;
+    }
+
+    void P4n_codec::open_u8(Kero_file* file, uint64_t position, Column_cursor& cursor) {
+        cursor = Column_cursor();
+        file->jump_to(position);
+        cursor.remaining_values = read_u64_field(file);
+        cursor.remaining_bytes = read_u64_field(file);
+        cursor.position = position + 16;
+    }
+
+    void P4n_codec::decode_u8(Kero_file* file, Column_cursor& cursor, uint64_t count,
+                              std::vector<uint8_t>& values) {
+        bool last = count == cursor.remaining_values;
+        fill_window(file, cursor, last ? UINT64_MAX : p4nenc_bound(count, sizeof(uint8_t)));
+
+        uint64_t offset = values.size();
+        values.resize(offset + count);
+        KERO_STATS_START(decode_start);
+        if (count > 0)
+            cursor.begin += p4ndec8(cursor.window.data() + cursor.begin, count, values.data() + offset);
+        KERO_STATS_ELAPSED(file->stats, decode_ns, decode_start);
+        cursor.remaining_values -= count;
+    }
+
+
+    // ----- Spill files -----
+
+    Section_spill::Section_spill(const std::string& directory, const std::string& name) {
+        // Several sections can be written at the same time, in this process or in others
+        const char* suffixes[NB_COLUMNS] = {".n", ".m_idx", ".data", ".seq"};
+        try {
+            for (int c = 0; c < NB_COLUMNS; c++) {
+                paths[c] = create_temp_file(directory, name + ".spill" + suffixes[c]);
+                streams[c].open(paths[c], std::fstream::binary | std::fstream::in | std::fstream::out
+                                          | std::fstream::trunc);
+                if (streams[c].fail())
+                    throw std::runtime_error("Cannot create the spill file " + paths[c]);
+            }
+        } catch (...) {
+            this->remove_files();
+            throw;
+        }
+    }
+
+    Section_spill::~Section_spill() {
+        this->remove_files();
+    }
+
+    void Section_spill::remove_files() {
+        for (int c = 0; c < NB_COLUMNS; c++) {
+            streams[c].close();
+            if (not paths[c].empty())
+                std::remove(paths[c].c_str());
+        }
+    }
+
+    void Section_spill::append(Spill_column column, const uint8_t* bytes, uint64_t size) {
+        streams[column].write(reinterpret_cast<const char*>(bytes), size);
+        if (streams[column].fail())
+            throw std::runtime_error("File system error while writing " + paths[column]);
+        sizes[column] += size;
+    }
+
+    void Section_spill::rewind() {
+        for (auto& stream : streams) {
+            stream.flush();
+            stream.seekg(0);
+        }
+    }
+
+    void Section_spill::read(Spill_column column, uint8_t* bytes, uint64_t size) {
+        streams[column].read(reinterpret_cast<char*>(bytes), size);
+        if (streams[column].fail())
+            throw std::runtime_error("File system error while reading " + paths[column]);
+    }
+
+
+    // ----- Columnar layouts -----
+
+    template<class Codec>
+    void Columnar_layout<Codec>::spill_buffers(Section_Minimizer& sm) {
+        Kero_file* file = sm.file;
+        uint64_t buffered = 2 * sizeof(uint64_t) * sm.n_value_buffer.size() + sm.data_buffer.size()
+                            + sm.seq_buffer.size();
+        if (file->section_budget == 0 or buffered <= file->section_budget)
+            return;
+
+        if (sm.spill == nullptr) {
+            // The streams and the in-memory files have no directory of their own
+            if (file->in_memory or file->streaming or file->filename.empty())
+                sm.spill.reset(new Section_spill("", "kero"));
+            else {
+                size_t slash = file->filename.find_last_of('/');
+                if (slash == std::string::npos)
+                    sm.spill.reset(new Section_spill(".", file->filename));
+                else
+                    sm.spill.reset(new Section_spill(file->filename.substr(0, slash),
+                                                     file->filename.substr(slash + 1)));
+            }
+        }
+        sm.spill->append(Section_spill::N, reinterpret_cast<uint8_t*>(sm.n_value_buffer.data()),
+                         sm.n_value_buffer.size() * sizeof(uint64_t));
+        sm.spill->append(Section_spill::M_IDX, reinterpret_cast<uint8_t*>(sm.m_idx_buffer.data()),
+                         sm.m_idx_buffer.size() * sizeof(uint64_t));
+        sm.spill->append(Section_spill::DATA, sm.data_buffer.data(), sm.data_buffer.size());
+        sm.spill->append(Section_spill::SEQ, sm.seq_buffer.data(), sm.seq_buffer.size());
+        KERO_STATS_ADD(sm.stats, spilled_bytes, buffered);
+        KERO_STATS_ADD(file->stats, spilled_bytes, buffered);
+
+        // The capacity is kept for the next super k-mers
+        sm.n_value_buffer.clear();
+        sm.m_idx_buffer.clear();
+        sm.data_buffer.clear();
+        sm.seq_buffer.clear();
+    }
+
+    /* Write the n, m_idx, data and seq columns in this order and save their positions.
+     * The spilled values come first in every column, then the buffered ones.
+     */
+    template<class Codec>
+    void Columnar_layout<Codec>::write_columns(Section_Minimizer& sm) {
+        Kero_file* file = sm.file;
+        Section_spill* spill = sm.spill.get();
+        if (spill != nullptr)
+            spill->rewind();
+        uint64_t header, bytes;
+
+        sm.n_col_offset = file->tellp();
+        header = Codec::begin_u64(file);
+        bytes = 0;
+        stream_column(spill, Section_spill::N, sm.n_value_buffer, [&](uint64_t* values, uint64_t count) {
+            bytes += Codec::encode_u64(file, values, count);
+        });
+        Codec::end_u64(file, header, sm.nb_blocks, bytes);
+
+        sm.m_idx_col_offset = file->tellp();
+        header = Codec::begin_u64(file);
+        bytes = 0;
+        stream_column(spill, Section_spill::M_IDX, sm.m_idx_buffer, [&](uint64_t* values, uint64_t count) {
+            bytes += Codec::encode_u64(file, values, count);
+        });
+        Codec::end_u64(file, header, sm.nb_blocks, bytes);
+
+        sm.data_col_offset = file->tellp();
+        header = Codec::begin_u8(file);
+        bytes = 0;
+        uint64_t data_count = sm.data_buffer.size() + (spill == nullptr ? 0 : spill->size(Section_spill::DATA));
+        stream_column(spill, Section_spill::DATA, sm.data_buffer, [&](uint8_t* values, uint64_t count) {
+            bytes += Codec::encode_u8(file, values, count);
+        });
+        Codec::end_u8(file, header, data_count, bytes);
+
+        sm.seq_col_offset = file->tellp();
+        if (spill != nullptr) {
+            std::vector<uint8_t> piece;
+            for (uint64_t left = spill->size(Section_spill::SEQ); left > 0; left -= piece.size()) {
+                piece.resize(std::min(left, SPILL_COPY_SIZE));
+                spill->read(Section_spill::SEQ, piece.data(), piece.size());
+                file->write(piece.data(), piece.size());
+            }
+        }
+        if (not sm.seq_buffer.empty())
+            file->write(sm.seq_buffer.data(), sm.seq_buffer.size());
+
+        sm.spill.reset();
+    }
+
+    /* Decode the integer and data columns by chunks, the next chunk being decoded when the previous
+     * one is consumed. The seq column is read from the file, one super k-mer at a time.
+     */
+    template<class Codec>
+    uint64_t Columnar_layout<Codec>::read_compacted_sequence_without_mini(
+            Section_Minimizer& sm, uint8_t* seq, uint8_t* data, uint64_t& mini_pos) {
+        Kero_file* file = sm.file;
+        uint64_t budget = file->section_budget;
+
+        if (sm.cur_skmer_idx == 0) {
+            sm.last_n_pos = 0;
+            sm.last_m_idx_pos = 0;
+            sm.last_data_pos = 0;
+            // seq is read from the file, not from a buffer in memory
+            sm.last_seq_pos = sm.seq_col_offset;
+
+            // Columns already loaded by precache_columns_from_mmap are reused
+            if (sm.n_value_buffer.size() != sm.nb_blocks) {
+                sm.n_value_buffer.clear();
+                sm.m_idx_buffer.clear();
+                sm.data_buffer.clear();
+                Codec::open_u64(file, sm.n_col_offset, sm.nb_blocks, sm.n_cursor);
+                Codec::open_u64(file, sm.m_idx_col_offset, sm.nb_blocks, sm.m_idx_cursor);
+                if (sm.data_size > 0)
+                    Codec::open_u8(file, sm.data_col_offset, sm.data_cursor);
+            }
+        }
+
+        // Next chunk of n and m_idx values: a quarter of the budget for each column, compressed and decoded
+        if (sm.last_n_pos == sm.n_value_buffer.size()) {
+            KERO_LATENCY_SPAN(decode_span, LOOKUP_COLUMN_DECODE);
+            uint64_t decode_ns = file->stats.decode_ns;
+            uint64_t count = chunk_size(sm.n_cursor.remaining_values, budget / (4 * 2 * sizeof(uint64_t)), budget);
+            sm.n_value_buffer.clear();
+            sm.m_idx_buffer.clear();
+            Codec::decode_u64(file, sm.n_cursor, count, sm.n_value_buffer);
+            Codec::decode_u64(file, sm.m_idx_cursor, count, sm.m_idx_buffer);
+            sm.last_n_pos = 0;
+            sm.last_m_idx_pos = 0;
+            count_decoded_columns(sm.stats, file->stats, count, 0, decode_ns);
+        }
+
+        uint64_t n = sm.n_value_buffer[sm.last_n_pos++];
+        mini_pos = sm.m_idx_buffer[sm.last_m_idx_pos++];
+
+        // Next chunk of data, after the bytes not read yet: half of the budget, compressed and decoded
+        uint64_t nb_data_bytes = sm.data_size * n;
+        if (sm.last_data_pos + nb_data_bytes > sm.data_buffer.size()) {
+            KERO_LATENCY_SPAN(decode_span, LOOKUP_COLUMN_DECODE);
+            uint64_t decode_ns = file->stats.decode_ns;
+            sm.data_buffer.erase(sm.data_buffer.begin(), sm.data_buffer.begin() + sm.last_data_pos);
+            sm.last_data_pos = 0;
+            uint64_t missing = nb_data_bytes - sm.data_buffer.size();
+            if (missing > sm.data_cursor.remaining_values)
+                throw std::runtime_error("The data column of a minimizer section is shorter than its n column.");
+            uint64_t count = chunk_size(sm.data_cursor.remaining_values, std::max(missing, budget / 4), budget);
+            Codec::decode_u8(file, sm.data_cursor, count, sm.data_buffer);
+            count_decoded_columns(sm.stats, file->stats, 0, count, decode_ns);
+        }
+        if (data != nullptr and nb_data_bytes > 0)
+            memcpy(data, sm.data_buffer.data() + sm.last_data_pos, nb_data_bytes);
+        sm.last_data_pos += nb_data_bytes;
+
+        uint64_t nb_seq_bytes = bytes_from_bit_array(2, n + sm.k - sm.m - 1);
+        file->jump_to(sm.last_seq_pos);
+        file->read(seq, nb_seq_bytes);
+        sm.last_seq_pos += nb_seq_bytes;
+        KERO_STATS_ADD(sm.stats, seq_column_bytes, nb_seq_bytes);
+        KERO_STATS_ADD(file->stats, seq_column_bytes, nb_seq_bytes);
+
+        return n;
+    }
+
+    template<class Codec>
+    void Columnar_layout<Codec>::precache_columns_from_mmap(Section_Minimizer& sm, const uint8_t* mmap_ptr) {
+        uint64_t decode_ns = sm.file->stats.decode_ns;
+        KERO_STATS_START(decode_start);
+        Codec::load_u64(mmap_ptr + sm.n_col_offset, sm.nb_blocks, sm.n_value_buffer);
+        Codec::load_u64(mmap_ptr + sm.m_idx_col_offset, sm.nb_blocks, sm.m_idx_buffer);
+        if (sm.data_size > 0)
+            Codec::load_u8(mmap_ptr + sm.data_col_offset, sm.data_buffer);
+        KERO_STATS_ELAPSED(sm.file->stats, decode_ns, decode_start);
+        count_decoded_columns(sm.stats, sm.file->stats, sm.nb_blocks, sm.data_buffer.size(), decode_ns);
+    }
+
+    /* The seq column is the last one, its size follows from the n values. */
+    template<class Codec>
+    uint64_t Columnar_layout<Codec>::section_end(Section_Minimizer& sm) {
+        Kero_file* file = sm.file;
+        uint64_t budget = file->section_budget;
+        Column_cursor cursor;
+        std::vector<uint64_t> n_values;
+        uint64_t seq_bytes = 0;
+
+        Codec::open_u64(file, sm.n_col_offset, sm.nb_blocks, cursor);
+        while (cursor.remaining_values > 0) {
+            n_values.clear();
+            Codec::decode_u64(file, cursor, chunk_size(cursor.remaining_values, budget / sizeof(uint64_t), budget),
+                              n_values);
+            for (uint64_t n : n_values)
+                seq_bytes += bytes_from_bit_array(2, n + sm.k - sm.m - 1);
+        }
+
+        return sm.seq_col_offset + seq_bytes;
+    }
+
+    template struct Columnar_layout<Plain_codec>;
+    template struct Columnar_layout<P4n_codec>;
+
+
+    // ----- Row layout -----
+
+    /* Write the header immediately, with 0 super k-mers as placeholder.
+     * This ensures the file structure is [header][rows] instead of [rows][header].
+     */
+    void Row_layout::write_minimizer(Section_Minimizer& sm) {
+        Kero_file* file = sm.file;
+
+        char type = 'M';
+        file->write(reinterpret_cast<uint8_t *>(&type), 1);
+        file->write(sm.minimizer, sm.nb_bytes_mini);
+
+        // Save the position of the count for backfilling
+        sm.n_col_offset = file->tellp();
+        write_u64_field(file, 0);
+    }
+
+    /* Format: [n:8B][m_idx:8B][seq:nB][data:nB] */
+    void Row_layout::write_compacted_sequence_without_mini(Section_Minimizer& sm, uint8_t* seq, uint64_t seq_size,
+                                                           uint64_t mini_pos, uint8_t* data_array) {
+        Kero_file* file = sm.file;
+        uint64_t nb_kmers = seq_size + sm.m - sm.k + 1;
+
+        write_u64_field(file, nb_kmers);
+        write_u64_field(file, mini_pos);
+        file->write(seq, bytes_from_bit_array(2, seq_size));
+        uint64_t data_bytes = sm.data_size * nb_kmers;
+        if (data_bytes > 0)
+            file->write(data_array, data_bytes);
+
+        sm.nb_blocks++;
+    }
+
+    void Row_layout::close(Section_Minimizer& sm) {
+        uint8_t buff[8];
+        store_big_endian(buff, 8, sm.nb_blocks);
+        sm.file->write_at(buff, 8, sm.n_col_offset);
+    }
+
+    uint64_t Row_layout::read_compacted_sequence_without_mini(Section_Minimizer& sm, uint8_t* seq, uint8_t* data,
+                                                              uint64_t& mini_pos) {
+        Kero_file* file = sm.file;
+
+        uint64_t n = read_u64_field(file);
+        mini_pos = read_u64_field(file);
+        file->read(seq, bytes_from_bit_array(2, n + sm.k - sm.m - 1));
+
+        uint64_t data_bytes = sm.data_size * n;
+        if (data != nullptr)
+            file->read(data, data_bytes);
+        else
+            file->jump(data_bytes);
+
+        return n;
+    }
+
+    /* Read the rows into the column buffers (n, m_idx, seq and data). */
+    void Row_layout::precache_columns_from_mmap(Section_Minimizer& sm, const uint8_t* mmap_ptr) {
+        sm.n_value_buffer.resize(sm.nb_blocks);
+        sm.m_idx_buffer.resize(sm.nb_blocks);
+        sm.seq_buffer.clear();
+        sm.data_buffer.clear();
+
+        const uint8_t* row = mmap_ptr + sm.n_col_offset;
+        for (size_t i = 0; i < sm.nb_blocks; i++) {
+            uint64_t n = load_u64_field(row);
+            sm.n_value_buffer[i] = n;
+            sm.m_idx_buffer[i] = load_u64_field(row + 8);
+            row += 16;
+
+            uint64_t seq_bytes = bytes_from_bit_array(2, n + sm.k - sm.m - 1);
+            sm.seq_buffer.insert(sm.seq_buffer.end(), row, row + seq_bytes);
+            row += seq_bytes;
+
+            uint64_t data_bytes = n * sm.data_size;
+            sm.data_buffer.insert(sm.data_buffer.end(), row, row + data_bytes);
+            row += data_bytes;
+        }
+        count_decoded_columns(sm.stats, sm.file->stats, sm.nb_blocks, sm.data_buffer.size(), sm.file->stats.decode_ns);
+    }
+
+    /* The rows start after the header, the size of each row follows from its n value. */
+    uint64_t Row_layout::section_end(Section_Minimizer& sm) {
+        Kero_file* file = sm.file;
+        uint64_t position = sm.n_col_offset;
+        for (uint64_t i = 0; i < sm.nb_blocks; i++) {
+            file->jump_to(position);
+            uint64_t n = read_u64_field(file);
+            position += 16 + bytes_from_bit_array(2, n + sm.k - sm.m - 1) + n * sm.data_size;
+        }
+        return position;
+    }
+
+} // namespace kero
@@ -11,17 +11,37 @@
 
 #include "kero-api/kero_mmap.hpp"
 
+#include <algorithm>
+#include <iterator>
+
 // Required for mmap, fstat, etc.
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "kero-api/kero_io.hpp"
+
 namespace kero {
 
-    Kero_Mmap_Accessor::Kero_Mmap_Accessor(const std::string& filename)
-        : fd(-1), file_ptr(nullptr), file_size(0) {
-        fd = open(filename.c_str(), O_RDONLY);
+    namespace {
+
+        int access_advice(Mmap_access access) {
+            switch (access) {
+                case MMAP_ACCESS_SEQUENTIAL:
+                    return MADV_SEQUENTIAL;
+                case MMAP_ACCESS_RANDOM:
+                    return MADV_RANDOM;
+                default:
+                    return MADV_NORMAL;
+            }
+        }
+
+    } // namespace
+
+    Kero_Mmap_Accessor::Kero_Mmap_Accessor(const std::string& filename, const Mmap_options& options)
+        : fd(-1), file_ptr(nullptr), file_size(0), writable(options.writable) {
+        fd = open(filename.c_str(), writable ? O_RDWR : O_RDONLY);
         if (fd == -1) {
             throw std::runtime_error("Mmap_Accessor: Failed to open file: " + filename);
         }
@@ -34,12 +54,25 @@ namespace kero {
         file_size = sb.st_size;
 
         // MAP_PRIVATE ensures that writes to the mapping are not propagated to the file.
-        // It's good practice for read-only access.
-        file_ptr = static_cast<uint8_t*>(mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0));
+        // It's good practice for read-only access. A writable mapping is shared with the file.
+        int flags = writable ? MAP_SHARED : MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        if (options.populate)
+            flags |= MAP_POPULATE;
+#endif
+        int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        file_ptr = static_cast<uint8_t*>(mmap(nullptr, file_size, protection, flags, fd, 0));
         if (file_ptr == MAP_FAILED) {
+            file_ptr = nullptr;
             close(fd);
             throw std::runtime_error("Mmap_Accessor: Failed to map file to memory.");
         }
+
+        // The advices are hints: a refusal does not prevent the reads
+        if (options.access != MMAP_ACCESS_NORMAL)
+            advise(0, file_size, options.access);
+        if (options.willneed)
+            prefetch(0, file_size);
     }
 
     Kero_Mmap_Accessor::~Kero_Mmap_Accessor() {
@@ -51,4 +84,60 @@ namespace kero {
         }
     }
 
-} // namespace kero
\ No newline at end of file
+    bool Kero_Mmap_Accessor::advise_range(size_t offset, size_t length, int advice) {
+        if (offset >= file_size or length == 0)
+            return true;
+        length = std::min(length, file_size - offset);
+
+        // madvise needs a page aligned address
+        auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = offset - offset % page;
+        return madvise(file_ptr + begin, offset + length - begin, advice) == 0;
+    }
+
+    bool Kero_Mmap_Accessor::advise(size_t offset, size_t length, Mmap_access access) {
+        return advise_range(offset, length, access_advice(access));
+    }
+
+    bool Kero_Mmap_Accessor::prefetch(size_t offset, size_t length) {
+        return advise_range(offset, length, MADV_WILLNEED);
+    }
+
+    bool Kero_Mmap_Accessor::advise_huge_pages(size_t offset, size_t length) {
+#ifdef MADV_HUGEPAGE
+        return advise_range(offset, length, MADV_HUGEPAGE);
+#else
+        (void)offset;
+        (void)length;
+        return false;
+#endif
+    }
+
+    bool Kero_Mmap_Accessor::sync(size_t offset, size_t length) {
+        if (not writable or offset >= file_size or length == 0)
+            return true;
+        length = std::min(length, file_size - offset);
+
+        // msync needs a page aligned address
+        auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = offset - offset % page;
+        return msync(file_ptr + begin, offset + length - begin, MS_SYNC) == 0;
+    }
+
+    size_t Kero_Mmap_Accessor::warm_metadata(const Kero_file& file, bool huge_pages) {
+        size_t advised = 0;
+        for (auto it = file.section_positions.begin(); it != file.section_positions.end(); ++it) {
+            if (it->second != 'i' and it->second != 'h')
+                continue;
+            auto next = std::next(it);
+            size_t end = next != file.section_positions.end() ? next->first : file.end_position;
+            size_t length = end - it->first;
+            if (huge_pages)
+                advise_huge_pages(it->first, length);
+            prefetch(it->first, length);
+            advised += length;
+        }
+        return advised;
+    }
+
+} // namespace kero
@@ -0,0 +1,246 @@
+/**
+* @file kero_prefetch.cpp
+ *
+ * @brief This file implements the read-ahead of the sequence sections.
+ *
+ */
+
+#include "kero-api/detail/prefetch.hpp"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    namespace {
+
+        /* Ask the kernel to read the next bytes of the file in the background. */
+        class Read_advisor {
+        private:
+            int fd;
+            uint64_t advised_end;
+
+        public:
+            explicit Read_advisor(const std::string& filename) : advised_end(0) {
+                this->fd = open(filename.c_str(), O_RDONLY);
+            }
+
+            ~Read_advisor() {
+                if (this->fd >= 0)
+                    close(this->fd);
+            }
+
+            void reached(uint64_t position) {
+#ifdef POSIX_FADV_WILLNEED
+                // Renew the advice once half of the advised range is read
+                if (this->fd < 0 or position + PREFETCH_ADVISE_BYTES / 2 < this->advised_end)
+                    return;
+                posix_fadvise(this->fd, static_cast<off_t>(position), PREFETCH_ADVISE_BYTES, POSIX_FADV_WILLNEED);
+                this->advised_end = position + PREFETCH_ADVISE_BYTES;
+#else
+                (void)position;
+#endif
+            }
+        };
+
+        void store_u64(std::vector<uint8_t>& bytes, uint64_t value) {
+            uint8_t buff[8];
+            kero::store_big_endian(buff, 8, value);
+            bytes.insert(bytes.end(), buff, buff + 8);
+        }
+
+    } // namespace
+
+
+    // ----- Prefetched sections -----
+
+    Prefetched_section::Prefetched_section(Section_prefetcher* prefetcher, Prefetch_chunk&& first_chunk, uint64_t k,
+                                           uint64_t max, uint64_t data_size)
+        : prefetcher(prefetcher), chunk(std::move(first_chunk)), chunk_offset(0) {
+        this->chunk_remaining = this->chunk.nb_blocks;
+        this->nb_blocks = this->remaining_blocks = this->chunk.section_blocks;
+        this->nb_kmers_bytes = 8;
+        this->new_vars = this->chunk.new_vars;
+        if (this->new_vars) {
+            this->vars = std::move(this->chunk.vars);
+            k = this->vars["k"];
+            max = this->vars["max"];
+            data_size = this->vars["data_size"];
+        }
+        this->k = k;
+        this->max = max;
+        this->data_size = data_size;
+    }
+
+    const uint8_t* Prefetched_section::next_block(uint64_t& nb_kmers, uint64_t& seq_bytes) {
+        if (this->remaining_blocks == 0)
+            throw std::runtime_error("Prefetched_section: no block left in the section");
+        while (this->chunk_remaining == 0) {
+            if (not this->prefetcher->pop(this->chunk) or this->chunk.first)
+                throw std::runtime_error("Prefetched_section: the read-ahead queue ended inside a section");
+            this->chunk_offset = 0;
+            this->chunk_remaining = this->chunk.nb_blocks;
+        }
+
+        const uint8_t* block = this->chunk.bytes.data() + this->chunk_offset;
+        load_big_endian(block, 8, nb_kmers);
+        seq_bytes = bytes_from_bit_array(2, nb_kmers + this->k - 1);
+        this->chunk_offset += 8 + seq_bytes + nb_kmers * this->data_size;
+        this->chunk_remaining -= 1;
+        this->remaining_blocks -= 1;
+        return block + 8;
+    }
+
+    uint64_t Prefetched_section::read_compacted_sequence(uint8_t* seq, uint8_t* data) {
+        uint64_t nb_kmers, seq_bytes;
+        const uint8_t* block = this->next_block(nb_kmers, seq_bytes);
+        memcpy(seq, block, seq_bytes);
+        if (nb_kmers * this->data_size > 0)
+            memcpy(data, block + seq_bytes, nb_kmers * this->data_size);
+        return nb_kmers;
+    }
+
+    uint64_t Prefetched_section::read_compacted_sequence(uint8_t* seq_data) {
+        uint64_t nb_kmers, seq_bytes;
+        const uint8_t* block = this->next_block(nb_kmers, seq_bytes);
+        memcpy(seq_data, block, seq_bytes + nb_kmers * this->data_size);
+        return nb_kmers;
+    }
+
+    void Prefetched_section::jump_sequence() {
+        uint64_t nb_kmers, seq_bytes;
+        this->next_block(nb_kmers, seq_bytes);
+    }
+
+
+    // ----- Read-ahead thread -----
+
+    Section_prefetcher::Section_prefetcher(const std::string& filename, uint64_t nb_chunks)
+        : filename(filename), capacity(std::max<uint64_t>(1, nb_chunks)), producer_done(false), stopping(false) {
+        this->thread = std::thread(&Section_prefetcher::run, this);
+    }
+
+    Section_prefetcher::~Section_prefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->not_full.notify_all();
+        this->thread.join();
+    }
+
+    bool Section_prefetcher::push(Prefetch_chunk&& chunk) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->not_full.wait(lock, [this] { return this->stopping or this->queue.size() < this->capacity; });
+        if (this->stopping)
+            return false;
+        this->queue.push_back(std::move(chunk));
+        lock.unlock();
+        this->not_empty.notify_one();
+        return true;
+    }
+
+    bool Section_prefetcher::pop(Prefetch_chunk& chunk) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->not_empty.wait(lock, [this] { return this->producer_done or not this->queue.empty(); });
+        if (this->queue.empty()) {
+            if (this->error != nullptr)
+                std::rethrow_exception(this->error);
+            return false;
+        }
+        chunk = std::move(this->queue.front());
+        this->queue.pop_front();
+        lock.unlock();
+        this->not_full.notify_one();
+        return true;
+    }
+
+    Prefetched_section* Section_prefetcher::next_section(uint64_t k, uint64_t max, uint64_t data_size) {
+        Prefetch_chunk chunk;
+        if (not this->pop(chunk))
+            return nullptr;
+        if (not chunk.first)
+            throw std::runtime_error("Section_prefetcher: chunk out of its section");
+        return new Prefetched_section(this, std::move(chunk), k, max, data_size);
+    }
+
+    /* Walk the sections as Kero_reader does and decode the blocks of the sequence sections. */
+    void Section_prefetcher::run() {
+        try {
+            Kero_file file(this->filename, "r");
+            file.complete_header();
+            Read_advisor advisor(this->filename);
+            std::vector<uint8_t> block;
+
+            bool running = true;
+            bool new_vars = true;
+            while (running and file.tellp() < file.end_position) {
+                advisor.reached(file.tellp());
+                char section_type = file.read_section_type();
+                if (section_type == 'v') {
+                    Section_GV gvs(&file);
+                    new_vars = true;
+                    continue;
+                } else if (section_type == 'i') {
+                    Section_Index index(&file);
+                    index.close();
+                    continue;
+                } else if (section_type == 'h') {
+                    Section_Hashtable hashtable(&file);
+                    hashtable.close();
+                    continue;
+                }
+
+                std::unique_ptr<Block_section_reader> section(Block_section_reader::construct_section(&file));
+                if (section == nullptr)
+                    throw std::runtime_error("Section_prefetcher: unknown section type " + std::string(1, section_type));
+
+                // The sizes come from the variables: the section classes shadow the members of Block_section_reader
+                uint64_t k = file.global_vars["k"];
+                uint64_t max = file.global_vars["max"];
+                uint64_t data_size = file.global_vars["data_size"];
+
+                Prefetch_chunk chunk;
+                chunk.first = true;
+                chunk.section_blocks = section->nb_blocks;
+                if (new_vars) {
+                    chunk.new_vars = true;
+                    chunk.vars = file.global_vars;
+                    new_vars = false;
+                }
+                block.resize(bytes_from_bit_array(2, k + max - 1) + max * data_size);
+                while (running and section->remaining_blocks > 0) {
+                    uint64_t nb_kmers = section->read_compacted_sequence(block.data());
+                    uint64_t block_bytes = bytes_from_bit_array(2, nb_kmers + k - 1) + nb_kmers * data_size;
+                    store_u64(chunk.bytes, nb_kmers);
+                    chunk.bytes.insert(chunk.bytes.end(), block.data(), block.data() + block_bytes);
+                    chunk.nb_blocks += 1;
+
+                    if (chunk.bytes.size() >= PREFETCH_CHUNK_BYTES and section->remaining_blocks > 0) {
+                        running = this->push(std::move(chunk));
+                        chunk = Prefetch_chunk();
+                        advisor.reached(file.tellp());
+                    }
+                }
+                if (running)
+                    running = this->push(std::move(chunk));
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->producer_done = true;
+        }
+        this->not_empty.notify_all();
+    }
+
+} // namespace kero
@@ -0,0 +1,217 @@
+/**
+* @file kero_shard.cpp
+ *
+ * @brief This file implements the sharding of kero files by minimizer hash.
+ *
+ */
+
+#include "kero-api/kero_shard.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    namespace {
+
+        const uint64_t MANIFEST_VERSION = 1;
+
+        std::string base_name(const std::string& path) {
+            size_t slash = path.find_last_of('/');
+            return slash == std::string::npos ? path : path.substr(slash + 1);
+        }
+
+        std::string directory(const std::string& path) {
+            size_t slash = path.find_last_of('/');
+            return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+        }
+
+    } // namespace
+
+
+    uint64_t Shard_manifest::shard_of(uint64_t minimizer) const {
+        uint64_t hash = minimizer_hash(mask_mini(minimizer, m));
+        // First range that ends at or after the hash
+        auto it = std::lower_bound(ranges.begin(), ranges.end(), hash,
+                                   [](const Hash_range& range, uint64_t value) { return range.last < value; });
+        if (it == ranges.end() or hash < it->first)
+            throw std::runtime_error("Shard manifest: no shard for the minimizer " + std::to_string(minimizer));
+        return it - ranges.begin();
+    }
+
+    void Shard_manifest::save(const std::string& path) const {
+        std::ofstream out(path);
+        out << "kero_shards " << MANIFEST_VERSION << "\n";
+        out << "m " << m << "\n";
+        out << "shards " << files.size() << "\n";
+        for (size_t i = 0; i < files.size(); i++)
+            out << "shard " << i << " " << ranges[i].first << " " << ranges[i].last << " " << files[i] << "\n";
+        if (out.fail())
+            throw std::runtime_error("Shard manifest: impossible to write " + path);
+    }
+
+    Shard_manifest Shard_manifest::load(const std::string& path) {
+        std::ifstream in(path);
+        if (not in)
+            throw std::runtime_error("Shard manifest: impossible to open " + path);
+
+        Shard_manifest manifest;
+        uint64_t version = 0, nb_shards = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string key;
+            if (not (fields >> key))
+                continue;
+
+            if (key == "kero_shards")
+                fields >> version;
+            else if (key == "m")
+                fields >> manifest.m;
+            else if (key == "shards")
+                fields >> nb_shards;
+            else if (key == "shard") {
+                uint64_t index;
+                Hash_range range;
+                std::string file;
+                fields >> index >> range.first >> range.last >> file;
+                if (fields.fail() or index != manifest.files.size())
+                    throw std::runtime_error("Shard manifest: malformed shard line in " + path);
+                manifest.ranges.push_back(range);
+                manifest.files.push_back(file);
+            }
+            else
+                throw std::runtime_error("Shard manifest: unknown entry " + key + " in " + path);
+        }
+
+        if (version != MANIFEST_VERSION)
+            throw std::runtime_error("Shard manifest: unsupported version in " + path);
+        if (nb_shards == 0 or manifest.files.size() != nb_shards)
+            throw std::runtime_error("Shard manifest: " + path + " declares " + std::to_string(nb_shards)
+                                     + " shards and lists " + std::to_string(manifest.files.size()));
+        return manifest;
+    }
+
+
+    Shard_writer::Shard_writer(const std::string& prefix, uint64_t nb_shards) : prefix(prefix) {
+        for (uint64_t i = 0; i < nb_shards; i++) {
+            std::string path = prefix + "." + std::to_string(i) + ".kero";
+            this->manifest.ranges.push_back(Hash_range::part(i, nb_shards));
+            this->manifest.files.push_back(base_name(path));
+            this->files.emplace_back(new Kero_file(path, "w"));
+        }
+    }
+
+    Shard_writer::~Shard_writer() {}
+
+    void Shard_writer::write_vars(const std::map<std::string, uint64_t>& vars) {
+        auto m = vars.find("m");
+        if (m == vars.end())
+            throw std::invalid_argument("Shard writer: the variables must define m.");
+        if (this->manifest.m != 0 and this->manifest.m != m->second)
+            throw std::invalid_argument("Shard writer: m cannot change between the sections.");
+        this->manifest.m = m->second;
+
+        for (auto& file : this->files) {
+            Section_GV sgv(file.get());
+            for (const auto& var : vars)
+                sgv.write_var(var.first, var.second);
+            sgv.close();
+        }
+    }
+
+    Kero_file& Shard_writer::shard(uint64_t minimizer) {
+        if (this->manifest.m == 0)
+            throw std::runtime_error("Shard writer: m must be written (write_vars) before the sections.");
+        return *this->files[this->manifest.shard_of(minimizer)];
+    }
+
+    Shard_manifest Shard_writer::close() {
+        for (auto& file : this->files)
+            file->close();
+        this->manifest.save(this->prefix + ".manifest");
+        return this->manifest;
+    }
+
+
+    Shard_manifest shard_file(const std::string& input, const std::string& prefix, uint64_t nb_shards) {
+        Kero_file infile(input, "r");
+        std::vector<uint8_t> metadata(infile.metadata_size);
+        infile.read_metadata(metadata.data());
+        if (not infile.hashtable_discovery())
+            throw std::runtime_error("Sharding: " + input + " has no hashtable, reindex it first.");
+
+        std::vector<uint64_t> minimizers, positions;
+        infile.minimizer_sections(minimizers, positions);
+
+        Shard_writer writer(prefix, nb_shards);
+        for (auto& file : writer.files) {
+            file->write_encoding(infile.encoding);
+            file->set_uniqueness(infile.uniqueness);
+            file->set_canonicity(infile.canonicity);
+            file->write_metadata(infile.metadata_size, metadata.data());
+        }
+
+        // The variables of all the sections, as found by the hashtable discovery
+        std::map<std::string, uint64_t> vars;
+        for (const auto& var : infile.global_vars) {
+            if (var.first != "first_index" and var.first != "footer_size")
+                vars[var.first] = var.second;
+        }
+        writer.write_vars(vars);
+
+        // Copy the sections in the order of the input, to read it only once
+        std::vector<size_t> order(positions.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&positions](size_t a, size_t b) { return positions[a] < positions[b]; });
+        for (size_t i : order) {
+            infile.jump_to(positions[i]);
+            Section_Minimizer sm(&infile);
+            sm.copy_bytes(&writer.shard(minimizers[i]));
+            sm.close();
+        }
+
+        return writer.close();
+    }
+
+
+    Shard_reader::Shard_reader(const std::string& manifest_path, const std::vector<uint64_t>& shards)
+        : manifest(Shard_manifest::load(manifest_path)) {
+        this->files.resize(this->manifest.files.size());
+        std::vector<uint64_t> selected = shards;
+        if (selected.empty()) {
+            for (uint64_t i = 0; i < this->files.size(); i++)
+                selected.push_back(i);
+        }
+
+        std::string dir = directory(manifest_path);
+        for (uint64_t shard : selected) {
+            if (shard >= this->files.size())
+                throw std::out_of_range("Shard reader: no shard " + std::to_string(shard) + " in " + manifest_path);
+            if (this->files[shard] == nullptr)
+                this->files[shard].reset(new Kero_file(dir + this->manifest.files[shard], "r"));
+        }
+    }
+
+    Shard_reader::~Shard_reader() {}
+
+    bool Shard_reader::owns(uint64_t minimizer) const {
+        return this->files[this->manifest.shard_of(minimizer)] != nullptr;
+    }
+
+    Kero_file* Shard_reader::shard_file(uint64_t shard) {
+        return shard < this->files.size() ? this->files[shard].get() : nullptr;
+    }
+
+    bool Shard_reader::find_kmer(uint64_t minimizer, uint64_t kmer, uint8_t* data) {
+        Kero_file* file = this->files[this->manifest.shard_of(minimizer)].get();
+        return file != nullptr and file->find_kmer(minimizer, kmer, data);
+    }
+
+} // namespace kero
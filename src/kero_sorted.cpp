@@ -0,0 +1,327 @@
+/**
+* @file kero_sorted.cpp
+ *
+ * @brief This file implements the loading of kero files as sorted k-mer arrays.
+ *
+ */
+
+#include "kero-api/kero_sorted.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/threads.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    namespace {
+
+        constexpr uint64_t RADIX_BITS = 8;
+        constexpr uint64_t RADIX_SIZE = 1ull << RADIX_BITS;
+        // Below this number of k-mers per thread, the sort threads are not worth their start
+        constexpr uint64_t MIN_KMERS_PER_THREAD = 1ull << 16;
+        // Maximal number of bits of the prefixes used to split the k-mers in the bounded mode
+        constexpr uint64_t MAX_PREFIX_BITS = 16;
+
+        // A sequence section and the variables that apply to it
+        struct Section_job {
+            uint64_t position;
+            std::unordered_map<std::string, uint64_t> vars;
+        };
+
+        // K-mers of one section
+        struct Section_kmers {
+            std::vector<uint64_t> kmers;
+            std::vector<uint8_t> data;
+        };
+
+        uint64_t resolve_threads(uint64_t nb_threads) {
+            if (nb_threads == 0)
+                nb_threads = std::max(1u, std::thread::hardware_concurrency());
+            return nb_threads;
+        }
+
+        inline void copy_data(uint8_t* dst, const uint8_t* src, uint64_t data_size) {
+            if (data_size == 1)
+                *dst = *src;
+            else
+                memcpy(dst, src, data_size);
+        }
+
+        /* Stable LSD radix sort of kmers[0..n) with their data, tmp buffers of the same sizes. */
+        void radix_sort_range(uint64_t* kmers, uint8_t* data, uint64_t n, uint64_t data_size, uint64_t nb_bits,
+                              uint64_t nb_threads, uint64_t* tmp_kmers, uint8_t* tmp_data) {
+            nb_threads = std::max<uint64_t>(1, std::min(nb_threads, n / MIN_KMERS_PER_THREAD));
+            uint64_t chunk = (n + nb_threads - 1) / nb_threads;
+            std::vector<uint64_t> counts(nb_threads * RADIX_SIZE);
+
+            uint64_t* src = kmers;
+            uint64_t* dst = tmp_kmers;
+            uint8_t* src_data = data;
+            uint8_t* dst_data = tmp_data;
+
+            for (uint64_t shift = 0; shift < nb_bits; shift += RADIX_BITS) {
+                // Digit counts of each chunk
+                std::fill(counts.begin(), counts.end(), 0);
+                run_threads(nb_threads, [&](uint64_t t) {
+                    uint64_t* count = counts.data() + t * RADIX_SIZE;
+                    uint64_t end = std::min(n, (t + 1) * chunk);
+                    for (uint64_t i = t * chunk; i < end; i++)
+                        count[(src[i] >> shift) & (RADIX_SIZE - 1)] += 1;
+                });
+
+                // Chunk t of digit d goes after all the smaller digits and the chunks before t
+                uint64_t offset = 0;
+                bool shared_digit = false;
+                for (uint64_t d = 0; d < RADIX_SIZE; d++) {
+                    uint64_t digit_start = offset;
+                    for (uint64_t t = 0; t < nb_threads; t++) {
+                        uint64_t count = counts[t * RADIX_SIZE + d];
+                        counts[t * RADIX_SIZE + d] = offset;
+                        offset += count;
+                    }
+                    if (offset - digit_start == n)
+                        shared_digit = true;
+                }
+                if (shared_digit)
+                    continue;
+
+                run_threads(nb_threads, [&](uint64_t t) {
+                    uint64_t* next = counts.data() + t * RADIX_SIZE;
+                    uint64_t end = std::min(n, (t + 1) * chunk);
+                    for (uint64_t i = t * chunk; i < end; i++) {
+                        uint64_t pos = next[(src[i] >> shift) & (RADIX_SIZE - 1)]++;
+                        dst[pos] = src[i];
+                        if (data_size > 0)
+                            copy_data(dst_data + pos * data_size, src_data + i * data_size, data_size);
+                    }
+                });
+                std::swap(src, dst);
+                std::swap(src_data, dst_data);
+            }
+
+            if (src != kmers) {
+                memcpy(kmers, src, n * sizeof(uint64_t));
+                memcpy(data, src_data, n * data_size);
+            }
+        }
+
+        /* List the sequence sections of the file with their variables. k and data_size must be constant. */
+        std::vector<Section_job> list_sections(const std::string& input, uint64_t& k, uint64_t& data_size) {
+            std::vector<Section_job> jobs;
+            std::unordered_map<std::string, uint64_t> vars;
+            k = 0;
+            data_size = 0;
+
+            Kero_file file(input, "r");
+            file.complete_header();
+            while (file.tellp() < file.end_position) {
+                char type = file.read_section_type();
+
+                if (type == 'v') {
+                    Section_GV sgv(&file);
+                    sgv.close();
+                    for (const auto& var : sgv.vars)
+                        vars[var.first] = var.second;
+                }
+                else if (type == 'M' or type == 'r') {
+                    if (vars.find("k") == vars.end() or vars.find("max") == vars.end()
+                        or vars.find("data_size") == vars.end())
+                        throw std::runtime_error("Sorted load: k, max or data_size missing before a sequence section.");
+                    if (vars["k"] > 32)
+                        throw std::runtime_error("Sorted load: k must be at most 32.");
+                    if (not jobs.empty() and (vars["k"] != k or vars["data_size"] != data_size))
+                        throw std::runtime_error("Sorted load: k and data_size must be the same in all the sections.");
+                    k = vars["k"];
+                    data_size = vars["data_size"];
+
+                    jobs.push_back({file.tellp(), vars});
+                    file.global_vars = vars;
+                    Block_section_reader* section = Block_section_reader::construct_section(&file);
+                    section->jump_section();
+                    delete section;
+                }
+                else if (type == 'i') {
+                    Section_Index si(&file);
+                    si.close();
+                }
+                else if (type == 'h') {
+                    Section_Hashtable sh(&file);
+                    sh.close();
+                }
+                else {
+                    throw std::runtime_error("Sorted load: unknown section type " + std::string(1, type));
+                }
+            }
+
+            return jobs;
+        }
+
+        /* Decode the sections in parallel, each thread with its own file.
+         * consume(t, kmers) is called by the thread t after each section.
+         */
+        template<typename Consumer>
+        void decode_sections(const std::string& input, const std::vector<Section_job>& jobs, uint64_t nb_threads,
+                             Consumer consume) {
+            std::atomic<uint64_t> next_job(0);
+            run_threads(std::min<uint64_t>(nb_threads, std::max<uint64_t>(1, jobs.size())), [&](uint64_t t) {
+                try {
+                    Kero_file file(input, "r");
+                    file.complete_header();
+                    Section_kmers buffer;
+                    uint64_t i;
+                    while ((i = next_job++) < jobs.size()) {
+                        file.global_vars = jobs[i].vars;
+                        file.jump_to(jobs[i].position);
+                        std::unique_ptr<Block_section_reader> section(Block_section_reader::construct_section(&file));
+                        buffer.kmers.clear();
+                        buffer.data.clear();
+                        section->extract_kmers(buffer.kmers, &buffer.data);
+                        section.reset();
+                        consume(t, i, buffer);
+                    }
+                } catch (...) {
+                    // The other threads stop after their current section
+                    next_job = jobs.size();
+                    throw;
+                }
+            });
+        }
+
+    } // namespace
+
+
+    void radix_sort_kmers(std::vector<uint64_t>& kmers, std::vector<uint8_t>& data, uint64_t data_size,
+                          uint64_t nb_bits, uint64_t nb_threads) {
+        if (data.size() < kmers.size() * data_size)
+            throw std::invalid_argument("radix_sort_kmers: the data array is smaller than kmers.size() * data_size.");
+        std::vector<uint64_t> tmp_kmers(kmers.size());
+        std::vector<uint8_t> tmp_data(kmers.size() * data_size);
+        radix_sort_range(kmers.data(), data.data(), kmers.size(), data_size, nb_bits, resolve_threads(nb_threads),
+                         tmp_kmers.data(), tmp_data.data());
+    }
+
+
+    Sorted_kmers load_sorted_kmers(const std::string& input, const Sorted_options& options) {
+        Sorted_kmers result;
+        uint64_t nb_threads = resolve_threads(options.nb_threads);
+
+        std::vector<Section_job> jobs = list_sections(input, result.k, result.data_size);
+        if (jobs.empty())
+            return result;
+        uint64_t k = result.k;
+        uint64_t data_size = result.data_size;
+
+        // --- Unbounded: one decoding pass, the sections are concatenated in file order ---
+        if (options.memory_limit == 0) {
+            std::vector<Section_kmers> sections(jobs.size());
+            decode_sections(input, jobs, nb_threads, [&](uint64_t, uint64_t i, Section_kmers& buffer) {
+                std::swap(sections[i], buffer);
+            });
+            result.nb_passes = 1;
+
+            uint64_t nb_kmers = 0;
+            for (const Section_kmers& section : sections)
+                nb_kmers += section.kmers.size();
+            result.kmers.reserve(nb_kmers);
+            result.data.reserve(nb_kmers * data_size);
+            for (Section_kmers& section : sections) {
+                result.kmers.insert(result.kmers.end(), section.kmers.begin(), section.kmers.end());
+                result.data.insert(result.data.end(), section.data.begin(), section.data.end());
+                std::vector<uint64_t>().swap(section.kmers);
+                std::vector<uint8_t>().swap(section.data);
+            }
+
+            radix_sort_kmers(result.kmers, result.data, data_size, 2 * k, nb_threads);
+            return result;
+        }
+
+        // --- Bounded: count the k-mers per prefix, then one decoding pass per range of prefixes ---
+        uint64_t prefix_bits = std::min(MAX_PREFIX_BITS, 2 * k);
+        uint64_t prefix_shift = 2 * k - prefix_bits;
+        uint64_t nb_prefixes = 1ull << prefix_bits;
+
+        std::vector<std::vector<uint64_t>> thread_counts(nb_threads, std::vector<uint64_t>(nb_prefixes, 0));
+        decode_sections(input, jobs, nb_threads, [&](uint64_t t, uint64_t, Section_kmers& buffer) {
+            std::vector<uint64_t>& count = thread_counts[t];
+            for (uint64_t kmer : buffer.kmers)
+                count[kmer >> prefix_shift] += 1;
+        });
+        result.nb_passes = 1;
+
+        std::vector<uint64_t> prefix_counts(nb_prefixes, 0);
+        for (const auto& count : thread_counts)
+            for (uint64_t p = 0; p < nb_prefixes; p++)
+                prefix_counts[p] += count[p];
+        std::vector<std::vector<uint64_t>>().swap(thread_counts);
+
+        // Consecutive prefixes are grouped while their k-mers fit in the memory limit.
+        // A prefix bigger than the limit gets its own range.
+        uint64_t max_range_kmers = std::max<uint64_t>(1, options.memory_limit / (sizeof(uint64_t) + data_size));
+        std::vector<uint64_t> range_starts(1, 0);  // first prefix of each range
+        uint64_t range_kmers = 0, largest_range = 0, nb_kmers = 0;
+        for (uint64_t p = 0; p < nb_prefixes; p++) {
+            if (range_kmers > 0 and range_kmers + prefix_counts[p] > max_range_kmers) {
+                range_starts.push_back(p);
+                range_kmers = 0;
+            }
+            range_kmers += prefix_counts[p];
+            largest_range = std::max(largest_range, range_kmers);
+            nb_kmers += prefix_counts[p];
+        }
+        range_starts.push_back(nb_prefixes);
+
+        result.kmers.resize(nb_kmers);
+        result.data.resize(nb_kmers * data_size);
+        std::vector<uint64_t> tmp_kmers(largest_range);
+        std::vector<uint8_t> tmp_data(largest_range * data_size);
+
+        uint64_t range_offset = 0;
+        for (uint64_t r = 0; r + 1 < range_starts.size(); r++) {
+            uint64_t first = range_starts[r], last = range_starts[r + 1];
+            uint64_t nb_range_kmers = 0;
+            for (uint64_t p = first; p < last; p++)
+                nb_range_kmers += prefix_counts[p];
+            if (nb_range_kmers == 0)
+                continue;
+
+            // The k-mers of the range are written directly at their final place, in any order
+            uint64_t* range_kmers_ptr = result.kmers.data() + range_offset;
+            uint8_t* range_data_ptr = result.data.data() + range_offset * data_size;
+            std::atomic<uint64_t> cursor(0);
+            decode_sections(input, jobs, nb_threads, [&](uint64_t, uint64_t, Section_kmers& buffer) {
+                uint64_t nb_kept = 0;
+                for (uint64_t i = 0; i < buffer.kmers.size(); i++) {
+                    uint64_t prefix = buffer.kmers[i] >> prefix_shift;
+                    if (prefix < first or prefix >= last)
+                        continue;
+                    buffer.kmers[nb_kept] = buffer.kmers[i];
+                    if (data_size > 0)
+                        memmove(buffer.data.data() + nb_kept * data_size, buffer.data.data() + i * data_size, data_size);
+                    nb_kept += 1;
+                }
+                uint64_t pos = cursor.fetch_add(nb_kept);
+                memcpy(range_kmers_ptr + pos, buffer.kmers.data(), nb_kept * sizeof(uint64_t));
+                memcpy(range_data_ptr + pos * data_size, buffer.data.data(), nb_kept * data_size);
+            });
+            result.nb_passes += 1;
+
+            radix_sort_range(range_kmers_ptr, range_data_ptr, nb_range_kmers, data_size, 2 * k, nb_threads,
+                             tmp_kmers.data(), tmp_data.data());
+            range_offset += nb_range_kmers;
+        }
+
+        return result;
+    }
+
+} // namespace kero
@@ -0,0 +1,792 @@
+/**
+* @file kero_store.cpp
+ *
+ * @brief This file implements the log-structured k-mer store.
+ *
+ */
+
+#include "kero-api/kero_store.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/chain.hpp"
+#include "kero-api/detail/threads.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    namespace {
+
+        constexpr const char* MANIFEST_NAME = "MANIFEST";
+        constexpr const char* MANIFEST_SIGNATURE = "kero-store";
+        constexpr uint64_t MANIFEST_VERSION = 1;
+
+        // The k-mers of one minimizer, then the super k-mers built from them.
+        struct Partition {
+            uint64_t minimizer = 0;
+            std::vector<uint64_t> kmers;
+            std::vector<uint8_t> data;
+            // Merges only: rank of the input file of each k-mer, 0 for the most recent
+            std::vector<uint64_t> ages;
+
+            // Output blocks, the sequences without the minimizer
+            Chain_blocks blocks;
+        };
+
+        /* Add two big endian counters of data_size bytes, saturated at their maximal value. */
+        void add_counters(uint8_t* into, const uint8_t* other, uint64_t data_size) {
+            if (data_size == 0)
+                return;
+            uint64_t a, b;
+            load_big_endian(into, data_size, a);
+            load_big_endian(other, data_size, b);
+            uint64_t limit = data_size >= 8 ? UINT64_MAX : (1ull << (8 * data_size)) - 1;
+            store_big_endian(into, data_size, a > limit - b ? limit : a + b);
+        }
+
+        /* First position of the minimizer in the k-mer, or NO_LINK if absent. */
+        uint64_t minimizer_offset(uint64_t kmer, uint64_t minimizer, uint64_t k, uint64_t m) {
+            uint64_t mini_mask = get_mini_mask(m);
+            for (uint64_t offset = 0; offset <= k - m; offset++) {
+                if (((kmer >> (2 * (k - m - offset))) & mini_mask) == minimizer)
+                    return offset;
+            }
+            return NO_LINK;
+        }
+
+        /* Sort the k-mers of a merged partition and combine the duplicates, the most recent first. */
+        void combine_partition(Partition& part, uint64_t data_size, Store_merge merge) {
+            std::vector<uint64_t> order(part.kmers.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+                return part.kmers[a] < part.kmers[b] or (part.kmers[a] == part.kmers[b] and part.ages[a] < part.ages[b]);
+            });
+
+            std::vector<uint64_t> kmers;
+            std::vector<uint8_t> data;
+            kmers.reserve(order.size());
+            data.reserve(order.size() * data_size);
+            for (uint64_t i = 0; i < order.size(); i++) {
+                const uint8_t* kmer_data = part.data.data() + order[i] * data_size;
+                if (not kmers.empty() and kmers.back() == part.kmers[order[i]]) {
+                    if (merge == Store_merge::sum)
+                        add_counters(data.data() + data.size() - data_size, kmer_data, data_size);
+                    continue;
+                }
+                kmers.push_back(part.kmers[order[i]]);
+                data.insert(data.end(), kmer_data, kmer_data + data_size);
+            }
+
+            part.kmers.swap(kmers);
+            part.data.swap(data);
+            std::vector<uint64_t>().swap(part.ages);
+        }
+
+        /* Chain the sorted and unique k-mers of a partition into super k-mers.
+         * x -> y are chained when y follows x (overlap of k-1 nucleotides) with its minimizer one
+         * nucleotide closer to the start, so that the minimizer of the super k-mer is shared.
+         */
+        void encode_partition(Partition& part, uint64_t k, uint64_t m, uint64_t data_size, uint64_t limit) {
+            uint64_t nb_kmers = part.kmers.size();
+            uint64_t mask = get_mini_mask(k);
+
+            std::vector<uint64_t> offset(nb_kmers);
+            for (uint64_t i = 0; i < nb_kmers; i++) {
+                offset[i] = minimizer_offset(part.kmers[i], part.minimizer, k, m);
+                if (offset[i] == NO_LINK)
+                    throw std::runtime_error("Kero_store: a k-mer does not contain its minimizer");
+            }
+
+            auto find = [&](uint64_t kmer) {
+                auto it = std::lower_bound(part.kmers.begin(), part.kmers.end(), kmer);
+                return it != part.kmers.end() and *it == kmer ? static_cast<uint64_t>(it - part.kmers.begin()) : NO_LINK;
+            };
+
+            std::vector<bool> has_prev(nb_kmers, false);
+            for (uint64_t i = 0; i < nb_kmers; i++) {
+                if (offset[i] == 0)
+                    continue;
+                for (uint64_t nucl = 0; nucl < 4; nucl++) {
+                    uint64_t succ = find(((part.kmers[i] << 2) | nucl) & mask);
+                    if (succ != NO_LINK and offset[succ] + 1 == offset[i])
+                        has_prev[succ] = true;
+                }
+            }
+
+            // Walk from the k-mers without predecessor, then from the remaining ones (predecessor taken).
+            // The minimizer of a block is at the offset of its first k-mer.
+            auto next = [&](uint64_t current, const std::vector<bool>& visited) {
+                if (offset[current] == 0)
+                    return NO_LINK;
+                for (uint64_t nucl = 0; nucl < 4; nucl++) {
+                    uint64_t succ = find(((part.kmers[current] << 2) | nucl) & mask);
+                    if (succ != NO_LINK and not visited[succ] and offset[succ] + 1 == offset[current])
+                        return succ;
+                }
+                return NO_LINK;
+            };
+            walk_chains(nb_kmers, has_prev, limit, next, [&](const uint64_t* path, uint64_t size) {
+                part.blocks.append(part.kmers, part.data, path, size, k, data_size, m, offset[path[0]]);
+            });
+
+            std::vector<uint64_t>().swap(part.kmers);
+            std::vector<uint8_t>().swap(part.data);
+        }
+
+        void write_store_header(Kero_file& file, uint64_t k, uint64_t m, uint64_t max, uint64_t data_size) {
+            file.write_encoding(0, 1, 3, 2);
+            file.set_uniqueness(true);
+            file.set_canonicity(false);
+
+            Section_GV sgv(&file);
+            sgv.write_var("k", k);
+            sgv.write_var("m", m);
+            sgv.write_var("max", max);
+            sgv.write_var("data_size", data_size);
+            sgv.write_var("layout", file.layout);
+            sgv.close();
+        }
+
+        /* Write the encoded partition as a minimizer section. */
+        void write_partition(Kero_file& file, Partition& part, uint64_t k, uint64_t m, uint64_t data_size) {
+            if (part.blocks.empty())
+                return;
+
+            uint8_t mini_bytes[8];
+            uint64_t nb_bytes_mini = bytes_from_bit_array(2, m);
+            store_big_endian(mini_bytes, nb_bytes_mini, part.minimizer);
+
+            Section_Minimizer sm(&file);
+            sm.write_minimizer(mini_bytes);
+            uint8_t* seq = part.blocks.seqs.data();
+            uint8_t* data = part.blocks.data.data();
+            for (uint64_t b = 0; b < part.blocks.nb_kmers.size(); b++) {
+                uint64_t nb_nucl = part.blocks.nb_kmers[b] + k - 1 - m;
+                sm.write_compacted_sequence_without_mini(seq, nb_nucl, part.blocks.mini_pos[b], data);
+                seq += bytes_from_bit_array(2, nb_nucl);
+                data += part.blocks.nb_kmers[b] * data_size;
+            }
+            sm.close();
+        }
+
+        /* Open a file for reading with the header over and the variables loaded, so that the minimizer
+         * sections can be read at their positions directly.
+         */
+        std::unique_ptr<Kero_file> open_section_reader(const std::string& path) {
+            std::unique_ptr<Kero_file> file(new Kero_file(path, "r"));
+            file->complete_header();
+            file->global_vars_discovery();
+            return file;
+        }
+
+        uint64_t file_bytes(const std::string& path) {
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0)
+                throw std::runtime_error("Kero_store: cannot stat " + path);
+            return static_cast<uint64_t>(st.st_size);
+        }
+
+        /* Parse the name of a store file, L<level>-<id>.kero */
+        bool parse_file_name(const std::string& name, uint64_t& level, uint64_t& id) {
+            unsigned long long l, i;
+            int consumed = 0;
+            if (sscanf(name.c_str(), "L%llu-%llu.kero%n", &l, &i, &consumed) != 2 or
+                consumed != static_cast<int>(name.size()))
+                return false;
+            level = l;
+            id = i;
+            return true;
+        }
+
+    } // namespace
+
+
+    // ----- Files of the store -----
+
+    struct Kero_store::Store_file {
+        uint64_t level;
+        uint64_t id;
+        std::string path;
+        uint64_t bytes;
+        // Position of the section of each minimizer. Also the filter of the lookups.
+        std::unordered_map<uint64_t, uint64_t> sections;
+
+        // Handle of the lookups
+        std::mutex lookup_mutex;
+        std::unique_ptr<Kero_file> file;
+
+        // Set when a merge replaced the file: it is removed once the last lookup releases it
+        bool obsolete = false;
+
+        ~Store_file() {
+            this->file.reset();
+            if (this->obsolete)
+                remove(this->path.c_str());
+        }
+
+        bool find_kmer(uint64_t minimizer, uint64_t kmer, uint8_t* data) {
+            auto it = this->sections.find(minimizer);
+            if (it == this->sections.end())
+                return false;
+            std::lock_guard<std::mutex> lock(this->lookup_mutex);
+            this->file->jump_to(it->second);
+            Section_Minimizer sm(this->file.get());
+            return sm.find_kmer(kmer, data);
+        }
+    };
+
+    std::string Kero_store::file_path(uint64_t level, uint64_t id) const {
+        return this->directory + "/L" + std::to_string(level) + "-" + std::to_string(id) + ".kero";
+    }
+
+    std::shared_ptr<Kero_store::Store_file> Kero_store::open_file(uint64_t level, uint64_t id) {
+        std::shared_ptr<Store_file> store_file = std::make_shared<Store_file>();
+        store_file->level = level;
+        store_file->id = id;
+        store_file->path = this->file_path(level, id);
+        store_file->bytes = file_bytes(store_file->path);
+        store_file->file = open_section_reader(store_file->path);
+
+        std::vector<uint64_t> minimizers, positions;
+        if (not store_file->file->minimizer_sections(minimizers, positions) and not minimizers.empty())
+            throw std::runtime_error("Kero_store: " + store_file->path + " has no hashtable");
+        store_file->sections.reserve(minimizers.size());
+        for (uint64_t i = 0; i < minimizers.size(); i++)
+            store_file->sections[minimizers[i]] = positions[i];
+        return store_file;
+    }
+
+
+    // ----- Manifest -----
+
+    void Kero_store::load_manifest() {
+        std::string manifest = this->directory + "/" + MANIFEST_NAME;
+        std::ifstream in(manifest);
+        std::unordered_set<std::string> listed;
+
+        if (in.is_open()) {
+            std::string signature;
+            uint64_t version = 0;
+            in >> signature >> version;
+            if (signature != MANIFEST_SIGNATURE or version != MANIFEST_VERSION)
+                throw std::runtime_error("Kero_store: unknown manifest format in " + manifest);
+
+            std::string key;
+            while (in >> key) {
+                if (key == "file") {
+                    uint64_t level, id;
+                    in >> level >> id;
+                    if (this->levels.size() <= level)
+                        this->levels.resize(level + 1);
+                    this->levels[level].push_back(this->open_file(level, id));
+                    listed.insert("L" + std::to_string(level) + "-" + std::to_string(id) + ".kero");
+                } else if (key == "merge") {
+                    std::string merge;
+                    in >> merge;
+                    this->options.merge = merge == "replace" ? Store_merge::replace : Store_merge::sum;
+                } else {
+                    uint64_t value;
+                    in >> value;
+                    if (key == "k")
+                        this->options.k = value;
+                    else if (key == "m")
+                        this->options.m = value;
+                    else if (key == "data_size")
+                        this->options.data_size = value;
+                    else if (key == "next_file")
+                        this->next_file_id = value;
+                }
+                if (in.fail())
+                    throw std::runtime_error("Kero_store: corrupted manifest " + manifest);
+            }
+        }
+
+        // Remove the outputs of the flushes and merges that did not reach the manifest
+        DIR* dir = opendir(this->directory.c_str());
+        if (dir == nullptr)
+            throw std::runtime_error("Kero_store: cannot list " + this->directory);
+        std::vector<std::string> orphans;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            std::string name = entry->d_name;
+            uint64_t level, id;
+            if (parse_file_name(name, level, id) and listed.find(name) == listed.end())
+                orphans.push_back(this->directory + "/" + name);
+        }
+        closedir(dir);
+        for (const std::string& orphan : orphans)
+            remove(orphan.c_str());
+    }
+
+    void Kero_store::write_manifest() {
+        std::string manifest = this->directory + "/" + MANIFEST_NAME;
+        std::string tmp = manifest + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            out << MANIFEST_SIGNATURE << " " << MANIFEST_VERSION << "\n";
+            out << "k " << this->options.k << "\n";
+            out << "m " << this->options.m << "\n";
+            out << "data_size " << this->options.data_size << "\n";
+            out << "merge " << (this->options.merge == Store_merge::replace ? "replace" : "sum") << "\n";
+            out << "next_file " << this->next_file_id << "\n";
+            for (const auto& level : this->levels) {
+                for (const auto& store_file : level)
+                    out << "file " << store_file->level << " " << store_file->id << "\n";
+            }
+            out.flush();
+            if (out.fail())
+                throw std::runtime_error("Kero_store: cannot write " + tmp);
+        }
+        // The manifest is replaced atomically
+        if (rename(tmp.c_str(), manifest.c_str()) != 0)
+            throw std::runtime_error("Kero_store: cannot replace " + manifest + ": " + strerror(errno));
+    }
+
+
+    // ----- Store -----
+
+    Kero_store::Kero_store(const std::string& directory, const Store_options& options)
+        : directory(directory), options(options), memtable_size(0), next_file_id(0), merging(false),
+          stopping(false) {
+        if (mkdir(directory.c_str(), 0755) != 0 and errno != EEXIST)
+            throw std::runtime_error("Kero_store: cannot create " + directory + ": " + strerror(errno));
+
+        this->load_manifest();
+
+        const Store_options& opt = this->options;
+        if (opt.k > 32 or opt.m == 0 or opt.m > opt.k)
+            throw std::runtime_error("Kero_store: needs 0 < m <= k <= 32");
+        if (opt.merge == Store_merge::sum and opt.data_size > 8)
+            throw std::runtime_error("Kero_store: the counters to sum must fit in 8 bytes");
+        this->max = opt.k - opt.m + 1;
+        if (this->levels.empty())
+            this->levels.resize(1);
+        this->write_manifest();
+
+        if (opt.background)
+            this->merger = std::thread(&Kero_store::run_merger, this);
+    }
+
+    Kero_store::~Kero_store() {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            try {
+                this->flush_locked(lock);
+            } catch (...) {
+                // Nothing can be reported from a destructor: the memory table is lost
+            }
+            this->stopping = true;
+        }
+        this->merge_needed.notify_all();
+        if (this->merger.joinable())
+            this->merger.join();
+    }
+
+    void Kero_store::combine(uint8_t* into, const uint8_t* newer) const {
+        if (this->options.merge == Store_merge::sum)
+            add_counters(into, newer, this->options.data_size);
+        else
+            memcpy(into, newer, this->options.data_size);
+    }
+
+    void Kero_store::insert(uint64_t minimizer, uint64_t kmer, const uint8_t* data) {
+        const uint64_t k = this->options.k, m = this->options.m, data_size = this->options.data_size;
+        minimizer = mask_mini(minimizer, m);
+        kmer = mask_mini(kmer, k);
+        if (minimizer_offset(kmer, minimizer, k, m) == NO_LINK)
+            throw std::runtime_error("Kero_store: the minimizer is absent from the k-mer");
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        Memtable_partition& part = this->memtable[minimizer];
+        auto it = part.index.find(kmer);
+        if (it != part.index.end()) {
+            this->combine(part.data.data() + it->second * data_size, data);
+            return;
+        }
+        part.index.emplace(kmer, part.index.size());
+        part.data.insert(part.data.end(), data, data + data_size);
+        this->memtable_size += 1;
+
+        if (this->memtable_size >= this->options.memtable_kmers)
+            this->flush_locked(lock);
+    }
+
+    void Kero_store::flush() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->flush_locked(lock);
+        lock.unlock();
+        this->rethrow_merge_error();
+    }
+
+    /* Write the memory table as a level 0 file. The insertions and lookups wait for the write. */
+    void Kero_store::flush_locked(std::unique_lock<std::mutex>& lock) {
+        if (this->memtable_size == 0)
+            return;
+
+        const uint64_t k = this->options.k, m = this->options.m, data_size = this->options.data_size;
+        uint64_t id = this->next_file_id++;
+        std::string path = this->file_path(0, id);
+
+        std::vector<uint64_t> minimizers;
+        minimizers.reserve(this->memtable.size());
+        for (const auto& it : this->memtable)
+            minimizers.push_back(it.first);
+        std::sort(minimizers.begin(), minimizers.end());
+
+        {
+            Kero_file outfile(path, "w");
+            write_store_header(outfile, k, m, this->max, data_size);
+            std::vector<std::pair<uint64_t, uint64_t>> sorted;
+            for (uint64_t minimizer : minimizers) {
+                Memtable_partition& memtable_part = this->memtable[minimizer];
+                sorted.assign(memtable_part.index.begin(), memtable_part.index.end());
+                std::sort(sorted.begin(), sorted.end());
+
+                Partition part;
+                part.minimizer = minimizer;
+                part.kmers.reserve(sorted.size());
+                part.data.reserve(sorted.size() * data_size);
+                for (const auto& kmer_rank : sorted) {
+                    const uint8_t* kmer_data = memtable_part.data.data() + kmer_rank.second * data_size;
+                    part.kmers.push_back(kmer_rank.first);
+                    part.data.insert(part.data.end(), kmer_data, kmer_data + data_size);
+                }
+                encode_partition(part, k, m, data_size, this->max);
+                write_partition(outfile, part, k, m, data_size);
+            }
+            outfile.close();
+        }
+
+        std::shared_ptr<Store_file> store_file = this->open_file(0, id);
+        this->levels[0].insert(this->levels[0].begin(), store_file);
+        this->write_manifest();
+        this->memtable.clear();
+        this->memtable_size = 0;
+        this->counters.nb_flushes += 1;
+        this->counters.bytes_flushed += store_file->bytes;
+
+        if (this->options.background) {
+            this->merge_needed.notify_one();
+        } else if (not this->merging) {
+            // The merges run in the caller, the first caller merges for the others
+            this->merging = true;
+            try {
+                this->merge_pending(lock);
+            } catch (...) {
+                this->merging = false;
+                throw;
+            }
+            this->merging = false;
+            this->merge_done.notify_all();
+        }
+    }
+
+    bool Kero_store::find_kmer(uint64_t minimizer, uint64_t kmer, uint8_t* data) {
+        const uint64_t data_size = this->options.data_size;
+        minimizer = mask_mini(minimizer, this->options.m);
+        kmer = mask_mini(kmer, this->options.k);
+
+        std::vector<uint8_t> found_data(data_size + 1);
+        std::vector<uint8_t> file_data(data_size + 1);
+        bool found = false;
+
+        // Files that may contain the k-mer, the most recent first
+        std::vector<std::shared_ptr<Store_file>> candidates;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            auto part = this->memtable.find(minimizer);
+            if (part != this->memtable.end()) {
+                auto it = part->second.index.find(kmer);
+                if (it != part->second.index.end()) {
+                    found = true;
+                    memcpy(found_data.data(), part->second.data.data() + it->second * data_size, data_size);
+                }
+            }
+            if (not found or this->options.merge == Store_merge::sum) {
+                for (const auto& level : this->levels) {
+                    for (const auto& store_file : level) {
+                        if (store_file->sections.find(minimizer) != store_file->sections.end())
+                            candidates.push_back(store_file);
+                        else
+                            this->counters.files_skipped += 1;
+                    }
+                }
+            }
+        }
+
+        uint64_t files_read = 0;
+        for (const auto& store_file : candidates) {
+            files_read += 1;
+            if (not store_file->find_kmer(minimizer, kmer, file_data.data()))
+                continue;
+            if (not found) {
+                found = true;
+                memcpy(found_data.data(), file_data.data(), data_size);
+            } else {
+                // The data found so far is the most recent
+                add_counters(found_data.data(), file_data.data(), data_size);
+            }
+            if (this->options.merge == Store_merge::replace)
+                break;
+        }
+
+        if (files_read > 0) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->counters.files_read += files_read;
+        }
+        if (found and data != nullptr)
+            memcpy(data, found_data.data(), data_size);
+        return found;
+    }
+
+
+    // ----- Merges -----
+
+    int64_t Kero_store::level_to_merge() const {
+        if (this->levels[0].size() >= std::max<uint64_t>(1, this->options.level0_files))
+            return 0;
+        uint64_t limit = this->options.level1_bytes;
+        for (uint64_t level = 1; level + 1 <= this->levels.size(); level++) {
+            for (const auto& store_file : this->levels[level]) {
+                if (store_file->bytes > limit)
+                    return static_cast<int64_t>(level);
+            }
+            uint64_t ratio = std::max<uint64_t>(1, this->options.level_ratio);
+            limit = limit > UINT64_MAX / ratio ? UINT64_MAX : limit * ratio;
+        }
+        return -1;
+    }
+
+    void Kero_store::merge_pending(std::unique_lock<std::mutex>& lock) {
+        int64_t level;
+        while (not this->stopping and (level = this->level_to_merge()) >= 0)
+            this->merge_level(lock, static_cast<uint64_t>(level));
+    }
+
+    /* Merge the files of a level with the file of the next level. Called with merging set: the lock
+     * is released during the merge, the inputs are immutable.
+     */
+    void Kero_store::merge_level(std::unique_lock<std::mutex>& lock, uint64_t level) {
+        const uint64_t k = this->options.k, m = this->options.m, data_size = this->options.data_size;
+        const Store_merge merge = this->options.merge;
+        const uint64_t max = this->max;
+
+        if (this->levels.size() <= level + 1)
+            this->levels.resize(level + 2);
+        // Most recent first: the files of the level, then the older file of the next level
+        std::vector<std::shared_ptr<Store_file>> inputs = this->levels[level];
+        inputs.insert(inputs.end(), this->levels[level + 1].begin(), this->levels[level + 1].end());
+        if (inputs.empty())
+            return;
+        uint64_t id = this->next_file_id++;
+        std::string path = this->file_path(level + 1, id);
+
+        uint64_t nb_threads = this->options.nb_threads;
+        if (nb_threads == 0)
+            nb_threads = std::max(1u, std::thread::hardware_concurrency());
+        uint64_t batch_size = std::max<uint64_t>(1, this->options.batch_size);
+
+        std::shared_ptr<Store_file> output = std::make_shared<Store_file>();
+        lock.unlock();
+        try {
+            // Every minimizer of the inputs is a partition
+            std::vector<uint64_t> minimizers;
+            for (const auto& input : inputs) {
+                for (const auto& section : input->sections)
+                    minimizers.push_back(section.first);
+            }
+            std::sort(minimizers.begin(), minimizers.end());
+            minimizers.erase(std::unique(minimizers.begin(), minimizers.end()), minimizers.end());
+            nb_threads = std::max<uint64_t>(1, std::min<uint64_t>(nb_threads, minimizers.size()));
+
+            // Each worker reads the inputs through its own files
+            std::vector<std::vector<std::unique_ptr<Kero_file>>> readers(nb_threads);
+            for (auto& worker_readers : readers) {
+                for (const auto& input : inputs)
+                    worker_readers.push_back(open_section_reader(input->path));
+            }
+
+            Kero_file outfile(path, "w");
+            write_store_header(outfile, k, m, max, data_size);
+
+            std::vector<Partition> batch;
+            for (uint64_t start = 0; start < minimizers.size(); start += batch_size) {
+                uint64_t end = std::min<uint64_t>(start + batch_size, minimizers.size());
+                batch.assign(end - start, Partition());
+
+                std::atomic<uint64_t> next_part(0);
+                auto worker = [&](uint64_t t) {
+                    uint64_t i;
+                    while ((i = next_part++) < batch.size()) {
+                        Partition& part = batch[i];
+                        part.minimizer = minimizers[start + i];
+                        for (uint64_t age = 0; age < inputs.size(); age++) {
+                            auto section = inputs[age]->sections.find(part.minimizer);
+                            if (section == inputs[age]->sections.end())
+                                continue;
+                            Kero_file& reader = *readers[t][age];
+                            reader.jump_to(section->second);
+                            Section_Minimizer sm(&reader);
+                            uint64_t nb_kmers = sm.extract_kmers(part.kmers, &part.data);
+                            part.ages.insert(part.ages.end(), nb_kmers, age);
+                        }
+                        combine_partition(part, data_size, merge);
+                        encode_partition(part, k, m, data_size, max);
+                    }
+                };
+                run_threads(std::min<uint64_t>(nb_threads, batch.size()), worker);
+
+                for (Partition& part : batch)
+                    write_partition(outfile, part, k, m, data_size);
+            }
+            // The positions of the sections are known from the writer, the headers are not read again
+            std::vector<uint64_t> out_minimizers = outfile.mini_list;
+            std::vector<uint64_t> out_positions = outfile.mini_pos;
+            outfile.close();
+
+            output->level = level + 1;
+            output->id = id;
+            output->path = path;
+            output->bytes = file_bytes(path);
+            output->file = open_section_reader(path);
+            output->sections.reserve(out_minimizers.size());
+            for (uint64_t i = 0; i < out_minimizers.size(); i++)
+                output->sections[out_minimizers[i]] = out_positions[i];
+        } catch (...) {
+            remove(path.c_str());
+            lock.lock();
+            throw;
+        }
+
+        lock.lock();
+        // Level 0 may have received new files during the merge
+        for (const auto& input : inputs) {
+            auto& files = this->levels[input->level];
+            files.erase(std::remove(files.begin(), files.end(), input), files.end());
+        }
+        this->levels[level + 1].push_back(output);
+        this->write_manifest();
+        for (const auto& input : inputs)
+            input->obsolete = true;
+        this->counters.nb_merges += 1;
+        this->counters.bytes_merged += output->bytes;
+    }
+
+    void Kero_store::run_merger() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (true) {
+            this->merge_needed.wait(lock, [this] {
+                return this->stopping or
+                       (not this->merging and this->merge_error == nullptr and this->level_to_merge() >= 0);
+            });
+            if (this->stopping)
+                break;
+            this->merging = true;
+            try {
+                this->merge_pending(lock);
+            } catch (...) {
+                this->merge_error = std::current_exception();
+            }
+            this->merging = false;
+            this->merge_done.notify_all();
+        }
+    }
+
+    void Kero_store::rethrow_merge_error() {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->merge_error != nullptr) {
+            std::exception_ptr error = this->merge_error;
+            this->merge_error = nullptr;
+            // The merges can be tried again
+            this->merge_needed.notify_one();
+            std::rethrow_exception(error);
+        }
+    }
+
+    void Kero_store::wait_merges() {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (not this->options.background and not this->merging) {
+                this->merging = true;
+                try {
+                    this->merge_pending(lock);
+                } catch (...) {
+                    this->merging = false;
+                    throw;
+                }
+                this->merging = false;
+            }
+            this->merge_done.wait(lock, [this] {
+                return not this->merging and (this->merge_error != nullptr or this->level_to_merge() < 0);
+            });
+        }
+        this->rethrow_merge_error();
+    }
+
+    void Kero_store::compact() {
+        this->flush();
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->merge_done.wait(lock, [this] { return not this->merging; });
+        this->merging = true;
+        try {
+            // Merge every level into the next one, down to the deepest level that has a file
+            uint64_t deepest = 0;
+            for (uint64_t level = 0; level < this->levels.size(); level++) {
+                if (not this->levels[level].empty())
+                    deepest = level;
+            }
+            if (deepest == 0 and this->levels[0].size() > 1)
+                deepest = 1;
+            for (uint64_t level = 0; level < deepest; level++) {
+                if (not this->levels[level].empty())
+                    this->merge_level(lock, level);
+            }
+        } catch (...) {
+            this->merging = false;
+            this->merge_done.notify_all();
+            throw;
+        }
+        this->merging = false;
+        this->merge_done.notify_all();
+        // The background thread may have waited for the end of the compaction
+        this->merge_needed.notify_one();
+    }
+
+    std::vector<std::string> Kero_store::files() const {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        std::vector<std::string> paths;
+        for (const auto& level : this->levels) {
+            for (const auto& store_file : level)
+                paths.push_back(store_file->path);
+        }
+        return paths;
+    }
+
+    Store_stats Kero_store::stats() const {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        Store_stats result = this->counters;
+        result.memtable_kmers = this->memtable_size;
+        for (const auto& level : this->levels) {
+            uint64_t bytes = 0;
+            for (const auto& store_file : level)
+                bytes += store_file->bytes;
+            result.level_files.push_back(level.size());
+            result.level_bytes.push_back(bytes);
+        }
+        return result;
+    }
+
+} // namespace kero
@@ -0,0 +1,95 @@
+/**
+* @file kero_threads.cpp
+ *
+ * @brief This file implements the persistent pool of worker threads.
+ *
+ */
+
+#include "kero-api/detail/threads.hpp"
+
+#include <algorithm>
+
+namespace kero {
+
+    Thread_pool::Thread_pool(uint64_t nb_threads)
+        : job(nullptr), generation(0), nb_workers(0), nb_running(0), stopping(false) {
+        try {
+            for (uint64_t t = 1; t < nb_threads; t++)
+                this->threads.emplace_back(&Thread_pool::loop, this, t);
+        } catch (...) {
+            this->stop();
+            throw;
+        }
+    }
+
+    Thread_pool::~Thread_pool() {
+        this->stop();
+    }
+
+    void Thread_pool::stop() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->start.notify_all();
+        for (std::thread& thread : this->threads)
+            thread.join();
+        this->threads.clear();
+    }
+
+    void Thread_pool::loop(uint64_t t) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (true) {
+            this->start.wait(lock, [&]() { return this->stopping or this->generation != seen; });
+            if (this->stopping)
+                return;
+            seen = this->generation;
+            if (t >= this->nb_workers)
+                continue;
+
+            const std::function<void(uint64_t)>* worker = this->job;
+            lock.unlock();
+            try {
+                (*worker)(t);
+            } catch (...) {
+                this->errors[t] = std::current_exception();
+            }
+            lock.lock();
+            if (--this->nb_running == 0)
+                this->done.notify_all();
+        }
+    }
+
+    void Thread_pool::run(uint64_t nb_threads, const std::function<void(uint64_t)>& worker) {
+        std::lock_guard<std::mutex> run_lock(this->run_mutex);
+        uint64_t nb_workers = std::max<uint64_t>(1, std::min<uint64_t>(nb_threads, this->size()));
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->job = &worker;
+            this->nb_workers = nb_workers;
+            this->nb_running = nb_workers - 1;
+            this->errors.assign(nb_workers, nullptr);
+            this->generation += 1;
+        }
+        this->start.notify_all();
+
+        try {
+            worker(0);
+        } catch (...) {
+            this->errors[0] = std::current_exception();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->done.wait(lock, [&]() { return this->nb_running == 0; });
+            this->job = nullptr;
+        }
+        for (const std::exception_ptr& error : this->errors) {
+            if (error != nullptr)
+                std::rethrow_exception(error);
+        }
+    }
+
+} // namespace kero
@@ -0,0 +1,263 @@
+/**
+* @file kero_unitig.cpp
+ *
+ * @brief This file implements the unitig compaction stage of kero files.
+ *
+ */
+
+#include "kero-api/kero_unitig.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/chain.hpp"
+#include "kero-api/detail/threads.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    namespace {
+
+        // All the k-mers of one input section, then the unitigs built from them.
+        struct Partition {
+            std::vector<uint64_t> kmers;
+            std::vector<uint8_t> kmer_data;
+            uint64_t nb_input_blocks = 0;
+            uint64_t input_nucleotides = 0;
+
+            // Output blocks
+            Chain_blocks unitigs;
+        };
+
+        /* Number of k-mers that can be stored in a raw block for a given max value.
+         * Section_Raw stores the k-mer count on ceil(log2(max)) bits rounded to bytes.
+         */
+        uint64_t raw_block_limit(uint64_t max) {
+            auto nb_bits = static_cast<uint64_t>(ceil(log2(max)));
+            uint64_t nb_bytes = bytes_from_bit_array(nb_bits, 1);
+            if (nb_bytes == 0)
+                return 1;
+            if (nb_bytes >= 8)
+                return max;
+            return std::min<uint64_t>(max, (1ull << (8 * nb_bytes)) - 1);
+        }
+
+        /* Build the maximal non-branching paths of the partition.
+         * Two k-mers x -> y are merged when y is the only successor of x and x the only predecessor of y.
+         */
+        void compact_partition(Partition& part, uint64_t k, uint64_t data_size, uint64_t limit) {
+            uint64_t nb_kmers = part.kmers.size();
+            uint64_t mask = get_mini_mask(k);
+            uint64_t high_shift = 2 * (k - 1);
+
+            // Duplicated k-mers are never merged, they stay alone in their block
+            std::unordered_map<uint64_t, uint64_t> index;
+            index.reserve(nb_kmers);
+            std::vector<bool> duplicate(nb_kmers, false);
+            for (uint64_t i = 0; i < nb_kmers; i++) {
+                if (not index.emplace(part.kmers[i], i).second)
+                    duplicate[i] = true;
+            }
+
+            auto find = [&](uint64_t kmer) {
+                auto it = index.find(kmer);
+                return it == index.end() ? NO_LINK : it->second;
+            };
+            auto unique_successor = [&](uint64_t kmer) {
+                uint64_t found = NO_LINK;
+                for (uint64_t nucl = 0; nucl < 4; nucl++) {
+                    uint64_t idx = find(((kmer << 2) | nucl) & mask);
+                    if (idx == NO_LINK)
+                        continue;
+                    if (found != NO_LINK)
+                        return NO_LINK;
+                    found = idx;
+                }
+                return found;
+            };
+            auto unique_predecessor = [&](uint64_t kmer) {
+                uint64_t found = NO_LINK;
+                for (uint64_t nucl = 0; nucl < 4; nucl++) {
+                    uint64_t idx = find((kmer >> 2) | (nucl << high_shift));
+                    if (idx == NO_LINK)
+                        continue;
+                    if (found != NO_LINK)
+                        return NO_LINK;
+                    found = idx;
+                }
+                return found;
+            };
+
+            // Links of the non-branching edges
+            std::vector<uint64_t> next(nb_kmers, NO_LINK);
+            std::vector<bool> has_prev(nb_kmers, false);
+            for (uint64_t i = 0; i < nb_kmers; i++) {
+                if (duplicate[i])
+                    continue;
+                uint64_t succ = unique_successor(part.kmers[i]);
+                if (succ == NO_LINK or succ == i)
+                    continue;
+                if (unique_predecessor(part.kmers[succ]) != i)
+                    continue;
+                next[i] = succ;
+                has_prev[succ] = true;
+            }
+
+            // Walk the paths from their heads, then break the remaining cycles anywhere
+            walk_chains(nb_kmers, has_prev, limit,
+                        [&](uint64_t current, const std::vector<bool>&) { return next[current]; },
+                        [&](const uint64_t* path, uint64_t size) {
+                            part.unitigs.append(part.kmers, part.kmer_data, path, size, k, data_size);
+                        });
+
+            // Release the input as soon as possible
+            std::vector<uint64_t>().swap(part.kmers);
+            std::vector<uint8_t>().swap(part.kmer_data);
+        }
+
+        /* Load all the blocks of a section as integer k-mers. */
+        void load_partition(Block_section_reader* section, Partition& part, uint64_t k) {
+            uint64_t nb_blocks = section->remaining_blocks;
+            uint64_t nb_kmers = section->extract_kmers(part.kmers, &part.kmer_data);
+
+            part.nb_input_blocks += nb_blocks;
+            part.input_nucleotides += nb_kmers + nb_blocks * (k - 1);
+        }
+
+    } // namespace
+
+
+    Unitig_stats compact_unitigs(const std::string& input, const std::string& output, const Unitig_options& options) {
+        Unitig_stats stats;
+
+        uint64_t nb_threads = options.nb_threads;
+        if (nb_threads == 0)
+            nb_threads = std::max(1u, std::thread::hardware_concurrency());
+        uint64_t batch_size = std::max<uint64_t>(1, options.batch_size);
+
+        Kero_file infile(input, "r");
+        Kero_file outfile(output, "w");
+        outfile.write_encoding(infile.encoding);
+        outfile.set_uniqueness(infile.uniqueness);
+        outfile.set_canonicity(infile.canonicity);
+
+        // Variables of the input file, with the max replaced by the unitig size
+        std::map<std::string, uint64_t> vars;
+        bool vars_written = false;
+        uint64_t k = 0, max = 0, data_size = 0, limit = 0;
+
+        std::vector<Partition> batch;
+
+        auto flush_batch = [&]() {
+            if (batch.empty())
+                return;
+
+            if (not vars_written) {
+                Section_GV sgv(&outfile);
+                for (const auto& var : vars) {
+                    if (var.first == "first_index" or var.first == "footer_size")
+                        continue;
+                    sgv.write_var(var.first, var.first == "max" ? limit : var.second);
+                }
+                sgv.close();
+                vars_written = true;
+            }
+
+            // Compact in parallel
+            std::atomic<uint64_t> next_part(0);
+            run_threads(std::min<uint64_t>(nb_threads, batch.size()), [&](uint64_t) {
+                uint64_t i;
+                while ((i = next_part++) < batch.size())
+                    compact_partition(batch[i], k, data_size, limit);
+            });
+
+            // Write sequentially, one raw section per partition
+            for (Partition& part : batch) {
+                stats.nb_partitions += 1;
+                stats.nb_input_blocks += part.nb_input_blocks;
+                stats.input_nucleotides += part.input_nucleotides;
+                if (part.unitigs.empty())
+                    continue;
+
+                Section_Raw sr(&outfile);
+                uint8_t* seq = part.unitigs.seqs.data();
+                uint8_t* data = part.unitigs.data.data();
+                for (uint64_t nb_kmers : part.unitigs.nb_kmers) {
+                    uint64_t seq_size = nb_kmers + k - 1;
+                    sr.write_compacted_sequence(seq, seq_size, data);
+                    seq += bytes_from_bit_array(2, seq_size);
+                    data += nb_kmers * data_size;
+
+                    stats.nb_kmers += nb_kmers;
+                    stats.nb_unitigs += 1;
+                    stats.output_nucleotides += seq_size;
+                }
+                sr.close();
+            }
+            batch.clear();
+        };
+
+        infile.complete_header();
+        while (infile.tellp() < infile.end_position) {
+            char type = infile.read_section_type();
+
+            if (type == 'v') {
+                Section_GV sgv(&infile);
+                sgv.close();
+                // New parameters apply to the following sections only
+                flush_batch();
+                for (const auto& var : sgv.vars)
+                    vars[var.first] = var.second;
+                vars_written = false;
+            }
+            else if (type == 'M' or type == 'r') {
+                if (vars.find("k") == vars.end() or vars.find("max") == vars.end()
+                    or vars.find("data_size") == vars.end())
+                    throw std::runtime_error("Unitig compaction: k, max or data_size missing before a sequence section.");
+                k = vars["k"];
+                max = vars["max"];
+                data_size = vars["data_size"];
+                if (k > 32)
+                    throw std::runtime_error("Unitig compaction: k must be at most 32.");
+                limit = raw_block_limit(options.max_kmers == 0 ? max : options.max_kmers);
+
+                // Sections read the variables from the file
+                for (const auto& var : vars)
+                    infile.global_vars[var.first] = var.second;
+
+                std::unique_ptr<Block_section_reader> section(Block_section_reader::construct_section(&infile));
+                batch.emplace_back();
+                load_partition(section.get(), batch.back(), k);
+                section.reset();
+
+                if (batch.size() >= batch_size)
+                    flush_batch();
+            }
+            else if (type == 'i') {
+                Section_Index si(&infile);
+                si.close();
+            }
+            else if (type == 'h') {
+                Section_Hashtable sh(&infile);
+                sh.close();
+            }
+            else {
+                throw std::runtime_error("Unitig compaction: unknown section type " + std::string(1, type));
+            }
+        }
+        flush_batch();
+
+        outfile.close();
+        return stats;
+    }
+
+} // namespace kero
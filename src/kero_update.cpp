@@ -0,0 +1,144 @@
+/**
+* @file kero_update.cpp
+ *
+ * @brief This file implements the in-place updates of the data of the k-mers of a kero file.
+ *
+ */
+
+#include "kero-api/kero_update.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+
+namespace kero {
+
+    Data_updater::Data_updater(const std::string& filename) {
+        this->file.reset(new Kero_file(filename, "r"));
+        if (not this->file->hashtable_discovery())
+            throw std::runtime_error("Data_updater: no hashtable in " + filename);
+        // The sections are read at their positions, never through the header
+        this->file->complete_header();
+
+        auto& vars = this->file->global_vars;
+        for (const char* name : {"k", "m", "max", "data_size"}) {
+            if (vars.find(name) == vars.end())
+                throw std::runtime_error(std::string("Data_updater: missing variable ") + name + " in " + filename);
+        }
+        if (vars["k"] > 32)
+            throw std::runtime_error("Data_updater: k must be at most 32");
+        this->data_size = vars["data_size"];
+
+        Mmap_options options;
+        options.access = MMAP_ACCESS_RANDOM;
+        options.writable = true;
+        this->mapping.reset(new Kero_Mmap_Accessor(filename, options));
+    }
+
+    Data_updater::~Data_updater() = default;
+
+    uint64_t Data_updater::locate(const std::vector<Kmer_query>& queries, std::vector<uint64_t>& positions) {
+        positions.assign(queries.size(), NO_DATA_POSITION);
+        uint64_t m = this->file->global_vars["m"];
+        uint64_t k = this->file->global_vars["k"];
+
+        // Queries grouped by section, the sections in the order of the file
+        std::map<uint64_t, std::vector<uint64_t>> sections;
+        std::unordered_map<uint64_t, uint64_t> section_of;
+        for (uint64_t i = 0; i < queries.size(); i++) {
+            uint64_t minimizer = mask_mini(queries[i].minimizer, m);
+            auto it = section_of.find(minimizer);
+            if (it == section_of.end()) {
+                uint64_t position;
+                if (not this->file->find_minimizer_section(minimizer, position))
+                    position = NO_DATA_POSITION;
+                it = section_of.emplace(minimizer, position).first;
+            }
+            if (it->second != NO_DATA_POSITION)
+                sections[it->second].push_back(i);
+        }
+
+        uint64_t nb_found = 0;
+        std::vector<uint64_t> kmers, data_positions;
+        std::unordered_map<uint64_t, uint64_t> located;
+        for (const auto& section : sections) {
+            this->file->jump_to(section.first);
+            Section_Minimizer sm(this->file.get());
+            kmers.clear();
+            data_positions.clear();
+            sm.locate_kmer_data(kmers, data_positions);
+
+            // The first occurrence of a k-mer holds its data, as in Section_Minimizer::find_kmer
+            located.clear();
+            located.reserve(kmers.size());
+            for (uint64_t i = 0; i < kmers.size(); i++)
+                located.emplace(kmers[i], data_positions[i]);
+
+            uint64_t kmer_mask = get_mini_mask(k);
+            for (uint64_t query : section.second) {
+                auto it = located.find(queries[query].kmer & kmer_mask);
+                if (it == located.end())
+                    continue;
+                positions[query] = it->second;
+                nb_found += 1;
+            }
+        }
+
+        return nb_found;
+    }
+
+    uint8_t* Data_updater::data(uint64_t minimizer, uint64_t kmer) {
+        std::vector<uint64_t> positions;
+        if (this->locate({{minimizer, kmer}}, positions) == 0)
+            return nullptr;
+        return this->mapping->get_mutable_ptr() + positions[0];
+    }
+
+    bool Data_updater::update(uint64_t minimizer, uint64_t kmer, const uint8_t* data) {
+        uint8_t* kmer_data = this->data(minimizer, kmer);
+        if (kmer_data == nullptr)
+            return false;
+        if (this->data_size > 0)
+            memcpy(kmer_data, data, this->data_size);
+        return true;
+    }
+
+    uint64_t Data_updater::update(const std::vector<Kmer_query>& queries, const uint8_t* data,
+                                  std::vector<uint8_t>* found) {
+        std::vector<uint64_t> positions;
+        this->locate(queries, positions);
+
+        // Write in the order of the file, the queries of a same k-mer in their order
+        std::vector<uint64_t> order;
+        order.reserve(queries.size());
+        for (uint64_t i = 0; i < queries.size(); i++) {
+            if (positions[i] != NO_DATA_POSITION)
+                order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint64_t a, uint64_t b) { return positions[a] < positions[b]; });
+
+        uint8_t* mapped = this->mapping->get_mutable_ptr();
+        if (this->data_size > 0) {
+            for (uint64_t i : order)
+                memcpy(mapped + positions[i], data + i * this->data_size, this->data_size);
+        }
+
+        if (found != nullptr) {
+            found->assign(queries.size(), 0);
+            for (uint64_t i : order)
+                (*found)[i] = 1;
+        }
+        return order.size();
+    }
+
+    bool Data_updater::sync() {
+        return this->mapping->sync();
+    }
+
+} // namespace kero
@@ -14,6 +14,9 @@
  *
  */
 
+#include <cassert>
+#include <cstring>
+
 #include "kero-api/detail/util.hpp"
 
 uint64_t kero::get_mini_mask(uint64_t m) {
@@ -34,4 +37,152 @@ uint64_t kero::mask_mini(const uint8_t* mini_arr, uint64_t m) {
         minimizer = (minimizer << 8) + mini_arr[i];
     }
     return mask_mini(minimizer, m);
-}
\ No newline at end of file
+}
+
+uint64_t kero::minimizer_hash(uint64_t minimizer) {
+    uint64_t h = minimizer + 0x9E3779B97F4A7C15ull;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+uint64_t kero::minimizer_order(uint64_t mmer) {
+    return minimizer_hash(mmer ^ 0xD6E8FEB86659FD93ull);
+}
+
+uint64_t kero::kmer_minimizer(uint64_t kmer, uint64_t k, uint64_t m, uint64_t* position) {
+    uint64_t mask = get_mini_mask(m);
+    uint64_t best = 0, best_order = UINT64_MAX, best_pos = 0;
+    for (uint64_t pos = 0; pos <= k - m; pos++) {
+        uint64_t mmer = (kmer >> (2 * (k - m - pos))) & mask;
+        uint64_t order = minimizer_order(mmer);
+        if (pos == 0 or order < best_order) {
+            best = mmer;
+            best_order = order;
+            best_pos = pos;
+        }
+    }
+    if (position != nullptr)
+        *position = best_pos;
+    return best;
+}
+
+namespace {
+
+    /* Sequential reader of the nucleotides of a right aligned packed sequence. */
+    class Nucleotide_stream {
+    private:
+        const uint8_t* byte;
+        unsigned shift;  // position of the next nucleotide in the current byte
+
+    public:
+        Nucleotide_stream(const uint8_t* seq, uint64_t seq_size)
+                : byte(seq), shift(6 - 2 * ((4 - seq_size % 4) % 4)) {}
+
+        uint64_t next() {
+            uint64_t nucl = (*byte >> shift) & 0b11;
+            if (shift == 0) {
+                shift = 6;
+                byte++;
+            } else {
+                shift -= 2;
+            }
+            return nucl;
+        }
+
+        // Read count nucleotides (at most 32) at once, whole bytes are consumed as words of 4 nucleotides
+        uint64_t take(uint64_t count) {
+            uint64_t value = 0;
+            while (count > 0 and shift != 6) {
+                value = (value << 2) | next();
+                count--;
+            }
+            for (; count >= 4; count -= 4)
+                value = (value << 8) | *byte++;
+            while (count > 0) {
+                value = (value << 2) | next();
+                count--;
+            }
+            return value;
+        }
+    };
+
+    /* Append the word of nb_nucl nucleotides to value. A shift of 64 bits is undefined behavior, a word of
+     * 32 nucleotides replaces value.
+     */
+    uint64_t append_nucleotides(uint64_t value, uint64_t nb_nucl, uint64_t word) {
+        return nb_nucl >= 32 ? word : (value << (2 * nb_nucl)) | word;
+    }
+
+}
+
+uint64_t kero::sequence_to_kmers(const uint8_t* seq, uint64_t seq_size, uint64_t k, uint64_t* kmers) {
+    if (seq_size < k)
+        return 0;
+
+    uint64_t mask = get_mini_mask(k);
+    Nucleotide_stream stream(seq, seq_size);
+    uint64_t kmer = stream.take(k);
+    kmers[0] = kmer;
+    uint64_t nb_kmers = seq_size - k + 1;
+    for (uint64_t i = 1; i < nb_kmers; i++) {
+        kmer = ((kmer << 2) | stream.next()) & mask;
+        kmers[i] = kmer;
+    }
+    return nb_kmers;
+}
+
+uint64_t kero::skmer_to_kmers(const uint8_t* seq, uint64_t nb_kmers, uint64_t k, uint64_t minimizer, uint64_t m,
+                              uint64_t mini_pos, uint64_t* kmers) {
+    if (nb_kmers == 0)
+        return 0;
+
+    // The first k-mer contains the prefix, the minimizer and the beginning of the suffix
+    uint64_t mask = get_mini_mask(k);
+    Nucleotide_stream stream(seq, nb_kmers + k - 1 - m);
+    uint64_t kmer = stream.take(mini_pos);
+    kmer = append_nucleotides(kmer, m, mask_mini(minimizer, m));
+    uint64_t first_suffix = k - mini_pos - m;
+    kmer = append_nucleotides(kmer, first_suffix, stream.take(first_suffix));
+    kmers[0] = kmer;
+
+    for (uint64_t i = 1; i < nb_kmers; i++) {
+        kmer = ((kmer << 2) | stream.next()) & mask;
+        kmers[i] = kmer;
+    }
+    return nb_kmers;
+}
+
+void kero::leftshift8(uint8_t* bitarray, size_t length, size_t bitshift) {
+    assert(bitshift < 8);
+
+    if (length > 0) {
+        for (uint64_t i = 0; i < length - 1; i++) {
+            bitarray[i] = (bitarray[i] << bitshift) | (bitarray[i + 1] >> (8 - bitshift));
+        }
+        bitarray[length - 1] <<= bitshift;
+    }
+}
+
+void kero::rightshift8(uint8_t* bitarray, size_t length, size_t bitshift) {
+    assert(bitshift < 8);
+
+    if (length > 0) {
+        for (uint64_t i = length - 1; i > 0; i--) {
+            bitarray[i] = (bitarray[i - 1] << (8 - bitshift)) | (bitarray[i] >> bitshift);
+        }
+        bitarray[0] >>= bitshift;
+    }
+}
+
+uint8_t kero::fusion8(uint8_t left_bits, uint8_t right_bits, size_t merge_index) {
+    uint8_t mask = 0xFF << (8 - merge_index);
+    return (left_bits & mask) | (right_bits & ~mask);
+}
+
+void kero::prepare_shifts(uint8_t** shifts, uint64_t seq_bytes, uint64_t nb_kmers) {
+    for (uint64_t i = 1; i < 4 and i < nb_kmers; i++) {
+        memcpy(shifts[i], shifts[0], seq_bytes);
+        rightshift8(shifts[i], seq_bytes, 2 * i);
+    }
+}
@@ -0,0 +1,198 @@
+/**
+* @file test_append.cpp
+ *
+ * @brief Minimizer sections appended to an existing file.
+ *
+ * An indexed file and a file without index are written, then reopened in append mode to add sections
+ * of new minimizers. After reopening, every k-mer of the original and of the appended sections must be
+ * found with its data: through the hashtable for the indexed file, by reading all the sections for the
+ * other one.
+ *
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+
+using namespace std;
+using namespace kero;
+
+static const uint64_t K = 31;
+static const uint64_t M = 11;
+static const uint64_t MAX = 8;
+static const uint64_t DATA_SIZE = 2;
+static const uint64_t NB_SECTIONS = 100;
+static const uint64_t SKMERS_PER_SECTION = 20;
+
+struct Kmer_entry {
+    uint64_t minimizer;
+    uint64_t kmer;
+    uint64_t data;
+};
+
+static string make_directory() {
+    const char* tmpdir = getenv("TMPDIR");
+    string pattern = string(tmpdir != nullptr and tmpdir[0] != '\0' ? tmpdir : "/tmp") + "/kero_append_test.XXXXXX";
+    vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+    if (mkdtemp(path.data()) == nullptr) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    return string(path.data());
+}
+
+/* Write one minimizer section for each minimizer of [first_minimizer, first_minimizer + NB_SECTIONS)
+ * and append their k-mers with their data to kmers.
+ */
+static void write_sections(Kero_file& file, mt19937_64& rng, uint64_t first_minimizer, vector<Kmer_entry>& kmers) {
+    uint64_t nb_bytes_mini = bytes_from_bit_array(2, M);
+    vector<uint8_t> mini_bytes(nb_bytes_mini);
+    vector<uint64_t> nucl(MAX + K - 1);
+    vector<uint8_t> data(MAX * DATA_SIZE);
+
+    for (uint64_t s = 0; s < NB_SECTIONS; s++) {
+        uint64_t minimizer = first_minimizer + s;
+        Section_Minimizer sm(&file);
+        store_big_endian(mini_bytes.data(), nb_bytes_mini, minimizer);
+        sm.write_minimizer(mini_bytes.data());
+
+        for (uint64_t b = 0; b < SKMERS_PER_SECTION; b++) {
+            // Every k-mer of the super k-mer contains the minimizer
+            uint64_t nb_kmers = 1 + rng() % MAX;
+            uint64_t size = nb_kmers + K - 1;
+            uint64_t mini_pos = nb_kmers - 1 + rng() % (K - M - nb_kmers + 2);
+            for (uint64_t i = 0; i < size; i++) {
+                if (i >= mini_pos and i < mini_pos + M)
+                    nucl[i] = (minimizer >> (2 * (mini_pos + M - 1 - i))) & 0b11;
+                else
+                    nucl[i] = rng() & 0b11;
+            }
+
+            // Right aligned sequence without the minimizer, 2 bits per nucleotide
+            vector<uint8_t> seq(bytes_from_bit_array(2, size - M), 0);
+            uint64_t offset = (4 - (size - M) % 4) % 4;
+            uint64_t pos = offset;
+            for (uint64_t i = 0; i < size; i++) {
+                if (i >= mini_pos and i < mini_pos + M)
+                    continue;
+                seq[pos / 4] |= static_cast<uint8_t>(nucl[i] << (6 - 2 * (pos % 4)));
+                pos++;
+            }
+
+            for (uint64_t i = 0; i < nb_kmers; i++) {
+                uint64_t kmer = 0;
+                for (uint64_t j = 0; j < K; j++)
+                    kmer = (kmer << 2) | nucl[i + j];
+                uint64_t value = rng() & 0xFFFF;
+                store_big_endian(data.data() + i * DATA_SIZE, DATA_SIZE, value);
+                kmers.push_back({minimizer, kmer, value});
+            }
+            sm.write_compacted_sequence_without_mini(seq.data(), size - M, mini_pos, data.data());
+        }
+        sm.close();
+    }
+}
+
+/* Write a file of NB_SECTIONS minimizer sections, then append as many sections of other minimizers. */
+static vector<Kmer_entry> write_and_append(const string& path, bool indexed) {
+    mt19937_64 rng(11);
+    vector<Kmer_entry> kmers;
+    {
+        Kero_file file(path, "w");
+        file.write_encoding(0, 1, 3, 2);
+        file.set_uniqueness(false);
+        file.set_canonicity(false);
+        file.set_indexation(indexed);
+
+        Section_GV sgv(&file);
+        sgv.write_var("k", K);
+        sgv.write_var("m", M);
+        sgv.write_var("max", MAX);
+        sgv.write_var("data_size", DATA_SIZE);
+        sgv.close();
+
+        write_sections(file, rng, 0, kmers);
+        file.close();
+    }
+    {
+        // The variables of the file are loaded on opening
+        Kero_file file(path, "a");
+        write_sections(file, rng, NB_SECTIONS, kmers);
+        file.close();
+    }
+    return kmers;
+}
+
+/* Look up every k-mer through the hashtable. Returns the number of errors. */
+static uint64_t check_indexed(const string& path, const vector<Kmer_entry>& kmers) {
+    Kero_file file(path, "r");
+    uint64_t errors = 0;
+    uint8_t data[DATA_SIZE];
+    for (const Kmer_entry& entry : kmers) {
+        uint64_t value = 0;
+        if (file.find_kmer(entry.minimizer, entry.kmer, data))
+            load_big_endian(data, DATA_SIZE, value);
+        else
+            errors += 1;
+        if (value != entry.data)
+            errors += 1;
+    }
+    return errors;
+}
+
+/* Read all the sections of the file and look up every k-mer in them. Returns the number of errors. */
+static uint64_t check_unindexed(const string& path, const vector<Kmer_entry>& kmers) {
+    Kero_reader reader(path);
+    vector<uint64_t> file_kmers;
+    vector<uint8_t> file_data;
+    while (reader.next_section_kmers(file_kmers, &file_data) > 0)
+        ;
+
+    unordered_map<uint64_t, uint64_t> values;
+    for (uint64_t i = 0; i < file_kmers.size(); i++) {
+        uint64_t value;
+        load_big_endian(file_data.data() + i * DATA_SIZE, DATA_SIZE, value);
+        values[file_kmers[i]] = value;
+    }
+
+    uint64_t errors = file_kmers.size() == kmers.size() ? 0 : 1;
+    for (const Kmer_entry& entry : kmers) {
+        auto it = values.find(entry.kmer);
+        if (it == values.end() or it->second != entry.data)
+            errors += 1;
+    }
+    return errors;
+}
+
+int main() {
+    string directory = make_directory();
+    string indexed_path = directory + "/indexed.kero";
+    string unindexed_path = directory + "/unindexed.kero";
+
+    vector<Kmer_entry> kmers = write_and_append(indexed_path, true);
+    uint64_t indexed_errors = check_indexed(indexed_path, kmers);
+    cout << "indexed\tkmers\t" << kmers.size() << "\terrors\t" << indexed_errors << "\n";
+
+    kmers = write_and_append(unindexed_path, false);
+    uint64_t unindexed_errors = check_unindexed(unindexed_path, kmers);
+    cout << "unindexed\tkmers\t" << kmers.size() << "\terrors\t" << unindexed_errors << "\n";
+
+    remove(indexed_path.c_str());
+    remove(unindexed_path.c_str());
+    rmdir(directory.c_str());
+
+    uint64_t errors = indexed_errors + unindexed_errors;
+    cout << "errors\t" << errors << endl;
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+/**
+* @file test_convert.cpp
+ *
+ * @brief Conversion of a file of raw sections into minimizer sections.
+ *
+ * A file of random blocks is converted in a single pass, then in several passes over ranges of minimizer
+ * hashes. Every k-mer of the input must be found in the converted file with its data.
+ *
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "kero-api/kero_convert.hpp"
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+
+using namespace std;
+using namespace kero;
+
+static const uint64_t K = 31;
+static const uint64_t M = 11;
+static const uint64_t MAX = 200;
+static const uint64_t DATA_SIZE = 2;
+static const uint64_t NB_SECTIONS = 20;
+static const uint64_t BLOCKS_PER_SECTION = 50;
+
+struct Kmer_entry {
+    uint64_t kmer;
+    uint64_t data;
+};
+
+static string make_directory() {
+    const char* tmpdir = getenv("TMPDIR");
+    string pattern = string(tmpdir != nullptr and tmpdir[0] != '\0' ? tmpdir : "/tmp") + "/kero_convert_test.XXXXXX";
+    vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+    if (mkdtemp(path.data()) == nullptr) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    return string(path.data());
+}
+
+/* Write random blocks in raw sections and return all their k-mers with their data. */
+static vector<Kmer_entry> write_raw_file(const string& path) {
+    mt19937_64 rng(7);
+    vector<Kmer_entry> kmers;
+
+    Kero_file file(path, "w");
+    file.write_encoding(0, 1, 3, 2);
+    file.set_uniqueness(false);
+    file.set_canonicity(false);
+
+    Section_GV sgv(&file);
+    sgv.write_var("k", K);
+    sgv.write_var("max", MAX);
+    sgv.write_var("data_size", DATA_SIZE);
+    sgv.close();
+
+    for (uint64_t s = 0; s < NB_SECTIONS; s++) {
+        Section_Raw sr(&file);
+        for (uint64_t b = 0; b < BLOCKS_PER_SECTION; b++) {
+            uint64_t nb_kmers = 1 + rng() % MAX;
+            uint64_t nb_nucl = nb_kmers + K - 1;
+
+            // Right aligned sequence, 2 bits per nucleotide
+            vector<uint64_t> nucl(nb_nucl);
+            vector<uint8_t> seq(bytes_from_bit_array(2, nb_nucl), 0);
+            uint64_t offset = (4 - nb_nucl % 4) % 4;
+            for (uint64_t i = 0; i < nb_nucl; i++) {
+                nucl[i] = rng() & 0b11;
+                uint64_t pos = offset + i;
+                seq[pos / 4] |= static_cast<uint8_t>(nucl[i] << (6 - 2 * (pos % 4)));
+            }
+
+            vector<uint8_t> data(nb_kmers * DATA_SIZE);
+            for (uint64_t i = 0; i < nb_kmers; i++) {
+                uint64_t kmer = 0;
+                for (uint64_t j = 0; j < K; j++)
+                    kmer = (kmer << 2) | nucl[i + j];
+                uint64_t value = rng() & 0xFFFF;
+                store_big_endian(data.data() + i * DATA_SIZE, DATA_SIZE, value);
+                kmers.push_back({kmer, value});
+            }
+            sr.write_compacted_sequence(seq.data(), nb_nucl, data.data());
+        }
+        sr.close();
+    }
+    file.close();
+
+    return kmers;
+}
+
+/* Check every k-mer and its data in the converted file. Returns the number of errors. */
+static uint64_t check(const string& path, const vector<Kmer_entry>& kmers) {
+    Kero_file file(path, "r");
+    uint64_t errors = 0;
+    uint8_t data[DATA_SIZE];
+    for (const Kmer_entry& entry : kmers) {
+        uint64_t value = 0;
+        if (file.find_kmer(kmer_minimizer(entry.kmer, K, M), entry.kmer, data))
+            load_big_endian(data, DATA_SIZE, value);
+        else
+            errors += 1;
+        if (value != entry.data)
+            errors += 1;
+    }
+    return errors;
+}
+
+int main() {
+    string directory = make_directory();
+    string input = directory + "/raw.kero";
+    string output = directory + "/converted.kero";
+    vector<Kmer_entry> kmers = write_raw_file(input);
+
+    uint64_t errors = 0;
+    for (uint64_t nb_passes : {1, 3}) {
+        Convert_options options;
+        options.m = M;
+        options.nb_threads = 4;
+        // Several batches per pass
+        options.batch_blocks = 97;
+        options.nb_passes = nb_passes;
+
+        Convert_stats stats = convert_to_minimizers(input, output, options);
+        uint64_t pass_errors = check(output, kmers);
+        if (stats.nb_kmers != kmers.size())
+            pass_errors += 1;
+        cout << "passes\t" << nb_passes << "\tkmers\t" << stats.nb_kmers << "\tsections\t"
+             << stats.nb_minimizer_sections << "\terrors\t" << pass_errors << "\n";
+        errors += pass_errors;
+        remove(output.c_str());
+    }
+    remove(input.c_str());
+    rmdir(directory.c_str());
+
+    cout << "errors\t" << errors << endl;
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/**
+* @file test_store_concurrency.cpp
+ *
+ * @brief Concurrent insertions in a Kero_store with background merges.
+ *
+ * Several threads insert k-mers while the level 0 files are written and merged in the background, so
+ * hashtables are built by several threads at the same time. Every k-mer must then be found with the
+ * number of its insertions, before and after reopening the store.
+ *
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "kero-api/kero_store.hpp"
+#include "kero-api/detail/util.hpp"
+
+using namespace std;
+using namespace kero;
+
+static const uint64_t NB_THREADS = 4;
+static const uint64_t KMERS_PER_THREAD = 20000;
+static const uint64_t NB_SHARED = 2000;  // K-mers inserted by every thread
+
+static string make_directory() {
+    const char* tmpdir = getenv("TMPDIR");
+    string pattern = string(tmpdir != nullptr and tmpdir[0] != '\0' ? tmpdir : "/tmp") + "/kero_store_test.XXXXXX";
+    vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+    if (mkdtemp(path.data()) == nullptr) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    return string(path.data());
+}
+
+static void remove_directory(const string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr)
+        return;
+    while (struct dirent* entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name != "." and name != "..")
+            remove((path + "/" + name).c_str());
+    }
+    closedir(dir);
+    rmdir(path.c_str());
+}
+
+static uint64_t load_counter(const uint8_t* data) {
+    uint64_t value;
+    load_big_endian(data, 4, value);
+    return value;
+}
+
+/* Check every k-mer and its number of insertions. Returns the number of errors. */
+static uint64_t check(Kero_store& store, const vector<uint64_t>& kmers, uint64_t k, uint64_t m, uint64_t shared) {
+    uint64_t errors = 0;
+    uint8_t data[4];
+    for (uint64_t i = 0; i < kmers.size(); i++) {
+        uint64_t expected = i < shared ? NB_THREADS : 1;
+        if (not store.find_kmer(kmer_minimizer(kmers[i], k, m), kmers[i], data) or load_counter(data) != expected)
+            errors += 1;
+    }
+    return errors;
+}
+
+int main() {
+    Store_options options;
+    options.k = 31;
+    options.m = 11;
+    options.data_size = 4;
+    options.merge = Store_merge::sum;
+    // Small level 0 files, so that the flushes of the inserting threads overlap the background merges
+    options.memtable_kmers = 200;
+    options.level0_files = 2;
+    options.level1_bytes = 64 << 10;
+    options.level_ratio = 4;
+    options.background = true;
+    options.nb_threads = 2;
+
+    // Distinct random k-mers: the shared ones first, then the ones of each thread
+    mt19937_64 rng(42);
+    uint64_t mask = get_mini_mask(options.k);
+    vector<uint64_t> kmers;
+    for (uint64_t i = 0; i < NB_SHARED + NB_THREADS * KMERS_PER_THREAD; i++)
+        kmers.push_back(rng() & mask);
+
+    string directory = make_directory();
+    uint64_t errors = 0;
+    {
+        Kero_store store(directory, options);
+        vector<thread> threads;
+        for (uint64_t t = 0; t < NB_THREADS; t++) {
+            threads.emplace_back([&, t]() {
+                uint8_t one[4];
+                store_big_endian(one, 4, 1);
+                auto insert = [&](uint64_t kmer) {
+                    store.insert(kmer_minimizer(kmer, options.k, options.m), kmer, one);
+                };
+                uint64_t first = NB_SHARED + t * KMERS_PER_THREAD;
+                for (uint64_t i = 0; i < KMERS_PER_THREAD; i++) {
+                    insert(kmers[first + i]);
+                    // Each thread inserts the shared k-mers once, in a different order
+                    if (i < NB_SHARED)
+                        insert(kmers[(i + t) % NB_SHARED]);
+                }
+            });
+        }
+        for (thread& t : threads)
+            t.join();
+        store.flush();
+        store.wait_merges();
+
+        errors += check(store, kmers, options.k, options.m, NB_SHARED);
+        cout << "files\t" << store.files().size() << "\n";
+        cout << "merges\t" << store.stats().nb_merges << "\n";
+    }
+    {
+        Kero_store store(directory, options);
+        errors += check(store, kmers, options.k, options.m, NB_SHARED);
+    }
+    remove_directory(directory);
+
+    cout << "errors\t" << errors << endl;
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+/**
+* @file kero_cat.cpp
+ *
+ * @brief Concatenation and re-indexation of kero files.
+ *
+ * The sequence sections are copied byte for byte and a single index and hashtable are built for the
+ * output. With --reindex, an index and a hashtable are added in place to a file written without them.
+ *
+ * Usage: kero-cat -o <output.kero> <input.kero>...
+ *        kero-cat -o - <input.kero>...  (to stdout, the counters go to stderr)
+ *        kero-cat --reindex <file.kero>
+ *
+ */
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "kero-api/kero_concat.hpp"
+
+using namespace std;
+using namespace kero;
+
+static void usage() {
+    cerr << "Usage: kero-cat -o <output.kero> <input.kero>..." << endl;
+    cerr << "       kero-cat --reindex <file.kero>" << endl;
+}
+
+int main(int argc, char** argv) {
+    string output;
+    bool reindex = false;
+    vector<string> inputs;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 and i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--reindex") == 0)
+            reindex = true;
+        else
+            inputs.push_back(argv[i]);
+    }
+
+    if (reindex ? inputs.size() != 1 or not output.empty() : inputs.empty() or output.empty()) {
+        usage();
+        return 1;
+    }
+
+    Concat_stats stats;
+    try {
+        if (reindex)
+            stats = reindex_file(inputs[0]);
+        else
+            stats = concatenate_files(inputs, output);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (reindex and stats.nb_files == 0) {
+        cout << inputs[0] << " is already indexed" << endl;
+        return 0;
+    }
+    // The kero file is written to stdout with "-o -"
+    ostream& out = output == "-" ? cerr : cout;
+    out << "files\t" << stats.nb_files << "\n";
+    out << "minimizer_sections\t" << stats.nb_minimizer_sections << "\n";
+    out << "raw_sections\t" << stats.nb_raw_sections << "\n";
+    out << "variable_sections\t" << stats.nb_variable_sections << "\n";
+    out << "section_bytes\t" << stats.nb_bytes << "\n";
+    return 0;
+}
@@ -0,0 +1,65 @@
+/**
+* @file kero_convert.cpp
+ *
+ * @brief Conversion of the sequence sections of a kero file into indexed minimizer sections.
+ *
+ * Usage: kero-convert [-m <minimizer size>] [-t <threads>] [--passes <n>] <input.kero> <output.kero>
+ *   -m        Size of the minimizers (default 11).
+ *   -t        Number of threads, 0 for one per hardware thread (default 0).
+ *   --passes  Number of passes over the input, to bound the memory (default 1).
+ *
+ */
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "kero-api/kero_convert.hpp"
+
+using namespace std;
+using namespace kero;
+
+static void usage() {
+    cerr << "Usage: kero-convert [-m <minimizer size>] [-t <threads>] [--passes <n>] <input.kero> <output.kero>" << endl;
+}
+
+int main(int argc, char** argv) {
+    Convert_options options;
+    vector<string> files;
+    try {
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "-m") == 0 and i + 1 < argc)
+                options.m = stoull(argv[++i]);
+            else if (strcmp(argv[i], "-t") == 0 and i + 1 < argc)
+                options.nb_threads = stoull(argv[++i]);
+            else if (strcmp(argv[i], "--passes") == 0 and i + 1 < argc)
+                options.nb_passes = stoull(argv[++i]);
+            else
+                files.push_back(argv[i]);
+        }
+    } catch (const exception&) {
+        usage();
+        return 1;
+    }
+
+    if (files.size() != 2) {
+        usage();
+        return 1;
+    }
+
+    Convert_stats stats;
+    try {
+        stats = convert_to_minimizers(files[0], files[1], options);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    cout << "input_sections\t" << stats.nb_input_sections << "\n";
+    cout << "input_blocks\t" << stats.nb_input_blocks << "\n";
+    cout << "kmers\t" << stats.nb_kmers << "\n";
+    cout << "super_kmers\t" << stats.nb_super_kmers << "\n";
+    cout << "minimizer_sections\t" << stats.nb_minimizer_sections << "\n";
+    return 0;
+}
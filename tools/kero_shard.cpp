@@ -0,0 +1,63 @@
+/**
+* @file kero_shard.cpp
+ *
+ * @brief Split of a kero file into shards by minimizer hash.
+ *
+ * The minimizer sections are copied byte for byte into n indexed files <prefix>.<i>.kero, the i-th one
+ * holding the i-th of n equal ranges of minimizer hashes. The manifest <prefix>.manifest lists the shards.
+ *
+ * Usage: kero-shard -n <nb shards> -o <prefix> <input.kero>
+ *
+ */
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "kero-api/kero_shard.hpp"
+
+using namespace std;
+using namespace kero;
+
+static void usage() {
+    cerr << "Usage: kero-shard -n <nb shards> -o <prefix> <input.kero>" << endl;
+}
+
+int main(int argc, char** argv) {
+    string prefix, input;
+    uint64_t nb_shards = 0;
+    try {
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "-o") == 0 and i + 1 < argc)
+                prefix = argv[++i];
+            else if (strcmp(argv[i], "-n") == 0 and i + 1 < argc)
+                nb_shards = stoull(argv[++i]);
+            else if (input.empty())
+                input = argv[i];
+            else {
+                usage();
+                return 1;
+            }
+        }
+    } catch (const exception&) {
+        usage();
+        return 1;
+    }
+
+    if (input.empty() or prefix.empty() or nb_shards == 0) {
+        usage();
+        return 1;
+    }
+
+    Shard_manifest manifest;
+    try {
+        manifest = shard_file(input, prefix, nb_shards);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    for (size_t i = 0; i < manifest.files.size(); i++)
+        cout << manifest.files[i] << "\t" << manifest.ranges[i].first << "\t" << manifest.ranges[i].last << "\n";
+    return 0;
+}
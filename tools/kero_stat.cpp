@@ -0,0 +1,274 @@
+/**
+* @file kero_stat.cpp
+ *
+ * @brief Statistics and layout inspection of a kero file.
+ *
+ * The sections are walked from the section headers. For the minimizer sections only the n column is
+ * decoded: the sizes of the other columns come from the column offsets and the n values.
+ * The hashtable is not loaded, only its sizes are read.
+ *
+ * Usage: kero-stat <file.kero> [--sections]
+ *   --sections  Also print one tab separated line per minimizer section.
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "kero-api/kero_io.hpp"
+#include "kero-api/detail/util.hpp"
+
+using namespace std;
+using namespace kero;
+
+enum Column { N_COL = 0, M_IDX_COL, DATA_COL, SEQ_COL, NB_COLS };
+static const char* column_names[NB_COLS] = {"n", "m_idx", "data", "seq"};
+
+struct Minimizer_section_stat {
+    uint64_t minimizer = 0;
+    uint64_t position = 0;
+    uint64_t bytes = 0;
+    uint64_t skmers = 0;
+    uint64_t kmers = 0;
+    uint8_t layout = 0;
+    uint64_t disk_bytes[NB_COLS] = {};     // size in the file
+    uint64_t decoded_bytes[NB_COLS] = {};  // size once decoded
+};
+
+struct Section_type_stat {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+/* Read the header of a minimizer section and the n values, then jump to the end of the section. */
+static Minimizer_section_stat inspect_minimizer_section(Kero_file& file) {
+    Minimizer_section_stat stat;
+    stat.position = file.tellp();
+
+    Section_Minimizer sm(&file);
+    stat.minimizer = mask_mini(sm.minimizer, sm.m);
+    stat.skmers = sm.nb_blocks;
+    stat.layout = sm.layout;
+
+    uint64_t seq_bytes = 0, data_bytes = 0;
+    uint64_t end;
+    if (sm.layout == KERO_LAYOUT_ROW) {
+        // Rows: [n:8B][m_idx:8B][seq][data]
+        file.jump_to(sm.n_col_offset);
+        for (uint64_t i = 0; i < sm.nb_blocks; i++) {
+            uint64_t n = read_u64(file);
+            file.jump(8);
+            uint64_t row_seq = bytes_from_bit_array(2, n + sm.k - sm.m - 1);
+            file.jump(row_seq + n * sm.data_size);
+            stat.kmers += n;
+            seq_bytes += row_seq;
+            data_bytes += n * sm.data_size;
+        }
+        end = file.tellp();
+        stat.disk_bytes[N_COL] = stat.disk_bytes[M_IDX_COL] = 8 * sm.nb_blocks;
+        stat.disk_bytes[DATA_COL] = data_bytes;
+        stat.disk_bytes[SEQ_COL] = seq_bytes;
+    } else {
+        // Columns in file order: n, m_idx, data, seq
+        vector<uint64_t> n_values;
+        file.jump_to(sm.n_col_offset);
+        if (sm.layout == KERO_LAYOUT_COLUMNAR_NOCOMP)
+            Plain_codec::read_u64(&file, sm.nb_blocks, n_values);
+        else
+            P4n_codec::read_u64(&file, sm.nb_blocks, n_values);
+        for (uint64_t n : n_values) {
+            stat.kmers += n;
+            seq_bytes += bytes_from_bit_array(2, n + sm.k - sm.m - 1);
+        }
+        data_bytes = stat.kmers * sm.data_size;
+        end = sm.seq_col_offset + seq_bytes;
+        stat.disk_bytes[N_COL] = sm.m_idx_col_offset - sm.n_col_offset;
+        stat.disk_bytes[M_IDX_COL] = sm.data_col_offset - sm.m_idx_col_offset;
+        stat.disk_bytes[DATA_COL] = sm.seq_col_offset - sm.data_col_offset;
+        stat.disk_bytes[SEQ_COL] = seq_bytes;
+    }
+    stat.decoded_bytes[N_COL] = stat.decoded_bytes[M_IDX_COL] = 8 * sm.nb_blocks;
+    stat.decoded_bytes[DATA_COL] = data_bytes;
+    stat.decoded_bytes[SEQ_COL] = seq_bytes;
+
+    file.jump_to(end);
+    stat.bytes = end - stat.position;
+    return stat;
+}
+
+static uint64_t quantile(const vector<uint64_t>& sorted, double q) {
+    if (sorted.empty())
+        return 0;
+    auto rank = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[min(rank, sorted.size() - 1)];
+}
+
+static double safe_ratio(uint64_t num, uint64_t den) {
+    return den == 0 ? 0.0 : static_cast<double>(num) / den;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "Usage: kero-stat <file.kero> [--sections]" << endl;
+        return 1;
+    }
+    string filename = argv[1];
+    bool per_section = argc > 2 and strcmp(argv[2], "--sections") == 0;
+
+    Kero_file file(filename, "r");
+    file.complete_header();
+    uint64_t header_bytes = file.tellp();
+
+    map<char, Section_type_stat> types;
+    vector<Minimizer_section_stat> sections;
+    uint64_t raw_blocks = 0, raw_kmers = 0;
+    uint64_t index_entries = 0, mphf_bytes = 0, hashtable_entries = 0;
+    uint64_t k = 0, m = 0, data_size = 0;
+
+    while (file.tellp() < file.end_position) {
+        uint64_t start = file.tellp();
+        char type = file.read_section_type();
+
+        if (type == 'v') {
+            Section_GV sgv(&file);
+            if (sgv.vars.count("k")) {
+                k = sgv.vars["k"];
+                m = file.global_vars["m"];
+                data_size = file.global_vars["data_size"];
+            }
+        } else if (type == 'i') {
+            Section_Index si(&file);
+            index_entries += si.index.size();
+        } else if (type == 'h') {
+            uint64_t nb_mphf, nb_entries;
+            Section_Hashtable::skip(&file, &nb_mphf, &nb_entries);
+            mphf_bytes += nb_mphf;
+            hashtable_entries += nb_entries;
+        } else if (type == 'M') {
+            sections.push_back(inspect_minimizer_section(file));
+        } else if (type == 'r') {
+            // Block headers only
+            Section_Raw sr(&file);
+            uint64_t nb_kmers;
+            uint64_t end = sr.section_end(&nb_kmers);
+            raw_kmers += nb_kmers;
+            raw_blocks += sr.nb_blocks;
+            sr.remaining_blocks = 0;
+            sr.close();
+            file.jump_to(end);
+        } else {
+            cerr << "Unknown section type '" << type << "' at byte " << start << endl;
+            return 1;
+        }
+
+        types[type].count += 1;
+        types[type].bytes += file.tellp() - start;
+    }
+    uint64_t file_bytes = file.end_position + 3;
+
+    // --- Aggregates ---
+    uint64_t skmers = 0, kmers = 0, section_bytes = 0;
+    uint64_t disk[NB_COLS] = {}, decoded[NB_COLS] = {};
+    map<uint8_t, uint64_t> layouts;
+    vector<uint64_t> section_kmers;
+    for (const auto& stat : sections) {
+        skmers += stat.skmers;
+        kmers += stat.kmers;
+        section_bytes += stat.bytes;
+        for (int c = 0; c < NB_COLS; c++) {
+            disk[c] += stat.disk_bytes[c];
+            decoded[c] += stat.decoded_bytes[c];
+        }
+        layouts[stat.layout] += 1;
+        section_kmers.push_back(stat.kmers);
+    }
+    sort(section_kmers.begin(), section_kmers.end());
+
+    cout << fixed << setprecision(3);
+    cout << "file\t" << filename << "\n";
+    cout << "bytes\t" << file_bytes << "\n";
+    cout << "header_bytes\t" << header_bytes << "\n";
+    cout << "k\t" << k << "\nm\t" << m << "\ndata_size\t" << data_size << "\n";
+
+    cout << "\n# sections\n";
+    for (const auto& it : types)
+        cout << "section_" << it.first << "\tcount " << it.second.count << "\tbytes " << it.second.bytes << "\n";
+
+    cout << "\n# minimizer sections\n";
+    cout << "sections\t" << sections.size() << "\n";
+    for (const auto& it : layouts)
+        cout << "layout_" << layout_name(it.first) << "\t" << it.second << "\n";
+    cout << "skmers\t" << skmers << "\n";
+    cout << "kmers\t" << kmers << "\n";
+    cout << "kmers_per_skmer\t" << safe_ratio(kmers, skmers) << "\n";
+    cout << "bits_per_kmer\t" << 8 * safe_ratio(section_bytes, kmers) << "\n";
+    for (int c = 0; c < NB_COLS; c++) {
+        cout << "column_" << column_names[c] << "\tbytes " << disk[c] << "\tdecoded " << decoded[c]
+             << "\tratio " << safe_ratio(decoded[c], disk[c]) << "\n";
+    }
+
+    cout << "\n# section size distribution (k-mers)\n";
+    if (not section_kmers.empty()) {
+        double mean = safe_ratio(kmers, section_kmers.size());
+        cout << "min\t" << section_kmers.front() << "\n";
+        cout << "p50\t" << quantile(section_kmers, 0.5) << "\n";
+        cout << "p90\t" << quantile(section_kmers, 0.9) << "\n";
+        cout << "p99\t" << quantile(section_kmers, 0.99) << "\n";
+        cout << "max\t" << section_kmers.back() << "\n";
+        cout << "mean\t" << mean << "\n";
+
+        // Minimizer skew
+        uint64_t top = max<uint64_t>(1, section_kmers.size() / 100);
+        uint64_t top_kmers = 0;
+        for (uint64_t i = section_kmers.size() - top; i < section_kmers.size(); i++)
+            top_kmers += section_kmers[i];
+        double weighted = 0;
+        for (uint64_t i = 0; i < section_kmers.size(); i++)
+            weighted += static_cast<double>(i + 1) * section_kmers[i];
+        double n = section_kmers.size();
+        double gini = kmers == 0 ? 0.0 : (2 * weighted) / (n * kmers) - (n + 1) / n;
+        cout << "max_over_mean\t" << section_kmers.back() / mean << "\n";
+        cout << "top1pct_kmer_share\t" << safe_ratio(top_kmers, kmers) << "\n";
+        cout << "gini\t" << gini << "\n";
+
+        // Power of 2 histogram
+        map<uint64_t, uint64_t> histogram;
+        for (uint64_t size : section_kmers) {
+            uint64_t bucket = 1;
+            while (bucket < size)
+                bucket <<= 1;
+            histogram[bucket] += 1;
+        }
+        for (const auto& it : histogram)
+            cout << "le_" << it.first << "\t" << it.second << "\n";
+    }
+
+    cout << "\n# raw sections\n";
+    cout << "blocks\t" << raw_blocks << "\nkmers\t" << raw_kmers << "\n";
+
+    cout << "\n# index and hashtable\n";
+    cout << "index_bytes\t" << types['i'].bytes << "\tentries " << index_entries << "\n";
+    cout << "hashtable_bytes\t" << types['h'].bytes << "\tmphf " << mphf_bytes << "\tentries " << hashtable_entries << "\n";
+
+    if (per_section) {
+        cout << "\n# minimizer\tposition\tbytes\tskmers\tkmers\tlayout";
+        for (int c = 0; c < NB_COLS; c++)
+            cout << "\t" << column_names[c] << "_bytes";
+        cout << "\n";
+        for (const auto& stat : sections) {
+            cout << stat.minimizer << "\t" << stat.position << "\t" << stat.bytes << "\t" << stat.skmers << "\t"
+                 << stat.kmers << "\t" << layout_name(stat.layout);
+            for (int c = 0; c < NB_COLS; c++)
+                cout << "\t" << stat.disk_bytes[c];
+            cout << "\n";
+        }
+    }
+
+    return 0;
+}
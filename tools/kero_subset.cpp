@@ -0,0 +1,127 @@
+/**
+* @file kero_subset.cpp
+ *
+ * @brief Extraction of a subset of the minimizer sections of a kero file.
+ *
+ * The sections are located through the hashtable and copied byte for byte into a new indexed file.
+ *
+ * Usage: kero-subset -o <output.kero> <input.kero> (--minimizers <list> | --part <i>/<n> | --hash-range <first>:<last>)
+ *   --minimizers  File with one minimizer per line, as nucleotides or as an integer (2 bits per nucleotide).
+ *   --part        The i-th of n equal ranges of minimizer hashes (0 <= i < n).
+ *   --hash-range  Inclusive range of minimizer hashes.
+ *
+ */
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "kero-api/kero_concat.hpp"
+#include "kero-api/kero_io.hpp"
+
+using namespace std;
+using namespace kero;
+
+static void usage() {
+    cerr << "Usage: kero-subset -o <output.kero> <input.kero> "
+         << "(--minimizers <list> | --part <i>/<n> | --hash-range <first>:<last>)" << endl;
+}
+
+/* Read one minimizer per line: an integer, or nucleotides converted with the encoding of the file. */
+static vector<uint64_t> read_minimizers(const string& path, const uint8_t* encoding) {
+    ifstream list(path);
+    if (not list)
+        throw runtime_error("Cannot open " + path);
+
+    vector<uint64_t> minimizers;
+    string line;
+    while (getline(list, line)) {
+        if (line.empty())
+            continue;
+        if (isdigit(static_cast<unsigned char>(line[0]))) {
+            minimizers.push_back(stoull(line));
+            continue;
+        }
+        uint64_t minimizer = 0;
+        for (char c : line) {
+            const char* nucleotides = "ACGT";
+            const char* found = strchr(nucleotides, toupper(static_cast<unsigned char>(c)));
+            if (c == '\0' or found == nullptr)
+                throw runtime_error("Invalid minimizer " + line);
+            minimizer = (minimizer << 2) | encoding[found - nucleotides];
+        }
+        minimizers.push_back(minimizer);
+    }
+    return minimizers;
+}
+
+/* Split "<a><separator><b>" into two integers. */
+static bool parse_pair(const string& arg, char separator, uint64_t& a, uint64_t& b) {
+    size_t pos = arg.find(separator);
+    if (pos == string::npos)
+        return false;
+    a = stoull(arg.substr(0, pos), nullptr, 0);
+    b = stoull(arg.substr(pos + 1), nullptr, 0);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    string output, minimizer_list, part, hash_range;
+    vector<string> inputs;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 and i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--minimizers") == 0 and i + 1 < argc)
+            minimizer_list = argv[++i];
+        else if (strcmp(argv[i], "--part") == 0 and i + 1 < argc)
+            part = argv[++i];
+        else if (strcmp(argv[i], "--hash-range") == 0 and i + 1 < argc)
+            hash_range = argv[++i];
+        else
+            inputs.push_back(argv[i]);
+    }
+
+    int nb_selections = !minimizer_list.empty() + !part.empty() + !hash_range.empty();
+    if (inputs.size() != 1 or output.empty() or nb_selections != 1) {
+        usage();
+        return 1;
+    }
+
+    Concat_stats stats;
+    try {
+        if (not minimizer_list.empty()) {
+            Kero_file infile(inputs[0], "r");
+            vector<uint64_t> minimizers = read_minimizers(minimizer_list, infile.encoding);
+            infile.close();
+            stats = extract_minimizers(inputs[0], output, minimizers);
+        } else {
+            Hash_range range;
+            uint64_t a, b;
+            if (not part.empty()) {
+                if (not parse_pair(part, '/', a, b)) {
+                    usage();
+                    return 1;
+                }
+                range = Hash_range::part(a, b);
+            } else {
+                if (not parse_pair(hash_range, ':', a, b)) {
+                    usage();
+                    return 1;
+                }
+                range.first = a;
+                range.last = b;
+            }
+            stats = extract_hash_range(inputs[0], output, range);
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    cout << "minimizer_sections\t" << stats.nb_minimizer_sections << "\n";
+    cout << "section_bytes\t" << stats.nb_bytes << "\n";
+    return 0;
+}